@@ -1,6 +1,7 @@
 #include <Arduino.h>
 
 #include "log.h"
+#include "clock.h"
 #include "timer.h"
 
 #include "error_codes.h"
@@ -12,16 +13,36 @@
 using namespace thingnet::peers;
 using namespace thingnet::utils;
 
-static Logger *logger = new Logger("client-prof");
+static constinit Logger logger("client-prof");
 
 namespace thingnet
 {
     static const int __DEFAULT_UPDATE_PERIOD = 10000;
+    static const int __DEFAULT_CONNECT_BACKOFF = 200;
+    static const int __CONNECT_RETRY_TIMEOUT = 100;
+    static const u8 __MAX_CONNECT_ATTEMPTS = 5;
+    static const u32 __DISCOVERY_MIN_BACKOFF = 50;
+    static const u32 __DISCOVERY_MAX_BACKOFF = 30000;
+    static const u16 __SERVER_FULL_LOAD = 1000;
+    static const u16 __SERVER_OVERLOAD_THRESHOLD = 900;
+    static const u16 __SERVER_LOAD_HYSTERESIS = 200;
+    // Advertisements can arrive for every beacon, so warnings about them are
+    // limited to one per period.
+    static const u32 __WARNING_PERIOD = 1000;
 
     ClientNodeProfile::ClientNodeProfile(Node *node) : NodeProfile(node)
     {
         this->update_period = __DEFAULT_UPDATE_PERIOD;
         this->update_timer = 0;
+        this->is_connect_pending = false;
+        this->connect_timer = 0;
+        this->server_load = 0;
+        this->connect_backoff = __DEFAULT_CONNECT_BACKOFF;
+        this->disconnect_time = 0;
+        this->reconnect_latency = 0;
+        this->discovery_timer = 0;
+        this->discovery_start_time = 0;
+        this->discovery_backoff = __DISCOVERY_MIN_BACKOFF;
     }
 
     int ClientNodeProfile::set_update_period(u32 timeout)
@@ -37,38 +58,284 @@ namespace thingnet
         return RESULT_OK;
     }
 
+    int ClientNodeProfile::set_connect_backoff(u32 backoff)
+    {
+        if (!this->is_initialized)
+        {
+            LOG_WARN(logger, "Node profile has not been initialized");
+            return ERR_NODE_PROFILE_NOT_INITIALIZED;
+        }
+
+        this->connect_backoff = backoff;
+
+        return RESULT_OK;
+    }
+
+    u32 ClientNodeProfile::get_reconnect_latency()
+    {
+        return this->reconnect_latency;
+    }
+
+    u16 ClientNodeProfile::get_server_load()
+    {
+        return this->server_load;
+    }
+
+    u32 ClientNodeProfile::get_memory_usage()
+    {
+        return NodeProfile::get_memory_usage() + sizeof(ClientNodeProfile) - sizeof(NodeProfile);
+    }
+
     int ClientNodeProfile::init()
     {
         ASSERT_OK(NodeProfile::init());
 
+        LOG_TRACE(logger, "Registering broadcast peer");
+        ASSERT_OK(this->node->register_peer(BROADCAST_MAC_ADDRESS,
+                                            ESP_NOW_ROLE_CONTROLLER));
+
         LOG_TRACE(logger, "Starting update timer");
         this->update_timer = new Timer(this->update_period, true);
         this->update_timer->start();
 
+        this->connect_timer = new Timer(0);
+        this->connect_timer->set_callback(on_connect_due, this);
+        this->discovery_timer = new Timer(0);
+        this->discovery_timer->set_callback(on_discovery_due, this);
+
         LOG_TRACE(logger, "Peer node manager initialized");
         return RESULT_OK;
     }
 
     int ClientNodeProfile::update()
     {
+        u8 peer_count = this->peers.size();
         ASSERT_OK(NodeProfile::update());
 
+        if (peer_count > 0 && this->peers.is_empty())
+        {
+            LOG_INFO(logger, "Disconnected from all servers");
+            this->disconnect_time = Clock::now_millis();
+            this->discovery_timer->stop();
+            this->discovery_backoff = __DISCOVERY_MIN_BACKOFF;
+        }
+
+        // A connection to a new server has been confirmed. Drop the old
+        // servers, which were added to the peer list before it.
+        while (this->peers.size() > 1)
+        {
+            LOG_INFO(logger, "Disconnecting from previous server");
+            this->remove_peer(this->peers[0]);
+        }
+
+        // Discovery is held while connected or connecting, and resumes here
+        // once neither is the case. Requests that fell due in the meantime
+        // are sent straight away.
+        if (!this->discovery_timer->is_running())
+        {
+            this->send_discovery();
+        }
+
         if (this->update_timer->is_complete())
         {
-            LOG_DEBUG(logger, "Updating [%d] peers", this->peer_count);
-            for (u8 index = 0; index < this->peer_count; index++)
+            this->update_peers();
+        }
+
+        return RESULT_OK;
+    }
+
+    void ClientNodeProfile::send_pending_connect()
+    {
+        if (!this->is_connect_pending)
+        {
+            return;
+        }
+
+        PendingConnect *pending = &this->pending_connect;
+        if (pending->attempts >= __MAX_CONNECT_ATTEMPTS)
+        {
+            LOG_WARN(logger, "No response to connect from [%s] after [%d] attempts",
+                     LOG_FORMAT_MAC(pending->mac_address),
+                     pending->attempts);
+            this->cancel_pending_connect();
+            return;
+        }
+
+        // The same message id is used for every attempt, so that the server's
+        // confirmation matches regardless of which attempt it admitted.
+        if (pending->message_id == 0)
+        {
+            pending->message_id = this->node->get_next_message_id();
+        }
+
+        LOG_DEBUG(logger, "Sending connect message to [%s]. Attempt [%d]",
+                  LOG_FORMAT_MAC(pending->mac_address),
+                  pending->attempts + 1);
+        MessagePayload payload(MSG_TYPE_CONNECT);
+        payload.message_id = pending->message_id;
+        this->node->send_message(pending->mac_address, &payload, 0);
+
+        this->connect_timer->set_duration((__CONNECT_RETRY_TIMEOUT << pending->attempts) +
+                                          random(this->connect_backoff + 1));
+        this->connect_timer->start();
+        pending->attempts++;
+    }
+
+    void ClientNodeProfile::on_connect_due(void *context)
+    {
+        ((ClientNodeProfile *)context)->send_pending_connect();
+    }
+
+    void ClientNodeProfile::cancel_pending_connect()
+    {
+        if (this->find_peer(this->pending_connect.mac_address) == 0)
+        {
+            this->node->unregister_peer(this->pending_connect.mac_address);
+        }
+        this->is_connect_pending = false;
+        this->connect_timer->stop();
+    }
+
+    void ClientNodeProfile::send_discovery()
+    {
+        if (!this->peers.is_empty() || this->is_connect_pending)
+        {
+            return;
+        }
+
+        u64 now = Clock::now_millis();
+        if (this->discovery_start_time == 0)
+        {
+            this->discovery_start_time = now;
+        }
+
+        LOG_DEBUG(logger, "Broadcasting discovery request. Next in [%d] ms",
+                  this->discovery_backoff);
+        MessagePayload payload(MSG_TYPE_DISCOVERY);
+        this->node->send_message(BROADCAST_MAC_ADDRESS, &payload, 0);
+
+        this->discovery_timer->set_duration(this->discovery_backoff +
+                                            random(this->discovery_backoff / 2 + 1));
+        this->discovery_timer->start();
+        this->discovery_backoff = this->discovery_backoff * 2 > __DISCOVERY_MAX_BACKOFF
+                                      ? __DISCOVERY_MAX_BACKOFF
+                                      : this->discovery_backoff * 2;
+    }
+
+    void ClientNodeProfile::on_discovery_due(void *context)
+    {
+        ((ClientNodeProfile *)context)->send_discovery();
+    }
+
+    void ClientNodeProfile::process_advertisement(PeerMessage *message)
+    {
+        MacAddress mac_addr = MacAddress::from_bytes(message->payload.body);
+        u8 flags = message->body_length > 6 ? message->payload.body[6] : 0;
+
+        // Servers that do not report their load are assumed to be idle.
+        u16 load = 0;
+        if (message->body_length > 8)
+        {
+            u8 peer_count = message->payload.body[7];
+            u8 capacity = message->payload.body[8];
+            load = peer_count >= capacity ? __SERVER_FULL_LOAD
+                                          : (u16)(peer_count * __SERVER_FULL_LOAD / capacity);
+        }
+
+        LOG_DEBUG(logger, "Advertisement message received from [%s] for [%s]. Flags [%02x], load [%d]",
+                 LOG_FORMAT_MAC(message->sender),
+                 LOG_FORMAT_MAC(mac_addr),
+                 flags,
+                 load);
+
+        if (this->find_peer(mac_addr) != 0)
+        {
+            LOG_TRACE(logger, "Updating load of current server");
+            this->server_load = load;
+            return;
+        }
+
+        if (load >= __SERVER_FULL_LOAD)
+        {
+            LOG_DEBUG(logger, "Server is full. Ignoring.");
+            return;
+        }
+
+        if (this->is_connect_pending)
+        {
+            PendingConnect *pending = &this->pending_connect;
+            if (pending->mac_address == mac_addr ||
+                pending->attempts > 0 ||
+                load + __SERVER_LOAD_HYSTERESIS > pending->load)
             {
-                LOG_TRACE(logger, "Updating peer [%d]", index);
-                this->peer_list[index]->update();
+                LOG_DEBUG(logger, "Connection is already pending. Ignoring.");
+                return;
             }
+
+            // The connect message has not been sent yet, so switch to the less
+            // loaded server (once it has been registered).
+            LOG_DEBUG(logger, "Switching pending connection to less loaded server");
         }
+        else if (!this->peers.is_empty())
+        {
+            if (this->server_load < __SERVER_OVERLOAD_THRESHOLD ||
+                load + __SERVER_LOAD_HYSTERESIS > this->server_load)
+            {
+                LOG_TRACE(logger, "Current server is preferred. Ignoring.");
+                return;
+            }
 
-        return RESULT_OK;
+            LOG_INFO(logger, "Current server is overloaded [%d]. Migrating to [%s] [%d]",
+                     this->server_load,
+                     LOG_FORMAT_MAC(mac_addr),
+                     load);
+        }
+
+        // The server must be registered with the node before the connect
+        // message can be sent. If the radio's peer table is full, the
+        // candidate is dropped, and the current or pending server is kept.
+        int result = this->node->register_peer(mac_addr, ESP_NOW_ROLE_COMBO);
+        if (result > RESULT_SUCCESS_BOUNDARY)
+        {
+            LOG_RATE_LIMITED(LOG_WARN, logger, __WARNING_PERIOD,
+                             "Unable to register server [%s]. Ignoring advertisement. Error [%d]",
+                             LOG_FORMAT_MAC(mac_addr), result);
+            return;
+        }
+
+        if (this->is_connect_pending)
+        {
+            this->cancel_pending_connect();
+        }
+
+        u64 now = Clock::now_millis();
+        PendingConnect *pending = &this->pending_connect;
+        pending->mac_address = mac_addr;
+        pending->message_id = 0;
+        pending->load = load;
+        pending->attempts = 0;
+        pending->advertise_time = now;
+        // Solicited advertisements are sent in response to this client's own
+        // discovery request, which has already been backed off.
+        u32 backoff = (flags & MSG_ADVERTISEMENT_FLAG_SOLICITED)
+                          ? 0
+                          : random(this->connect_backoff + 1);
+        this->connect_timer->set_duration(backoff);
+        this->connect_timer->start();
+        this->is_connect_pending = true;
+
+        LOG_DEBUG(logger, "Connect scheduled in [%d] ms", backoff);
     }
 
     Peer *ClientNodeProfile::create_peer(PeerMessage *message)
     {
-        if (message->payload.type != MSG_TYPE_ADVERTISEMENT)
+        if (message->payload.type == MSG_TYPE_ADVERTISEMENT)
+        {
+            this->process_advertisement(message);
+            return 0;
+        }
+
+        if (message->payload.type != MSG_TYPE_ACK)
         {
             LOG_DEBUG(logger, "Unexpected message [%02x] from [%s]. Ignoring.",
                       message->payload.type,
@@ -76,16 +343,45 @@ namespace thingnet
 
             return 0;
         }
-        u8 mac_addr[6];
-        memcpy(mac_addr, message->payload.body, 6);
-        LOG_DEBUG(logger, "Advertisement message received from [%s] for [%s]",
-                 LOG_FORMAT_MAC(message->sender),
-                 LOG_FORMAT_MAC(mac_addr));
 
-        LOG_DEBUG(logger, "Sending connect message");
-        MessagePayload payload(MSG_TYPE_CONNECT);
-        this->node->send_message(mac_addr, &payload, 0);
+        u16 message_id;
+        memcpy(&message_id, message->payload.body, 2);
+
+        PendingConnect *pending = &this->pending_connect;
+        if (!this->is_connect_pending ||
+            pending->attempts == 0 ||
+            pending->message_id != message_id ||
+            pending->mac_address != message->sender)
+        {
+            LOG_DEBUG(logger, "Unexpected ack from [%s]. Ignoring.",
+                      LOG_FORMAT_MAC(message->sender));
+            return 0;
+        }
+
+        u64 now = Clock::now_millis();
+        LOG_INFO(logger, "Connected to [%s] [%d] ms after advertisement",
+                 LOG_FORMAT_MAC(pending->mac_address),
+                 (u32)(now - pending->advertise_time));
+
+        if (this->discovery_start_time != 0)
+        {
+            LOG_INFO(logger, "Connected [%d] ms after discovery started",
+                     (u32)(now - this->discovery_start_time));
+            this->discovery_start_time = 0;
+        }
+
+        if (this->disconnect_time != 0)
+        {
+            this->reconnect_latency = (u32)(now - this->disconnect_time);
+            this->disconnect_time = 0;
+            LOG_INFO(logger, "Reconnected after [%d] ms",
+                     this->reconnect_latency);
+        }
+
+        this->server_load = pending->load;
+        this->is_connect_pending = false;
+        this->connect_timer->stop();
 
-        return new BasicPeer(this->node, mac_addr);
+        return this->new_peer(pending->mac_address, BASIC_PEER_DEFAULT_TIMEOUT);
     }
 }
\ No newline at end of file
@@ -16,23 +16,104 @@ using namespace thingnet::peers;
 
 namespace thingnet
 {
+    /**
+     * @brief A connection to a server that has been advertised, but not yet
+     * confirmed by the server.
+     */
+    typedef struct PendingConnect
+    {
+        MacAddress mac_address;
+        u16 message_id;
+        u16 load;
+        u8 attempts;
+        u64 advertise_time;
+    } PendingConnect;
+
     /**
      * @brief A node profile implementation for client nodes. Automatically
      * registers itself with a server that is advertising itself, and
      * disconnects if the server becomes inactive.
+     * 
+     * Connect messages are sent after a random backoff, so that clients that
+     * hear the same advertisement do not all respond at once, and are retried
+     * with exponential backoff until the server confirms the connection.
+     * 
+     * While the client has no servers, it also actively broadcasts discovery
+     * requests (with exponential backoff). Servers respond with a solicited
+     * advertisement, to which the client connects without any backoff.
+     * 
+     * The client connects to a single server at a time. If several servers
+     * advertise during the connect backoff, the least loaded one is chosen.
+     * Once connected, the client only migrates to another server if its
+     * current server is overloaded, and the other server is less loaded by a
+     * clear margin.
      */
     class ClientNodeProfile : public NodeProfile
     {
     private:
         Timer *update_timer;
         u32 update_period;
+        PendingConnect pending_connect;
+        bool is_connect_pending;
+        // Runs until the next attempt of the pending connection is due.
+        Timer *connect_timer;
+        u16 server_load;
+        u32 connect_backoff;
+        u64 disconnect_time;
+        u32 reconnect_latency;
+        // Runs until the next discovery request is due.
+        Timer *discovery_timer;
+        u64 discovery_start_time;
+        u32 discovery_backoff;
+
+        /**
+         * @brief Broadcasts a discovery request if the client is not connected
+         * to a server, and runs the discovery timer for the next request,
+         * backing off exponentially between requests.
+         */
+        void send_discovery();
+
+        /**
+         * @brief Sends the pending connect message and runs the connect timer
+         * for the next attempt, or drops the pending connection if it has
+         * exhausted its retries.
+         */
+        void send_pending_connect();
+
+        /**
+         * @brief Sends the next attempt of the pending connection.
+         * 
+         * @param context The client node profile.
+         */
+        static void on_connect_due(void *context);
+
+        /**
+         * @brief Sends the next discovery request.
+         * 
+         * @param context The client node profile.
+         */
+        static void on_discovery_due(void *context);
+
+        /**
+         * @brief Cancels the pending connection, unregistering the server from
+         * the node if it is not a connected peer.
+         */
+        void cancel_pending_connect();
+
+        /**
+         * @brief Handles a server advertisement, updating the load of the
+         * current server, or scheduling a connection to the advertised server
+         * if it is a better choice.
+         * 
+         * @param message A pointer to the advertisement message.
+         */
+        void process_advertisement(PeerMessage *message);
 
     protected:
         /**
-         * @brief Creates a new peer object, typically when establishing a
-         * connection to a server or client. Child classes can override this
-         * implementation to create different peers based on specific
-         * requirements.
+         * @brief Creates a new peer object when a server confirms a connection.
+         * Advertisements from servers are queued as pending connections, and
+         * connect messages are sent by the connect timer.
          * 
          * @param message A pointer to the message that was received from the
          * peer.
@@ -57,6 +138,40 @@ namespace thingnet
          */
         int set_update_period(u32 timeout);
 
+        /**
+         * @brief Sets the maximum random backoff applied before connecting to
+         * an advertised server, and between connection retries.
+         * 
+         * @param backoff The maximum backoff in milliseconds.
+         * @return int A non success value will be returned if the add operation
+         * resulted in an error. See error codes for more information.
+         */
+        int set_connect_backoff(u32 backoff);
+
+        /**
+         * @brief Gets the time taken to reconnect to a server the last time
+         * the client lost all of its server connections.
+         * 
+         * @return u32 The reconnect latency in milliseconds, or zero if the
+         * client has not reconnected yet.
+         */
+        u32 get_reconnect_latency();
+
+        /**
+         * @brief Gets the load of the current server, as last advertised by
+         * the server.
+         * 
+         * @return u16 The server load in parts per thousand of its capacity.
+         */
+        u16 get_server_load();
+
+        /**
+         * @brief Gets the memory used by the profile.
+         * 
+         * @return u32 The memory used, in bytes.
+         */
+        u32 get_memory_usage();
+
         /**
          * @brief Initializes the node profile by starting the appropriate
          * timers.
@@ -17,6 +17,15 @@ namespace thingnet
   const int ERR_PEER_UNREGISTRATION_FAILED = 0x14;
   const int ERR_NODE_PROFILE_NOT_INITIALIZED = 0x15;
   const int ERR_ESP_NOW_INIT_FAILED = 0x15;
+  const int ERR_PEER_LIMIT_EXCEEDED = 0x16;
+  const int ERR_STORAGE_INIT_FAILED = 0x17;
+  const int ERR_STORAGE_READ_FAILED = 0x18;
+  const int ERR_STORAGE_WRITE_FAILED = 0x19;
+  const int ERR_SEND_FAILED = 0x1A;
+  const int ERR_LISTENER_LIMIT_EXCEEDED = 0x1B;
+  const int ERR_REQUEST_LIMIT_EXCEEDED = 0x1C;
+  const int ERR_REQUEST_TIMEOUT = 0x1D;
+  const int ERR_EVENT_QUEUE_FULL = 0x1E;
 }
 
 #define ASSERT_OK(expr)                                                                                   \
@@ -3,14 +3,183 @@
 
 #include <Arduino.h>
 #include "log.h"
+#include "static_vector.h"
 #include "error_codes.h"
+#include "node_config.h"
 
 using namespace thingnet::utils;
 
 namespace thingnet
 {
-    const int __MAX_LISTENER_COUNT = 32;
-    static Logger *_event_emitter_logger = new Logger("event-emit");
+    const u16 __MAX_LISTENER_COUNT = EVENT_MAX_LISTENERS;
+    const u8 __MAX_DEFERRED_EVENT_COUNT = EVENT_MAX_DEFERRED_EVENTS;
+    const u32 __DROPPED_EVENT_WARNING_PERIOD = 1000;
+    inline constinit Logger _event_emitter_logger("event-emit");
+
+    template <typename T>
+    class EventEmitter;
+
+    /**
+     * @brief A listener that can be notified of events. Listeners are
+     * lightweight delegates that consist of a function and a context pointer
+     * that is passed back to the function, allowing listeners to carry state
+     * without using globals. Listeners can also be created from plain
+     * functions, and bound to member functions using bind().
+     * 
+     * @tparam T The data type of the event payload.
+     */
+    template <typename T>
+    class EventListener
+    {
+    public:
+        /**
+         * @brief A function that receives events along with a context pointer.
+         */
+        typedef void (*function_t)(void *context, int event_type, T event_data);
+
+    private:
+        function_t function;
+        void *context;
+
+        static void invoke_function(void *context, int event_type, T event_data)
+        {
+            ((void (*)(int, T))context)(event_type, event_data);
+        }
+
+        template <typename C, void (C::*method)(int, T)>
+        static void invoke_method(void *context, int event_type, T event_data)
+        {
+            (((C *)context)->*method)(event_type, event_data);
+        }
+
+    public:
+        /**
+         * @brief Construct an empty listener.
+         */
+        EventListener() : function(0), context(0) {}
+
+        /**
+         * @brief Construct a listener from a function and a context pointer.
+         * 
+         * @param function The function to invoke when the event occurs.
+         * @param context A pointer that will be passed to the function.
+         */
+        EventListener(function_t function, void *context)
+            : function(function), context(context) {}
+
+        /**
+         * @brief Construct a listener from a plain function that does not
+         * require any context.
+         * 
+         * @param function The function to invoke when the event occurs.
+         */
+        EventListener(void (*function)(int event_type, T event_data))
+            : function(&EventListener<T>::invoke_function), context((void *)function) {}
+
+        /**
+         * @brief Creates a listener that invokes a member function on the
+         * given object. For example:
+         * `EventListener<T>::bind<Foo, &Foo::on_event>(&foo)`.
+         * 
+         * @tparam C The class that declares the member function.
+         * @tparam method The member function to invoke.
+         * @param instance The object on which the member function will be
+         * invoked.
+         * @return EventListener<T> The listener.
+         */
+        template <typename C, void (C::*method)(int, T)>
+        static EventListener<T> bind(C *instance)
+        {
+            return EventListener<T>(&EventListener<T>::invoke_method<C, method>, instance);
+        }
+
+        /**
+         * @brief Notifies the listener of an event.
+         * 
+         * @param event_type The type of the event.
+         * @param event_data The event data.
+         */
+        void invoke(int event_type, T event_data) const
+        {
+            this->function(this->context, event_type, event_data);
+        }
+
+        bool operator==(const EventListener<T> &other) const
+        {
+            return this->function == other.function && this->context == other.context;
+        }
+    };
+
+    /**
+     * @brief A bounded queue of events, used by emitters in deferred mode.
+     * Events are queued when they are emitted, and dispatched to listeners
+     * when the queue is drained, typically from an update() method. This
+     * keeps listener execution out of time critical contexts such as the
+     * ESP-NOW receive callback.
+     * 
+     * Emitters that share a queue are treated as opposing events (peer added
+     * and peer removed, for example). When an event is queued while an event
+     * with the same data from a different emitter is pending, both events
+     * cancel out, and neither is dispatched.
+     * 
+     * Events that are pushed while the queue is full are dropped and counted,
+     * rather than being dispatched out of order.
+     * 
+     * Events are held in two buffers, so that events emitted by listeners
+     * while the queue is being drained go to the other buffer, and are
+     * dispatched by the next drain.
+     * 
+     * @tparam T The data type of the event payload. Must support equality
+     * comparison.
+     */
+    template <typename T>
+    class DeferredEventQueue
+    {
+    private:
+        typedef struct QueuedEvent
+        {
+            EventEmitter<T> *emitter;
+            T event_data;
+        } QueuedEvent;
+
+        StaticVector<QueuedEvent, __MAX_DEFERRED_EVENT_COUNT> buffers[2];
+        u8 pending_index;
+        u32 dropped_count;
+
+    public:
+        /**
+         * @brief Construct a new deferred event queue object
+         */
+        DeferredEventQueue();
+
+        /**
+         * @brief Queues an event for dispatch, coalescing it with any pending
+         * opposing event.
+         * 
+         * @param emitter The emitter of the event.
+         * @param event_data The event data.
+         * @return int A non success value will be returned if the event could
+         * not be queued, in which case it is dropped. See error codes for more
+         * information.
+         */
+        int push(EventEmitter<T> *emitter, T event_data);
+
+        /**
+         * @brief Dispatches all pending events to their listeners, in the order
+         * in which they were emitted.
+         * 
+         * @return u8 The number of events dispatched.
+         */
+        u8 drain();
+
+        /**
+         * @brief Gets the number of events that have been dropped because the
+         * queue was full.
+         * 
+         * @return u32 The number of dropped events.
+         */
+        u32 get_dropped_count();
+    };
 
     /**
      * @brief A generic event base class that can accept and manage a collection
@@ -22,8 +191,7 @@ namespace thingnet
     class Event
     {
     protected:
-        void (*listeners[__MAX_LISTENER_COUNT])(int event_type, T event_data);
-        u16 listener_count;
+        StaticVector<EventListener<T>, __MAX_LISTENER_COUNT> listeners;
 
     public:
         /**
@@ -43,22 +211,22 @@ namespace thingnet
          * each listener completes execution quickly, allowing other listeners
          * to be invoked.
          * 
-         * @param listener Pointer to a function that will be invoked when the
-         * event occurs.
+         * @param listener The listener that will be invoked when the event
+         * occurs. Plain functions are converted to listeners implicitly.
          * @return int A non success value will be returned if the add operation
          * resulted in an error. See error codes for more information.
          */
-        int add_listener(void (*listener)(int event_type, T event_data));
+        int add_listener(EventListener<T> listener);
 
         /**
          * @brief Removes an existing listener from the list. This method will
          * do nothing if the listener had previously not been registered.
          * 
-         * @param listener Pointer to the listener function to be removed.
+         * @param listener The listener to be removed.
          * @return int A non success value will be returned if the add operation
          * resulted in an error. See error codes for more information.
          */
-        int remove_listener(void (*listener)(int event_type, T event_data));
+        int remove_listener(EventListener<T> listener);
     };
 
     /**
@@ -75,6 +243,7 @@ namespace thingnet
     {
     private:
         int event_type;
+        DeferredEventQueue<T> *queue;
 
     public:
         /**
@@ -91,17 +260,41 @@ namespace thingnet
         virtual ~EventEmitter();
 
         /**
-         * @brief Notify all registered listeners of an event.
+         * @brief Notify all registered listeners of an event. In deferred mode,
+         * the event is queued, and listeners are notified when the queue is
+         * drained.
+         * 
+         * @param event_data The event data to be passed to each listener.
+         * @return int A non success value will be returned if the event could
+         * not be queued in deferred mode, in which case it is dropped. See
+         * error codes for more information.
+         */
+        int emit(T event_data);
+
+        /**
+         * @brief Notify all registered listeners of an event immediately,
+         * regardless of whether or not the emitter is in deferred mode. Both
+         * emit() and the deferred queue notify listeners through this method,
+         * so derived emitters can override it to notify additional listeners.
          * 
          * @param event_data The event data to be passed to each listener.
          */
-        void emit(T event_data);
+        virtual void dispatch(T event_data);
+
+        /**
+         * @brief Switches the emitter to deferred mode, in which events are
+         * queued instead of being dispatched immediately.
+         * 
+         * @param queue The queue to which events will be added, or a null
+         * value to dispatch events immediately.
+         */
+        void set_deferred(DeferredEventQueue<T> *queue);
     };
 
     template <typename T>
     Event<T>::Event()
     {
-        this->listener_count = 0;
+        // Nothing to do here.
     }
 
     template <typename T>
@@ -111,56 +304,41 @@ namespace thingnet
     }
 
     template <typename T>
-    int Event<T>::add_listener(void (*listener)(int event_type, T event_data))
+    int Event<T>::add_listener(EventListener<T> listener)
     {
         LOG_TRACE(_event_emitter_logger, "Registering event listener");
-        for (int index = 0; index < this->listener_count; index++)
+        if (this->listeners.contains(listener))
         {
-            if (this->listeners[index] == listener)
-            {
-                LOG_WARN(_event_emitter_logger, "Listener has already been registered");
-                return RESULT_DUPLICATE;
-            }
+            LOG_WARN(_event_emitter_logger, "Listener has already been registered");
+            return RESULT_DUPLICATE;
+        }
+
+        if (this->listeners.push_back(listener) != 0)
+        {
+            LOG_ERROR(_event_emitter_logger, "Cannot add listener - maximum listener limit has been reached");
+            return ERR_LISTENER_LIMIT_EXCEEDED;
         }
-        this->listeners[this->listener_count] = listener;
-        this->listener_count++;
+
         LOG_DEBUG(_event_emitter_logger, "Listener registered. Total listeners [%d]",
-                  this->listener_count);
+                  this->listeners.size());
         return RESULT_OK;
     }
 
     template <typename T>
-    int Event<T>::remove_listener(void (*listener)(int event_type, T event_data))
+    int Event<T>::remove_listener(EventListener<T> listener)
     {
         LOG_TRACE(_event_emitter_logger, "Removing event listener");
-        u16 listener_index = this->listener_count;
-        for (u16 index = 0; index < this->listener_count; index++)
-        {
-            if (this->listeners[index] == listener)
-            {
-                listener_index = index;
-                break;
-            }
-        }
-
-        if (listener_index == this->listener_count)
+        int listener_index = this->listeners.index_of(listener);
+        if (listener_index < 0)
         {
             LOG_WARN(_event_emitter_logger, "Cannot remove unregistered listener");
             return RESULT_NO_EXIST;
         }
 
         LOG_TRACE(_event_emitter_logger, "Found listener at [%d]", listener_index);
-        for (u16 index = listener_index;
-             listener_index < this->listener_count - 1;
-             listener_index++)
-        {
-            this->listeners[index] = this->listeners[index + 1];
-        }
-
-        this->listener_count--;
-        this->listeners[this->listener_count] = 0;
+        this->listeners.erase(listener_index);
         LOG_DEBUG(_event_emitter_logger, "Listener removed. Total listeners [%d]",
-                  this->listener_count);
+                  this->listeners.size());
 
         return RESULT_OK;
     }
@@ -169,6 +347,7 @@ namespace thingnet
     EventEmitter<T>::EventEmitter(int event_type) : Event<T>()
     {
         this->event_type = event_type;
+        this->queue = 0;
     }
 
     template <typename T>
@@ -178,17 +357,102 @@ namespace thingnet
     }
 
     template <typename T>
-    void EventEmitter<T>::emit(T event_data)
+    int EventEmitter<T>::emit(T event_data)
+    {
+        if (this->queue != 0)
+        {
+            LOG_TRACE(_event_emitter_logger, "Deferring event [%d]", this->event_type);
+            return this->queue->push(this, event_data);
+        }
+
+        this->dispatch(event_data);
+        return RESULT_OK;
+    }
+
+    template <typename T>
+    void EventEmitter<T>::dispatch(T event_data)
     {
         LOG_DEBUG(_event_emitter_logger, "Emitting event [%d]. Listener count [%d]",
-                  this->event_type, this->listener_count);
-        for (u16 index = 0; index < this->listener_count; index++)
+                  this->event_type, this->listeners.size());
+        for (u16 index = 0; index < this->listeners.size(); index++)
+        {
+            LOG_TRACE(_event_emitter_logger, "Notifying listener [%d]", index);
+            this->listeners[index].invoke(this->event_type, event_data);
+        }
+
+        LOG_TRACE(_event_emitter_logger, "Notified [%d] listeners", this->listeners.size());
+    }
+
+    template <typename T>
+    void EventEmitter<T>::set_deferred(DeferredEventQueue<T> *queue)
+    {
+        this->queue = queue;
+    }
+
+    template <typename T>
+    DeferredEventQueue<T>::DeferredEventQueue()
+    {
+        this->pending_index = 0;
+        this->dropped_count = 0;
+    }
+
+    template <typename T>
+    int DeferredEventQueue<T>::push(EventEmitter<T> *emitter, T event_data)
+    {
+        StaticVector<QueuedEvent, __MAX_DEFERRED_EVENT_COUNT> &events = this->buffers[this->pending_index];
+        for (u8 index = 0; index < events.size(); index++)
+        {
+            QueuedEvent *pending = &events[index];
+            if (pending->emitter != emitter && pending->event_data == event_data)
+            {
+                LOG_TRACE(_event_emitter_logger, "Coalescing opposing events");
+                events.erase(index);
+                return RESULT_OK;
+            }
+        }
+
+        QueuedEvent event;
+        event.emitter = emitter;
+        event.event_data = event_data;
+        if (events.push_back(event) != 0)
+        {
+            // Dispatching here instead would run listeners in the caller's
+            // context, ahead of the events that are already queued.
+            this->dropped_count++;
+            LOG_RATE_LIMITED(LOG_WARN, _event_emitter_logger, __DROPPED_EVENT_WARNING_PERIOD,
+                             "Deferred event queue is full. Dropped [%d] events", this->dropped_count);
+            return ERR_EVENT_QUEUE_FULL;
+        }
+
+        return RESULT_OK;
+    }
+
+    template <typename T>
+    u8 DeferredEventQueue<T>::drain()
+    {
+        StaticVector<QueuedEvent, __MAX_DEFERRED_EVENT_COUNT> &events = this->buffers[this->pending_index];
+        if (events.is_empty())
+        {
+            return 0;
+        }
+
+        // Listeners may emit further events while the queue is being drained,
+        // so queue them in the other buffer.
+        this->pending_index ^= 1;
+        for (QueuedEvent &event : events)
         {
-            LOG_TRACE(_event_emitter_logger, "Notifying listener [%d]");
-            this->listeners[index](this->event_type, event_data);
+            event.emitter->dispatch(event.event_data);
         }
 
-        LOG_TRACE(_event_emitter_logger, "Notified [%d] listeners", this->listener_count);
+        u8 count = events.size();
+        events.clear();
+        return count;
+    }
+
+    template <typename T>
+    u32 DeferredEventQueue<T>::get_dropped_count()
+    {
+        return this->dropped_count;
     }
 }
 
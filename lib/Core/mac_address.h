@@ -0,0 +1,89 @@
+#ifndef __MAC_ADDRESS_H
+#define __MAC_ADDRESS_H
+
+#include <Arduino.h>
+
+namespace thingnet
+{
+    /**
+     * @brief A 48 bit mac address, packed into an integer so that it can be
+     * copied, compared, ordered and hashed with single integer operations.
+     * The first byte of the address is the most significant, so addresses
+     * are ordered as they read.
+     * 
+     * Mac addresses are only held as bytes at the boundaries of the node:
+     * in the ESP-NOW calls and callbacks, message bodies and stored peer
+     * records. Use from_bytes() and to_bytes() to convert there.
+     */
+    class MacAddress
+    {
+    private:
+        u64 value;
+
+    public:
+        /**
+         * @brief Construct a new, all zero, mac address object
+         */
+        constexpr MacAddress() : value(0) {}
+
+        /**
+         * @brief Construct a new mac address object from its packed value.
+         * 
+         * @param value The address, in the low 48 bits.
+         */
+        constexpr explicit MacAddress(u64 value) : value(value & 0xFFFFFFFFFFFFULL) {}
+
+        /**
+         * @brief Reads a mac address from its wire format.
+         * 
+         * @param bytes The six bytes of the address.
+         * @return MacAddress The mac address.
+         */
+        static constexpr MacAddress from_bytes(const u8 *bytes)
+        {
+            return MacAddress(((u64)bytes[0] << 40) | ((u64)bytes[1] << 32) |
+                              ((u64)bytes[2] << 24) | ((u64)bytes[3] << 16) |
+                              ((u64)bytes[4] << 8) | (u64)bytes[5]);
+        }
+
+        /**
+         * @brief Writes the mac address in its wire format.
+         * 
+         * @param bytes A buffer of at least six bytes.
+         */
+        constexpr void to_bytes(u8 *bytes) const
+        {
+            for (u8 index = 0; index < 6; index++)
+            {
+                bytes[index] = (u8)(this->value >> (40 - index * 8));
+            }
+        }
+
+        /**
+         * @brief Gets the packed value of the mac address.
+         * 
+         * @return u64 The address, in the low 48 bits.
+         */
+        constexpr u64 to_u64() const { return this->value; }
+
+        /**
+         * @brief Gets a hash of the mac address, for use in hash tables. All
+         * six bytes are mixed into the hash, so it can be reduced to a table
+         * index by masking.
+         * 
+         * @return u32 The hash.
+         */
+        constexpr u32 hash() const
+        {
+            return (u32)(((this->value >> 24) ^ this->value) * 0x9E3779B97F4A7C15ULL >> 32);
+        }
+
+        constexpr bool operator==(const MacAddress &other) const { return this->value == other.value; }
+        constexpr bool operator!=(const MacAddress &other) const { return this->value != other.value; }
+        constexpr bool operator<(const MacAddress &other) const { return this->value < other.value; }
+    };
+
+    constexpr MacAddress BROADCAST_MAC_ADDRESS(0xFFFFFFFFFFFFULL);
+}
+
+#endif
\ No newline at end of file
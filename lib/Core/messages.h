@@ -3,6 +3,8 @@
 
 #include <Arduino.h>
 
+#include "mac_address.h"
+
 namespace thingnet
 {
     /**
@@ -21,12 +23,15 @@ namespace thingnet
 
     /**
      * @brief Server advertisement message, typically follwed by the mac address
-     * of the server node.
+     * of the server node, a byte of advertisement flags, and the load of the
+     * server as a peer count byte and a peer capacity byte.
      */
     const u8 MSG_TYPE_ADVERTISEMENT = 0x10;
 
     /**
-     * @brief Connect message sent by a peer to a server node.
+     * @brief Connect message sent by a peer to a server node. The server
+     * confirms the connection with an ACK carrying the message id of the
+     * connect message once the peer has been admitted.
      */
     const u8 MSG_TYPE_CONNECT = 0x11;
 
@@ -40,6 +45,18 @@ namespace thingnet
      */
     const u8 MSG_TYPE_DATA = 0x13;
 
+    /**
+     * @brief Discovery request broadcast by a peer that is not connected to a
+     * server. Servers respond with a unicast advertisement.
+     */
+    const u8 MSG_TYPE_DISCOVERY = 0x14;
+
+    /**
+     * @brief Advertisement flag that indicates that the advertisement was sent
+     * in response to a discovery request from the recipient.
+     */
+    const u8 MSG_ADVERTISEMENT_FLAG_SOLICITED = 0x01;
+
     /**
      * @brief The boundary (inclusive) for all reserved messages.
      */
@@ -66,7 +83,8 @@ namespace thingnet
      */
     typedef struct PeerMessage
     {
-        u8 sender[6];
+        MacAddress sender;
+        u8 body_length;
         MessagePayload payload;
     } PeerMessage;
 
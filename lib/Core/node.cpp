@@ -6,21 +6,234 @@
 #include <espnow.h>
 
 #include "log.h"
+#include "boot_profiler.h"
+#include "static_vector.h"
 
 #include "messages.h"
 #include "node.h"
 #include "node_profile.h"
 #include "message_handler.h"
+#include "peer.h"
 #include "error_codes.h"
+#include "request.h"
+#include "node_config.h"
 
-static Logger *logger = new Logger("node");
+static constinit Logger logger("node");
 
 namespace thingnet
 {
-    static const u8 __MAX_HANDLER_COUNT = 255;
-    static MessageHandler *__message_handler_list[__MAX_HANDLER_COUNT];
+    static const u16 __MAX_HANDLER_COUNT = NODE_MAX_HANDLERS;
+    static const u8 __MAX_RETIRED_HANDLERS = NODE_MAX_RETIRED_HANDLERS;
+    static const u8 __MAX_PENDING_HANDLER_CHANGES = NODE_MAX_PENDING_HANDLER_CHANGES;
+
+    /**
+     * @brief An immutable copy of the handler list.
+     */
+    typedef utils::StaticVector<MessageHandler *, __MAX_HANDLER_COUNT> HandlerSnapshot;
+
+    /**
+     * @brief The kinds of change that can be made to the handler list.
+     */
+    enum HandlerChangeType
+    {
+        handler_add,
+        handler_remove,
+        handler_retire
+    };
+
+    /**
+     * @brief A change to the handler list that could not be applied when it
+     * was made, because the receive path was still using the spare snapshot.
+     */
+    typedef struct HandlerChange
+    {
+        HandlerChangeType type;
+        MessageHandler *handler;
+    } HandlerChange;
+
+    // The handler list is copy on write. Changes are made to the spare
+    // snapshot, which is then published in place of the current one, so the
+    // receive path can walk the snapshot it started with without locks. The
+    // old snapshot, and any handlers removed with it, are only reused or
+    // deleted once the receive path has left it.
+    static HandlerSnapshot __handler_snapshots[2];
+    static HandlerSnapshot *__handlers = &__handler_snapshots[0];
+    static utils::StaticVector<MessageHandler *, __MAX_RETIRED_HANDLERS> __retired_handlers;
+    // Changes are applied in order, so once one has been queued, later ones
+    // are queued behind it.
+    static utils::StaticVector<HandlerChange, __MAX_PENDING_HANDLER_CHANGES> __pending_handler_changes;
     static MessageHandler *__default_handler = 0;
-    static u8 __message_handler_count = 0;
+    static PeerRouter __peer_router = 0;
+    static void *__peer_router_context = 0;
+
+    // Incremented by the receive path as it enters and leaves a snapshot, so
+    // it is odd while a message is being dispatched.
+    static volatile u32 __dispatch_epoch = 0;
+    // The dispatch epoch when the last snapshot was published.
+    static u32 __publish_epoch = 0;
+
+    // Warnings on the receive and send paths can repeat for every frame, so
+    // they are limited to one per period.
+    static const u32 __WARNING_PERIOD = 1000;
+
+    /**
+     * @brief Determines whether or not the receive path has left the snapshot
+     * that was replaced by the last publish.
+     *
+     * @return true If the old snapshot is no longer in use.
+     * @return false If a message is still being dispatched from it.
+     */
+    static bool __is_grace_period_complete()
+    {
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+        return (__publish_epoch & 1) == 0 || __dispatch_epoch != __publish_epoch;
+    }
+
+    /**
+     * @brief Determines whether or not a change to the handler list can be
+     * made now. A change made from within a dispatch (by a handler, for
+     * example), or while one is in progress, has to wait for the receive path
+     * to leave the spare snapshot. Waiting is never done in place, as the
+     * change may be made by the dispatch being waited for.
+     *
+     * @return true If the handler list can be changed.
+     * @return false If the change has to be queued.
+     */
+    static bool __can_change_handlers()
+    {
+        return __pending_handler_changes.is_empty() && __is_grace_period_complete();
+    }
+
+    /**
+     * @brief Prepares the spare snapshot for changes, by copying the current
+     * handler list into it. The grace period must be complete.
+     *
+     * @return HandlerSnapshot* The snapshot to change.
+     */
+    static HandlerSnapshot *__begin_handler_update()
+    {
+        HandlerSnapshot *current = __handlers;
+        HandlerSnapshot *next = current == &__handler_snapshots[0] ? &__handler_snapshots[1]
+                                                                    : &__handler_snapshots[0];
+        *next = *current;
+        return next;
+    }
+
+    /**
+     * @brief Publishes a snapshot as the current handler list.
+     *
+     * @param next The snapshot to publish.
+     */
+    static void __publish_handlers(HandlerSnapshot *next)
+    {
+        __atomic_store_n(&__handlers, next, __ATOMIC_SEQ_CST);
+        __publish_epoch = __dispatch_epoch;
+    }
+
+    /**
+     * @brief Deletes retired handlers, if the receive path can no longer be
+     * using them.
+     */
+    static void __reclaim_handlers()
+    {
+        if (__retired_handlers.is_empty() || !__is_grace_period_complete())
+        {
+            return;
+        }
+
+        for (MessageHandler *handler : __retired_handlers)
+        {
+            delete handler;
+        }
+        __retired_handlers.clear();
+    }
+
+    /**
+     * @brief Queues a change to the handler list, to be applied from the main
+     * loop.
+     *
+     * @param type The type of change.
+     * @param handler The handler to change.
+     * @return int A non success value will be returned if the change queue is
+     * full.
+     */
+    static int __defer_handler_change(HandlerChangeType type, MessageHandler *handler)
+    {
+        HandlerChange change;
+        change.type = type;
+        change.handler = handler;
+        if (__pending_handler_changes.push_back(change) != 0)
+        {
+            LOG_ERROR(logger, "Cannot defer handler change - maximum pending change limit has been reached");
+            return ERR_HANDLER_LIMIT_EXCEEDED;
+        }
+
+        LOG_DEBUG(logger, "Handler change [%d] deferred until dispatch completes", type);
+        return RESULT_OK;
+    }
+
+    /**
+     * @brief Applies a queued change to the handler list, if the receive path
+     * is no longer using the spare snapshot.
+     *
+     * @param change The change to apply.
+     * @return true If the change was applied (or could never be applied).
+     * @return false If the change has to wait.
+     */
+    static bool __apply_handler_change(const HandlerChange &change)
+    {
+        if (!__is_grace_period_complete())
+        {
+            return false;
+        }
+
+        if (change.type == handler_retire && __retired_handlers.is_full())
+        {
+            __reclaim_handlers();
+            if (__retired_handlers.is_full())
+            {
+                return false;
+            }
+        }
+
+        HandlerSnapshot *next = __begin_handler_update();
+        if (change.type == handler_add)
+        {
+            if (next->push_back(change.handler) != 0)
+            {
+                LOG_ERROR(logger, "Dropping deferred handler - maximum handler limit has been reached");
+                return true;
+            }
+        }
+        else
+        {
+            next->remove(change.handler);
+        }
+        __publish_handlers(next);
+
+        if (change.type == handler_retire)
+        {
+            __retired_handlers.push_back(change.handler);
+        }
+
+        return true;
+    }
+
+    /**
+     * @brief Applies queued changes to the handler list, in order, for as long
+     * as the receive path allows.
+     */
+    static void __apply_handler_changes()
+    {
+        while (!__pending_handler_changes.is_empty())
+        {
+            if (!__apply_handler_change(__pending_handler_changes[0]))
+            {
+                return;
+            }
+            __pending_handler_changes.erase(0);
+        }
+    }
 
     /**
      * @brief Handles data send confirmation.
@@ -31,6 +244,17 @@ namespace thingnet
     void __on_data_sent(u8 *mac_addr, u8 status)
     {
         LOG_TRACE(logger, "Message delivery ack to [%s] [%s]", LOG_FORMAT_MAC(mac_addr), status == 0 ? "ok" : "err");
+        if (status == 0)
+        {
+            return;
+        }
+
+        NodeProfile *profile = Node::get_instance().get_profile();
+        Peer *peer = profile != 0 ? profile->find_peer(MacAddress::from_bytes(mac_addr)) : 0;
+        if (peer != 0)
+        {
+            peer->record_send_failure();
+        }
     }
 
     /**
@@ -43,6 +267,13 @@ namespace thingnet
     void __on_data_received(u8 *mac_addr, u8 *data, u8 length)
     {
         LOG_TRACE(logger, "Processing message from peer");
+        if (length < 3)
+        {
+            LOG_RATE_LIMITED(LOG_WARN, logger, __WARNING_PERIOD,
+                             "Ignoring truncated message from [%s]", LOG_FORMAT_MAC(mac_addr));
+            return;
+        }
+
         LOG_DEBUG(logger, "Received [%02x|%02x:%02x] + [%d] bytes from [%s]",
                   data[0],
                   data[1],
@@ -51,16 +282,24 @@ namespace thingnet
                   LOG_FORMAT_MAC(mac_addr));
 
         PeerMessage message;
-        memcpy(message.sender, mac_addr, 6);
+        message.sender = MacAddress::from_bytes(mac_addr);
+        message.body_length = length - 3;
         memcpy(&message.payload.type, data, 1);
         memcpy(&message.payload.message_id, data + 1, 2);
         memcpy(&message.payload.body, data + 3, length - 3);
 
+        // Responses to requests are still passed on to the handlers, which may
+        // track the peer's state from them.
+        RequestManager::get_instance().process_response(&message);
+
         bool processing_complete = false;
         LOG_TRACE(logger, "Starting handler chain");
-        for (int index = 0; index < __message_handler_count; index++)
+        __dispatch_epoch = __dispatch_epoch + 1;
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+        const HandlerSnapshot *snapshot = __atomic_load_n(&__handlers, __ATOMIC_SEQ_CST);
+        for (int index = 0; index < snapshot->size(); index++)
         {
-            MessageHandler *handler = __message_handler_list[index];
+            MessageHandler *handler = (*snapshot)[index];
             if (!handler->can_handle(&message))
             {
                 LOG_TRACE(logger, "Handler [%d] will not handle message", index);
@@ -79,11 +318,32 @@ namespace thingnet
             else if (result == ProcessingResult::error)
             {
                 processing_complete = true;
-                LOG_WARN(logger, "Error processing message by processor [%d]", index);
+                LOG_RATE_LIMITED(LOG_WARN, logger, __WARNING_PERIOD,
+                                 "Error processing message by processor [%d]", index);
                 break;
             }
         }
 
+        if (!processing_complete && __peer_router != 0)
+        {
+            LOG_TRACE(logger, "Routing message to peers");
+            ProcessingResult result = __peer_router(__peer_router_context, &message);
+
+            if (result == ProcessingResult::handled)
+            {
+                processing_complete = true;
+            }
+            else if (result == ProcessingResult::error)
+            {
+                processing_complete = true;
+                LOG_RATE_LIMITED(LOG_WARN, logger, __WARNING_PERIOD,
+                                 "Error processing message by peer [%s]", LOG_FORMAT_MAC(message.sender));
+            }
+        }
+
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+        __dispatch_epoch = __dispatch_epoch + 1;
+
         if (!processing_complete)
         {
             LOG_TRACE(logger, "Handler chain is still not complete");
@@ -97,17 +357,20 @@ namespace thingnet
 
                     if (result == ProcessingResult::error)
                     {
-                        LOG_WARN(logger, "Error processing message by default handler");
+                        LOG_RATE_LIMITED(LOG_WARN, logger, __WARNING_PERIOD,
+                                         "Error processing message by default handler");
                     }
                 }
                 else
                 {
-                    LOG_WARN(logger, "Default handler will not handle message");
+                    LOG_RATE_LIMITED(LOG_WARN, logger, __WARNING_PERIOD,
+                                     "Default handler will not handle message");
                 }
             }
             else
             {
-                LOG_WARN(logger, "Default handler has not been set. Skipping.");
+                LOG_RATE_LIMITED(LOG_WARN, logger, __WARNING_PERIOD,
+                                 "Default handler has not been set. Skipping.");
             }
         }
 
@@ -117,16 +380,24 @@ namespace thingnet
     Node::Node()
     {
         this->profile = 0;
+        this->message_id = 0;
+        this->is_initialized = false;
+        this->is_radio_started = false;
     }
 
     Node::~Node()
     {
         // Loop through all handlers and delete them.
-        for (int index = 0; index < __message_handler_count; index++)
+        for (MessageHandler *handler : *__handlers)
         {
-            delete __message_handler_list[index];
+            delete handler;
         }
-        __message_handler_count = 0;
+        __handlers->clear();
+        for (MessageHandler *handler : __retired_handlers)
+        {
+            delete handler;
+        }
+        __retired_handlers.clear();
     }
 
     Node &Node::get_instance()
@@ -135,21 +406,27 @@ namespace thingnet
         return instance;
     }
 
-    int Node::init()
+    int Node::start_radio()
     {
-        LOG_TRACE(logger, "Initializing node");
-        if (this->is_initialized)
+        LOG_TRACE(logger, "Starting radio");
+        if (this->is_radio_started)
         {
-            LOG_WARN(logger, "Node has already been initialized");
+            LOG_WARN(logger, "Radio has already been started");
             return RESULT_DUPLICATE;
         }
 
+        BootProfiler &profiler = BootProfiler::get_instance();
+
         LOG_TRACE(logger, "Reading current mac address(es)");
-        WiFi.macAddress(this->sta_mac_address);
-        WiFi.softAPmacAddress(this->ap_mac_address);
+        u8 mac_address[6];
+        WiFi.macAddress(mac_address);
+        this->sta_mac_address = MacAddress::from_bytes(mac_address);
+        WiFi.softAPmacAddress(mac_address);
+        this->ap_mac_address = MacAddress::from_bytes(mac_address);
 
         LOG_DEBUG(logger, "Setting wifi to station mode");
         WiFi.mode(WIFI_AP_STA);
+        profiler.mark("wifi-mode");
 
         LOG_TRACE(logger, "Initializing ESP-NOW");
         if (esp_now_init() != 0)
@@ -162,6 +439,30 @@ namespace thingnet
         LOG_TRACE(logger, "Registering send/receive callbacks");
         esp_now_register_send_cb(__on_data_sent);
         esp_now_register_recv_cb(__on_data_received);
+        profiler.mark("esp-now");
+
+        this->is_radio_started = true;
+
+        return RESULT_OK;
+    }
+
+    int Node::init()
+    {
+        LOG_TRACE(logger, "Initializing node");
+        if (this->is_initialized)
+        {
+            LOG_WARN(logger, "Node has already been initialized");
+            return RESULT_DUPLICATE;
+        }
+
+        if (!this->is_radio_started)
+        {
+            int result = this->start_radio();
+            if (result != RESULT_OK)
+            {
+                return result;
+            }
+        }
 
         LOG_TRACE(logger, "Initializing node profile");
         if (this->profile == 0)
@@ -170,6 +471,7 @@ namespace thingnet
             return ERR_NODE_PROFILE_NOT_SET;
         }
         ASSERT_OK(this->profile->init());
+        BootProfiler::get_instance().mark("profile-init");
 
         this->is_initialized = true;
 
@@ -202,6 +504,16 @@ namespace thingnet
         return this->profile;
     }
 
+    u32 Node::get_memory_usage()
+    {
+        return sizeof(Node) +
+               sizeof(__handler_snapshots) +
+               sizeof(__retired_handlers) +
+               sizeof(__pending_handler_changes) +
+               sizeof(RequestManager) +
+               sizeof(CoroutineFramePool);
+    }
+
     int Node::add_handler(MessageHandler *handler)
     {
         LOG_TRACE(logger, "Registering message handler");
@@ -212,17 +524,23 @@ namespace thingnet
             return ERR_NODE_NOT_INITIALIZED;
         }
 
-        if (__message_handler_count >= __MAX_HANDLER_COUNT)
+        if (__handlers->is_full())
         {
             LOG_ERROR(logger, "Cannot add handler - maximum handler limit has been reached");
             return ERR_HANDLER_LIMIT_EXCEEDED;
         }
 
+        if (!__can_change_handlers())
+        {
+            return __defer_handler_change(handler_add, handler);
+        }
+
         // Add handler to the end of the list.
-        __message_handler_list[__message_handler_count] = handler;
-        __message_handler_count++;
+        HandlerSnapshot *next = __begin_handler_update();
+        next->push_back(handler);
+        __publish_handlers(next);
 
-        LOG_DEBUG(logger, "Handler added successfully. Total handlers: [%d]", __message_handler_count);
+        LOG_DEBUG(logger, "Handler added successfully. Total handlers: [%d]", next->size());
 
         return RESULT_OK;
     }
@@ -237,34 +555,56 @@ namespace thingnet
             return ERR_NODE_NOT_INITIALIZED;
         }
 
-        u8 find_count = 0;
-        for (u8 handler_index = 0; handler_index < __message_handler_count; handler_index++)
+        if (!__can_change_handlers())
         {
-            if (__message_handler_list[handler_index] == handler)
+            if (!__handlers->contains(handler))
             {
-                find_count++;
-            }
-            else
-            {
-                __message_handler_list[handler_index - find_count] =
-                    __message_handler_list[handler_index];
+                LOG_WARN(logger, "Could not find message handler");
+                return RESULT_NO_EXIST;
             }
+            return __defer_handler_change(handler_remove, handler);
         }
 
+        HandlerSnapshot *next = __begin_handler_update();
+        u16 find_count = next->remove(handler);
         if (find_count == 0)
         {
             LOG_WARN(logger, "Could not find message handler");
             return RESULT_NO_EXIST;
         }
-        __message_handler_count -= find_count;
+        __publish_handlers(next);
 
         LOG_TRACE(logger, "Handler(s) removed successfully [%d]. Total handlers: [%d]",
                   find_count,
-                  __message_handler_count);
+                  next->size());
 
         return RESULT_OK;
     }
 
+    int Node::retire_handler(MessageHandler *handler)
+    {
+        // A handler that is no longer registered may still be in use from an
+        // older snapshot, so it is retired either way.
+        if (__can_change_handlers() && __retired_handlers.is_full())
+        {
+            __reclaim_handlers();
+        }
+
+        if (!__can_change_handlers() || __retired_handlers.is_full())
+        {
+            int result = __handlers->contains(handler) ? RESULT_OK : RESULT_NO_EXIST;
+            int defer_result = __defer_handler_change(handler_retire, handler);
+            return defer_result != RESULT_OK ? defer_result : result;
+        }
+
+        // Peers that are reached through the peer router are retired without
+        // ever being registered.
+        int result = __handlers->contains(handler) ? this->remove_handler(handler) : RESULT_NO_EXIST;
+        __retired_handlers.push_back(handler);
+
+        return result;
+    }
+
     int Node::set_node_profile(NodeProfile *profile)
     {
         LOG_TRACE(logger, "Registering node profile");
@@ -291,7 +631,16 @@ namespace thingnet
         return RESULT_OK;
     }
 
-    bool Node::has_mac_address(u8 *input_mac)
+    int Node::set_peer_router(PeerRouter router, void *context)
+    {
+        LOG_TRACE(logger, "Setting peer router");
+        __peer_router = router;
+        __peer_router_context = context;
+
+        return RESULT_OK;
+    }
+
+    bool Node::has_mac_address(MacAddress input_mac)
     {
         if (!this->is_initialized)
         {
@@ -299,8 +648,7 @@ namespace thingnet
             return false;
         }
 
-        return memcmp(this->sta_mac_address, input_mac, 6) == 0 ||
-               memcmp(this->ap_mac_address, input_mac, 6) == 0;
+        return this->sta_mac_address == input_mac || this->ap_mac_address == input_mac;
     }
 
     int Node::update()
@@ -312,21 +660,25 @@ namespace thingnet
         }
 
         ASSERT_OK(profile->update());
+        RequestManager::get_instance().update();
+        __apply_handler_changes();
+        __reclaim_handlers();
         return RESULT_OK;
     }
 
-    int Node::read_mac_address(u8 *buffer)
+    MacAddress Node::get_mac_address()
     {
-        memcpy(buffer, this->ap_mac_address, 6);
-        return RESULT_OK;
+        return this->ap_mac_address;
     }
 
-    int Node::register_peer(u8 *peer_address, esp_now_role role)
+    int Node::register_peer(MacAddress peer_address, esp_now_role role)
     {
         LOG_TRACE(logger, "Registering new peer");
+        u8 peer_bytes[6];
+        peer_address.to_bytes(peer_bytes);
 
         LOG_TRACE(logger, "Checking if peer exists: [%s]", LOG_FORMAT_MAC(peer_address));
-        if (esp_now_is_peer_exist(peer_address))
+        if (esp_now_is_peer_exist(peer_bytes))
         {
             LOG_WARN(logger, "Peer has already been registered: [%s]",
                      LOG_FORMAT_MAC(peer_address));
@@ -334,7 +686,7 @@ namespace thingnet
         }
 
         /// TODO: Add enhanced error checking (ESP32 only)
-        int status = esp_now_add_peer(peer_address, role, 1, NULL, 0);
+        int status = esp_now_add_peer(peer_bytes, role, 1, NULL, 0);
         if (status)
         {
             LOG_ERROR(logger, "Peer registration returned non zero value: [%d]", status);
@@ -345,12 +697,14 @@ namespace thingnet
         return RESULT_OK;
     }
 
-    int Node::unregister_peer(u8 *peer_address)
+    int Node::unregister_peer(MacAddress peer_address)
     {
         LOG_TRACE(logger, "Unregistering existing peer");
+        u8 peer_bytes[6];
+        peer_address.to_bytes(peer_bytes);
 
         LOG_TRACE(logger, "Checking if peer exists: [%s]", LOG_FORMAT_MAC(peer_address));
-        if (!esp_now_is_peer_exist(peer_address))
+        if (!esp_now_is_peer_exist(peer_bytes))
         {
             LOG_WARN(logger, "Peer has not been registered: [%s]",
                      LOG_FORMAT_MAC(peer_address));
@@ -358,7 +712,7 @@ namespace thingnet
         }
 
         /// TODO: Add enhanced error checking (ESP32 only)
-        int status = esp_now_del_peer(peer_address);
+        int status = esp_now_del_peer(peer_bytes);
         if (status)
         {
             LOG_ERROR(logger, "Peer unregistration returned non zero value: [%d]", status);
@@ -369,7 +723,7 @@ namespace thingnet
         return RESULT_OK;
     }
 
-    int Node::send_message(u8 *destination, MessagePayload *payload, u8 data_size)
+    int Node::send_message(MacAddress destination, MessagePayload *payload, u8 data_size)
     {
         u8 payload_bytes[250];
         u16 message_id = payload->message_id == 0 ? this->get_next_message_id()
@@ -386,8 +740,31 @@ namespace thingnet
                   data_size,
                   LOG_FORMAT_MAC(destination));
 
-        esp_now_send(destination, (u8 *)&payload_bytes, data_size + 3);
+        u8 destination_bytes[6];
+        destination.to_bytes(destination_bytes);
+        int status = esp_now_send(destination_bytes, (u8 *)&payload_bytes, data_size + 3);
+
+        static bool is_first_frame = true;
+        if (is_first_frame)
+        {
+            is_first_frame = false;
+            BootProfiler::get_instance().mark("first-frame");
+        }
+
+        if (status != 0)
+        {
+            LOG_RATE_LIMITED(LOG_WARN, logger, __WARNING_PERIOD,
+                             "Send to [%s] returned non zero value: [%d]",
+                             LOG_FORMAT_MAC(destination), status);
+            return ERR_SEND_FAILED;
+        }
 
         return RESULT_OK;
     }
+
+    RequestAwaitable Node::request(MacAddress destination, MessagePayload *payload, u8 data_size,
+                                   u32 timeout, PeerMessage *response)
+    {
+        return RequestAwaitable(destination, payload, data_size, timeout, response);
+    }
 }
\ No newline at end of file
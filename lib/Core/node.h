@@ -5,7 +5,10 @@
 #include <espnow.h>
 
 #include "timer.h"
+#include "mac_address.h"
 #include "messages.h"
+#include "message_handler.h"
+#include "request.h"
 
 // Forward declaration to prevent circular references.
 // See: https://stackoverflow.com/questions/625799/resolve-build-errors-due-to-circular-dependency-amongst-classes
@@ -23,6 +26,16 @@ using namespace thingnet::message_handlers;
 
 namespace thingnet
 {
+    /**
+     * @brief Routes a received message to the peer that it is from. See
+     * Node::set_peer_router().
+     * 
+     * @param context The context given when the router was set.
+     * @param message A pointer to the received message.
+     * @return ProcessingResult The result of processing the message, or
+     * ProcessingResult::chain if the message is not from a routed peer.
+     */
+    typedef ProcessingResult (*PeerRouter)(void *context, PeerMessage *message);
 
     /**
      * @brief Represents a node that can communicate using ESP-NOW
@@ -30,10 +43,11 @@ namespace thingnet
     class Node
     {
     private:
-        u8 sta_mac_address[6];
-        u8 ap_mac_address[6];
+        MacAddress sta_mac_address;
+        MacAddress ap_mac_address;
         u16 message_id;
         bool is_initialized;
+        bool is_radio_started;
         NodeProfile *profile;
 
         Node();
@@ -47,6 +61,18 @@ namespace thingnet
          */
         static Node &get_instance();
 
+        /**
+         * @brief Brings up WiFi and ESP-NOW, without initializing the node
+         * profile. This allows the radio to be started before the node profile
+         * has been determined, overlapping the radio start up with other
+         * initialization work. Calling this method is optional, as init() will
+         * start the radio if it has not already been started.
+         *
+         * @return int A non success value will be returned if the add operation
+         * resulted in an error. See error codes for more information.
+         */
+        int start_radio();
+
         /**
          * @brief Initializes the node and returns a non-zero value if the
          * initialization fails.
@@ -72,6 +98,15 @@ namespace thingnet
          */
         NodeProfile *get_profile();
 
+        /**
+         * @brief Gets the memory used by the node and its tables (handlers,
+         * pending requests and coroutine frames), not including the profile.
+         * The tables are sized at build time. See node_config.h.
+         * 
+         * @return u32 The memory used, in bytes.
+         */
+        u32 get_memory_usage();
+
         /**
          * @brief Adds a message handler to the end of the list of available
          * handlers for the node. 
@@ -84,7 +119,9 @@ namespace thingnet
 
         /**
          * @brief Removes the handler from the list of handlers and compacts the
-         * handler list.
+         * handler list. A message that is already being dispatched may still
+         * reach the handler, so handlers that are to be deleted should be
+         * retired instead.
          * 
          * @param handler The handler to remove
          * @return int A non success value will be returned if the add operation
@@ -92,6 +129,18 @@ namespace thingnet
          */
         int remove_handler(MessageHandler *handler);
 
+        /**
+         * @brief Removes the handler from the list of handlers, and deletes it
+         * once no message that is being dispatched can still be using it. The
+         * handler is deleted even if it was not registered, and must not be
+         * used by the caller after this call.
+         * 
+         * @param handler The handler to retire
+         * @return int A non success value will be returned if the handler was
+         * not registered. See error codes for more information.
+         */
+        int retire_handler(MessageHandler *handler);
+
         /**
          * @brief Sets the node profile for the current node. The node profile
          * is responsible for:
@@ -106,14 +155,32 @@ namespace thingnet
         int set_node_profile(NodeProfile *profile);
 
         /**
-         * @brief Matches the input buffer against the mac address of the node. 
+         * @brief Sets the function that passes received messages to the peers
+         * of the node profile, for profiles that do not register their peers
+         * as message handlers. The router is called after the handler chain
+         * and before the default handler, from within the dispatch, so peers
+         * that are retired (see retire_handler) are not deleted while it may
+         * be using them. This allows a profile that knows the type of its
+         * peers at build time to call them without virtual dispatch. See
+         * StaticNodeProfile.
+         * 
+         * @param router The router, or a null value to clear it.
+         * @param context The value passed to the router, typically the
+         * profile.
+         * @return int A non success value will be returned if the operation
+         * resulted in an error. See error codes for more information.
+         */
+        int set_peer_router(PeerRouter router, void *context);
+
+        /**
+         * @brief Matches the input against the mac addresses of the node. 
          * 
          * @param input_mac The mac address to compare with the current node.
          * @return true If the input mac address matches the node's mac address
          * @return false If the input mac address odes not match, or if the node
          * has not been initialized.
          */
-        bool has_mac_address(u8 *input_mac);
+        bool has_mac_address(MacAddress input_mac);
 
         /**
          * @brief Allows the node to update itself. This method will typically
@@ -125,13 +192,11 @@ namespace thingnet
         int update();
 
         /**
-         * @brief Copies the mac address of the node into the given * buffer.
+         * @brief Gets the mac address of the node, as advertised to peers.
          * 
-         * @param buffer A buffer into which the mac address will be copied.
-         * @return int A non success value will be returned if the add operation
-         * resulted in an error. See error codes for more information.
+         * @return MacAddress The mac address of the node.
          */
-        int read_mac_address(u8 *buffer);
+        MacAddress get_mac_address();
 
         /**
          * @brief Registers a new peer with the node. The peer will not be added if
@@ -142,7 +207,7 @@ namespace thingnet
          * @return int A non success value will be returned if the add operation
          * resulted in an error. See error codes for more information.
          */
-        int register_peer(u8 *peer_address, esp_now_role role);
+        int register_peer(MacAddress peer_address, esp_now_role role);
 
         /**
          * @brief Unregisters an existing peer from the node. This method will have
@@ -152,7 +217,7 @@ namespace thingnet
          * @return int A non success value will be returned if the add operation
          * resulted in an error. See error codes for more information.
          */
-        int unregister_peer(u8 *peer_address);
+        int unregister_peer(MacAddress peer_address);
 
         /**
          * @brief Sends a message to the specified peer.
@@ -163,7 +228,27 @@ namespace thingnet
          * @return int A non success value will be returned if the add operation
          * resulted in an error. See error codes for more information.
          */
-        int send_message(u8 *destination, MessagePayload *payload, u8 data_size);
+        int send_message(MacAddress destination, MessagePayload *payload, u8 data_size);
+
+        /**
+         * @brief Sends a request to the specified peer, for use from within a
+         * coroutine (see Task). The coroutine is suspended until the peer
+         * responds with an ACK or NACK carrying the message id of the request,
+         * or the request times out, and is resumed from update(). The result
+         * of the co_await is RESULT_OK if a response was received, or an error
+         * code otherwise.
+         * 
+         * @param destination The mac address of the peer
+         * @param payload A pointer to the request payload. The payload must
+         * remain valid until the request is sent.
+         * @param data_size The length of the payload, not including headers
+         * @param timeout The time to wait for a response, in milliseconds
+         * @param response Where the response will be copied, or a null value
+         * if the response is not required.
+         * @return RequestAwaitable The request, to be awaited.
+         */
+        RequestAwaitable request(MacAddress destination, MessagePayload *payload, u8 data_size,
+                                 u32 timeout, PeerMessage *response = 0);
 
         // Singleton implementation.
         // See: https://stackoverflow.com/questions/1008019/c-singleton-design-pattern
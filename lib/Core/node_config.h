@@ -0,0 +1,92 @@
+#ifndef __NODE_CONFIG_H
+#define __NODE_CONFIG_H
+
+// Capacities of the tables used by the networking stack. All of the tables
+// are allocated up front, so each firmware image can size them to the
+// deployment by overriding these values in its build flags. For example, a
+// client that only ever connects to one server could use:
+//   -D NODE_MAX_PEERS=2 -D NODE_MAX_HANDLERS=4 -D EVENT_MAX_LISTENERS=4
+//
+// The memory used by the stack is logged at boot.
+
+// The maximum number of peers held by a node profile. Every peer is also
+// registered with the radio, so a profile holds at most NODE_RADIO_MAX_PEERS
+// - 1 peers at once, whatever this is set to.
+#ifndef NODE_MAX_PEERS
+#define NODE_MAX_PEERS 50
+#endif
+
+// The number of entries in the ESP-NOW peer table (20 on the ESP8266, with
+// unencrypted peers). One entry is taken by the broadcast address.
+#ifndef NODE_RADIO_MAX_PEERS
+#define NODE_RADIO_MAX_PEERS 20
+#endif
+
+// The maximum number of message handlers registered with the node. Each
+// peer is also a handler, unless the profile routes messages to its peers
+// (see StaticNodeProfile).
+#ifndef NODE_MAX_HANDLERS
+#define NODE_MAX_HANDLERS 64
+#endif
+
+// The maximum number of removed handlers waiting to be deleted.
+#ifndef NODE_MAX_RETIRED_HANDLERS
+#define NODE_MAX_RETIRED_HANDLERS 8
+#endif
+
+// The maximum number of handler changes made while a message is being
+// dispatched, which wait for the main loop to be applied.
+#ifndef NODE_MAX_PENDING_HANDLER_CHANGES
+#define NODE_MAX_PENDING_HANDLER_CHANGES 8
+#endif
+
+// The maximum number of requests awaiting a response.
+#ifndef NODE_MAX_PENDING_REQUESTS
+#define NODE_MAX_PENDING_REQUESTS 16
+#endif
+
+// The number of coroutine frames that requests can be awaited from, which is
+// the number of coroutines that can be running at once.
+#ifndef NODE_MAX_COROUTINE_FRAMES
+#define NODE_MAX_COROUTINE_FRAMES 4
+#endif
+
+// The size of each coroutine frame, in bytes. Coroutines with larger frames
+// cannot be started. The default fits a coroutine that keeps a request
+// payload and its response in the frame, see Task.
+#ifndef NODE_COROUTINE_FRAME_SIZE
+#define NODE_COROUTINE_FRAME_SIZE 768
+#endif
+
+// The maximum number of listeners per event emitter.
+#ifndef EVENT_MAX_LISTENERS
+#define EVENT_MAX_LISTENERS 32
+#endif
+
+// The maximum number of events waiting in a deferred event queue.
+#ifndef EVENT_MAX_DEFERRED_EVENTS
+#define EVENT_MAX_DEFERRED_EVENTS 16
+#endif
+
+static_assert(NODE_MAX_PEERS > 0 && NODE_MAX_PEERS <= 255,
+              "Peer counts are sent and stored as a single byte");
+static_assert(NODE_RADIO_MAX_PEERS > 1 && NODE_RADIO_MAX_PEERS <= 255,
+              "The radio must hold the broadcast address and at least one peer");
+static_assert(NODE_MAX_HANDLERS >= NODE_MAX_PEERS,
+              "Every peer must be able to register as a message handler");
+static_assert(NODE_MAX_RETIRED_HANDLERS > 0, "At least one handler must be retirable");
+static_assert(NODE_MAX_PENDING_HANDLER_CHANGES > 0 && NODE_MAX_PENDING_HANDLER_CHANGES <= 255,
+              "Pending handler change count out of range");
+static_assert(NODE_MAX_PENDING_REQUESTS > 0 && NODE_MAX_PENDING_REQUESTS <= 255,
+              "Pending request count out of range");
+static_assert(NODE_MAX_COROUTINE_FRAMES > 0 && NODE_MAX_COROUTINE_FRAMES <= 255,
+              "Coroutine frame count out of range");
+static_assert(NODE_COROUTINE_FRAME_SIZE > 0 && NODE_COROUTINE_FRAME_SIZE <= 0xFFFF &&
+                  NODE_COROUTINE_FRAME_SIZE % 8 == 0,
+              "Coroutine frame size must be a multiple of 8, so every frame is aligned");
+static_assert(EVENT_MAX_LISTENERS > 0 && EVENT_MAX_LISTENERS <= 0xFFFF,
+              "Listener count out of range");
+static_assert(EVENT_MAX_DEFERRED_EVENTS > 0 && EVENT_MAX_DEFERRED_EVENTS <= 255,
+              "Deferred event count out of range");
+
+#endif
\ No newline at end of file
@@ -1,6 +1,7 @@
 #include <Arduino.h>
 #include "log.h"
 #include "timer.h"
+#include "boot_profiler.h"
 
 #include "error_codes.h"
 #include "messages.h"
@@ -12,23 +13,32 @@
 
 using namespace thingnet::utils;
 
-static Logger *logger = new Logger("prof");
+static constinit Logger logger("prof");
 
 namespace thingnet
 {
-    static const int __DEFAULT_PRUNE_PERIOD = 300000;
-    static const int __PEER_ADDED_EVENT = 0x01;
-    static const int __PEER_REMOVED_EVENT = 0x02;
+    // Pruning only compares timestamps, so it runs often enough for adaptive
+    // peer timeouts to take effect within a second.
+    static const int __DEFAULT_PRUNE_PERIOD = 1000;
+    static const int __DEFAULT_CHECKPOINT_PERIOD = 30000;
+    static const u32 __RESTORE_PROBE_TIMEOUT = 3000;
 
     NodeProfile::NodeProfile(Node *node)
     {
         this->node = node;
         this->prune_period = __DEFAULT_PRUNE_PERIOD;
-        this->peer_count = 0;
         this->prune_timer = 0;
-        this->peer_added = new EventEmitter<PeerListEventData>(__PEER_ADDED_EVENT);
-        this->peer_removed = new EventEmitter<PeerListEventData>(__PEER_REMOVED_EVENT);
+        this->peer_added = new EventEmitter<PeerListEventData>(PEER_ADDED_EVENT);
+        this->peer_removed = new EventEmitter<PeerListEventData>(PEER_REMOVED_EVENT);
+        this->event_queue = 0;
+        this->is_deferring_events = false;
         this->is_initialized = false;
+        this->is_routing_peers = false;
+        this->peer_store = 0;
+        this->checkpoint_timer = 0;
+        this->checkpoint_period = __DEFAULT_CHECKPOINT_PERIOD;
+        this->is_restore_pending = false;
+        this->is_checkpoint_pending = false;
     }
 
     NodeProfile::~NodeProfile()
@@ -49,9 +59,86 @@ namespace thingnet
         return RESULT_OK;
     }
 
+    int NodeProfile::set_peer_store(PeerStore *store)
+    {
+        if (this->is_initialized)
+        {
+            LOG_ERROR(logger, "Node profile has already been initialized");
+            return RESULT_DUPLICATE;
+        }
+
+        this->peer_store = store;
+
+        return RESULT_OK;
+    }
+
+    int NodeProfile::set_checkpoint_period(u32 period)
+    {
+        if (!this->is_initialized)
+        {
+            LOG_WARN(logger, "Node profile has not been initialized");
+            return ERR_NODE_PROFILE_NOT_INITIALIZED;
+        }
+
+        this->checkpoint_period = period;
+        this->checkpoint_timer->set_duration(period);
+
+        return RESULT_OK;
+    }
+
+    int NodeProfile::set_deferred_events(bool is_deferred)
+    {
+        if (is_deferred && this->event_queue == 0)
+        {
+            this->event_queue = new DeferredEventQueue<PeerListEventData>();
+        }
+        else if (!is_deferred && this->event_queue != 0)
+        {
+            // Deliver anything that was queued before switching modes.
+            this->event_queue->drain();
+        }
+
+        this->is_deferring_events = is_deferred;
+        DeferredEventQueue<PeerListEventData> *queue = is_deferred ? this->event_queue : 0;
+        this->peer_added->set_deferred(queue);
+        this->peer_removed->set_deferred(queue);
+
+        return RESULT_OK;
+    }
+
+    void NodeProfile::set_peer_events(EventEmitter<PeerListEventData> *peer_added,
+                                      EventEmitter<PeerListEventData> *peer_removed)
+    {
+        delete this->peer_added;
+        delete this->peer_removed;
+        this->peer_added = peer_added;
+        this->peer_removed = peer_removed;
+
+        DeferredEventQueue<PeerListEventData> *queue = this->is_deferring_events ? this->event_queue : 0;
+        this->peer_added->set_deferred(queue);
+        this->peer_removed->set_deferred(queue);
+    }
+
     int NodeProfile::get_peer_count()
     {
-        return this->peer_count;
+        return this->peers.size();
+    }
+
+    PeerRange NodeProfile::get_peers()
+    {
+        return PeerRange(this->peers.begin(), this->peers.end());
+    }
+
+    u32 NodeProfile::get_memory_usage()
+    {
+        u32 usage = sizeof(NodeProfile) +
+                    sizeof(*this->peer_added) +
+                    sizeof(*this->peer_removed);
+        if (this->event_queue != 0)
+        {
+            usage += sizeof(*this->event_queue);
+        }
+        return usage;
     }
 
     int NodeProfile::init()
@@ -67,6 +154,14 @@ namespace thingnet
         this->prune_timer = new Timer(this->prune_period, true);
         this->prune_timer->start();
 
+        LOG_TRACE(logger, "Starting checkpoint timer");
+        this->checkpoint_timer = new Timer(this->checkpoint_period, true);
+        this->checkpoint_timer->start();
+
+        // Peers are restored on the first update, once the node has been
+        // initialized and can accept handlers.
+        this->is_restore_pending = this->peer_store != 0;
+
         this->is_initialized = true;
 
         return RESULT_OK;
@@ -95,40 +190,186 @@ namespace thingnet
         else
         {
             LOG_TRACE(logger, "New peer created");
-            PeerListEventData peer_data = PeerListEventData(peer);
+            this->add_peer(peer);
+        }
 
-            LOG_DEBUG(logger, "Adding peer [%s] to internal registry",
-                      LOG_FORMAT_MAC(peer_data.peer_mac_address));
+        LOG_TRACE(logger, "Peer registration process completed");
+        return ProcessingResult::handled;
+    }
 
-            int result = this->node->register_peer(peer_data.peer_mac_address,
-                                                   ESP_NOW_ROLE_COMBO);
-            ASSERT_OK(result);
+    int NodeProfile::add_peer(Peer *peer)
+    {
+        PeerListEventData peer_data = PeerListEventData(peer);
 
-            // Result could be OK or DUPLICATE. Both cases are considered to be
-            // non-error. However, we do not want to add another peer reference
-            // if the peer already exists.
-            if (result == RESULT_OK)
-            {
-                LOG_TRACE(logger, "Configuring peer");
-                this->peer_list[this->peer_count] = peer;
-                this->peer_count++;
+        if (this->find_peer(peer_data.peer_mac_address) != 0)
+        {
+            // There is already a peer registered, so delete the one created
+            // by the child class
+            delete peer;
+            LOG_WARN(logger, "A peer has already been registered");
+            return RESULT_DUPLICATE;
+        }
+
+        if (this->peers.is_full())
+        {
+            delete peer;
+            LOG_ERROR(logger, "Cannot add peer - maximum peer limit has been reached");
+            return ERR_PEER_LIMIT_EXCEEDED;
+        }
+
+        LOG_DEBUG(logger, "Adding peer [%s] to internal registry",
+                  LOG_FORMAT_MAC(peer_data.peer_mac_address));
+
+        // Result could be OK or DUPLICATE. Both cases are considered to be
+        // non-error, as the profile may have registered the mac address with
+        // the node before the peer was created (to send connect messages, for
+        // example). Registration fails once the radio's peer table is full.
+        int result = this->node->register_peer(peer_data.peer_mac_address, ESP_NOW_ROLE_COMBO);
+        if (result > RESULT_SUCCESS_BOUNDARY)
+        {
+            delete peer;
+            LOG_ERROR(logger, "Cannot add peer [%s] - radio registration failed. Error [%d]",
+                      LOG_FORMAT_MAC(peer_data.peer_mac_address), result);
+            return result;
+        }
+
+        LOG_TRACE(logger, "Configuring peer");
+        this->peers.push_back(peer);
+
+        if (!this->is_routing_peers)
+        {
+            this->node->add_handler(peer);
+        }
+        this->is_checkpoint_pending = true;
 
-                this->node->add_handler(peer);
+        LOG_TRACE(logger, "Notifying listeners");
+        this->peer_added->emit(peer_data);
 
-                LOG_TRACE(logger, "Notifying listeners");
-                this->peer_added->emit(peer_data);
+        return RESULT_OK;
+    }
+
+    int NodeProfile::remove_peer(Peer *peer)
+    {
+        int peer_index = this->peers.index_of(peer);
+        if (peer_index < 0)
+        {
+            LOG_WARN(logger, "Cannot remove unregistered peer");
+            return RESULT_NO_EXIST;
+        }
+
+        this->peers.erase(peer_index);
+
+        this->destroy_peer(peer);
+        LOG_DEBUG(logger, "Removed peer. Peer count [%d]", this->peers.size());
+
+        return RESULT_OK;
+    }
+
+    void NodeProfile::destroy_peer(Peer *peer)
+    {
+        PeerListEventData peer_data = PeerListEventData(peer);
+
+        // Removing message handler
+        ASSERT_OK(this->node->unregister_peer(peer_data.peer_mac_address));
+
+        // Destroy the peer. The peer is also the handler, so it is deleted
+        // by the node once the receive path is done with it.
+        LOG_DEBUG(logger, "Destroying peer [%s]",
+                  LOG_FORMAT_MAC(peer_data.peer_mac_address));
+
+        this->node->retire_handler(peer);
+        this->is_checkpoint_pending = true;
+
+        LOG_TRACE(logger, "Notifying listeners");
+        this->peer_removed->emit(peer_data);
+    }
+
+    Peer *NodeProfile::restore_peer(PeerRecord *record)
+    {
+        u32 timeout = record->timeout > 0 ? record->timeout : BASIC_PEER_DEFAULT_TIMEOUT;
+        return this->new_peer(MacAddress::from_bytes(record->mac_address), timeout);
+    }
+
+    Peer *NodeProfile::new_peer(MacAddress mac_address, u32 timeout)
+    {
+        return new BasicPeer(this->node, mac_address, timeout);
+    }
+
+    void NodeProfile::update_peers()
+    {
+        LOG_DEBUG(logger, "Updating [%d] peers", this->peers.size());
+        this->update_peers_of<Peer>();
+    }
+
+    u16 NodeProfile::prune_peers()
+    {
+        return this->prune_peers_of<Peer>();
+    }
+
+    int NodeProfile::restore_peers()
+    {
+        LOG_TRACE(logger, "Restoring peers");
+        PeerRecord records[__MAX_PEER_COUNT];
+        u8 count = 0;
+        int result = this->peer_store->load(records, __MAX_PEER_COUNT, &count);
+        if (result != RESULT_OK)
+        {
+            return result;
+        }
+
+        for (u8 index = 0; index < count; index++)
+        {
+            Peer *peer = this->restore_peer(&records[index]);
+            if (peer == 0)
+            {
+                continue;
             }
-            else
+
+            if (this->add_peer(peer) == RESULT_OK)
             {
-                // There is already a peer registered, so delete the one created
-                // by the child class
-                delete peer;
-                LOG_WARN(logger, "A peer has already been registered");
+                peer->probe(__RESTORE_PROBE_TIMEOUT);
             }
         }
 
-        LOG_TRACE(logger, "Peer registration process completed");
-        return ProcessingResult::handled;
+        // The restored peers match the store.
+        this->is_checkpoint_pending = false;
+        LOG_INFO(logger, "Restored [%d] peers. Peer count [%d]", count, this->peers.size());
+        BootProfiler::get_instance().mark("peer-restore");
+
+        return RESULT_OK;
+    }
+
+    int NodeProfile::checkpoint_peers()
+    {
+        LOG_TRACE(logger, "Saving peers");
+        PeerRecord records[__MAX_PEER_COUNT];
+        for (u8 index = 0; index < this->peers.size(); index++)
+        {
+            Peer *peer = this->peers[index];
+            peer->get_mac_address().to_bytes(records[index].mac_address);
+            records[index].role = ESP_NOW_ROLE_COMBO;
+            records[index].timeout = peer->get_timeout();
+        }
+
+        int result = this->peer_store->save(records, this->peers.size());
+        if (result == RESULT_OK)
+        {
+            this->is_checkpoint_pending = false;
+        }
+
+        return result;
+    }
+
+    Peer *NodeProfile::find_peer(MacAddress mac_address)
+    {
+        for (Peer *peer : this->peers)
+        {
+            if (peer->has_mac_address(mac_address))
+            {
+                return peer;
+            }
+        }
+        return 0;
     }
 
     int NodeProfile::update()
@@ -139,49 +380,35 @@ namespace thingnet
             return ERR_NODE_PROFILE_NOT_INITIALIZED;
         }
 
+        if (this->is_restore_pending)
+        {
+            this->is_restore_pending = false;
+            this->restore_peers();
+        }
+
         if (this->prune_timer->is_complete())
         {
-            LOG_DEBUG(logger, "Pruning peer list");
-            u8 new_peer_count = 0;
-            for (u8 peer_index = 0; peer_index < this->peer_count; peer_index++)
+            LOG_TRACE(logger, "Pruning peer list");
+            u16 prune_count = this->prune_peers();
+
+            if (prune_count > 0)
             {
-                LOG_TRACE(logger, "Checking peer [%d]", peer_index);
-                Peer *current_peer = this->peer_list[peer_index];
-                if (!current_peer->is_active())
-                {
-                    LOG_TRACE(logger, "Peer [%d] is inactive", peer_index);
-
-                    PeerListEventData peer_data = PeerListEventData(current_peer);
-
-                    // Removing peer handler
-                    this->node->remove_handler(current_peer);
-
-                    // Removing message handler
-                    ASSERT_OK(this->node->unregister_peer(
-                        peer_data.peer_mac_address));
-
-                    // Destroy the peer
-                    LOG_DEBUG(logger, "Destroying peer [%d] [%s]",
-                              peer_index,
-                              LOG_FORMAT_MAC(peer_data.peer_mac_address));
-
-                    delete current_peer;
-
-                    LOG_TRACE(logger, "Notifying listeners");
-                    this->peer_removed->emit(peer_data);
-                }
-                else
-                {
-                    // Slide the active peer to the current index
-                    this->peer_list[new_peer_count] = current_peer;
-                    new_peer_count++;
-                    LOG_TRACE(logger, "Peer [%d] is active", peer_index);
-                }
+                LOG_DEBUG(logger, "Pruned [%d] inactive peers. Peer count [%d]", prune_count, this->peers.size());
             }
+        }
 
-            u8 prune_count = this->peer_count - new_peer_count;
-            this->peer_count = new_peer_count;
-            LOG_DEBUG(logger, "Pruned [%d] inactive peers. Peer count [%d]", prune_count, this->peer_count);
+        // Only write to the store once per checkpoint period, batching up
+        // all changes made in the meantime.
+        if (this->checkpoint_timer->is_complete() &&
+            this->is_checkpoint_pending &&
+            this->peer_store != 0)
+        {
+            this->checkpoint_peers();
+        }
+
+        if (this->event_queue != 0)
+        {
+            this->event_queue->drain();
         }
 
         return RESULT_OK;
@@ -8,14 +8,21 @@
 #include "message_handler.h"
 #include "peer.h"
 #include "event_emitter.h"
+#include "static_vector.h"
+#include "peer_store.h"
+#include "node_config.h"
 
 using namespace thingnet::message_handlers;
 using namespace thingnet::utils;
 using namespace thingnet::peers;
+using namespace thingnet::storage;
 
 namespace thingnet
 {
-    const int __MAX_PEER_COUNT = 50;
+    const int __MAX_PEER_COUNT = NODE_MAX_PEERS;
+    // Event types passed to peer added and peer removed listeners.
+    const int PEER_ADDED_EVENT = 0x01;
+    const int PEER_REMOVED_EVENT = 0x02;
 
     /**
      * @brief Information about a peer, passed to listeners when a peer is
@@ -23,19 +30,32 @@ namespace thingnet
      */
     typedef struct PeerListEventData
     {
-        u8 peer_mac_address[6];
+        MacAddress peer_mac_address;
 
-        PeerListEventData()
-        {
-            memset(peer_mac_address, 0, 6);
-        }
+        PeerListEventData() {}
+
+        PeerListEventData(Peer *peer) : peer_mac_address(peer->get_mac_address()) {}
 
-        PeerListEventData(Peer *peer)
+        bool operator==(const PeerListEventData &other) const
         {
-            peer->read_mac_address(peer_mac_address);
+            return peer_mac_address == other.peer_mac_address;
         }
     } PeerListEventData;
 
+    /**
+     * @brief A range over the peers of a node profile.
+     */
+    typedef struct PeerRange
+    {
+        Peer *const *first;
+        Peer *const *last;
+
+        PeerRange(Peer *const *first, Peer *const *last) : first(first), last(last) {}
+
+        Peer *const *begin() const { return first; }
+        Peer *const *end() const { return last; }
+    } PeerRange;
+
     /**
      * @brief Base class for node profile entities. Node profiles are designed
      * to serve as a profile for the node, governing its behavior as a server
@@ -47,6 +67,11 @@ namespace thingnet
      * 
      * This class can be extended and customized for specific node profiles,
      * such as servers, clients, etc.
+     * 
+     * If a peer store has been set, the profile checkpoints its peers to the
+     * store (at most once per checkpoint period), and restores them on the
+     * first update after a restart. Restored peers are probed, and pruned as
+     * usual if they do not respond.
      */
     class NodeProfile : public MessageHandler
     {
@@ -55,12 +80,99 @@ namespace thingnet
         u32 prune_period;
         EventEmitter<PeerListEventData> *peer_added;
         EventEmitter<PeerListEventData> *peer_removed;
+        DeferredEventQueue<PeerListEventData> *event_queue;
+        bool is_deferring_events;
+        PeerStore *peer_store;
+        Timer *checkpoint_timer;
+        u32 checkpoint_period;
+        bool is_restore_pending;
+        bool is_checkpoint_pending;
+
+        /**
+         * @brief Loads peers from the peer store, registering them with the
+         * node and probing them to confirm that they are still present.
+         * 
+         * @return int A non success value will be returned if the restore
+         * operation resulted in an error. See error codes for more information.
+         */
+        int restore_peers();
+
+        /**
+         * @brief Saves the current list of peers to the peer store.
+         * 
+         * @return int A non success value will be returned if the save
+         * operation resulted in an error. See error codes for more information.
+         */
+        int checkpoint_peers();
 
     protected:
         bool is_initialized;
         Node *node;
-        Peer *peer_list[__MAX_PEER_COUNT];
-        u8 peer_count;
+        // Kept in the order the peers were added.
+        StaticVector<Peer *, __MAX_PEER_COUNT> peers;
+        // Set by profiles that pass messages to their peers through a peer
+        // router, in which case peers are not registered as handlers.
+        bool is_routing_peers;
+
+        /**
+         * @brief Allows each peer to perform update actions. The calls are
+         * made through PeerType, so they are bound at build time if PeerType
+         * is final.
+         * 
+         * @tparam PeerType The type of every peer in the profile, or Peer.
+         */
+        template <typename PeerType>
+        void update_peers_of()
+        {
+            for (Peer *peer : this->peers)
+            {
+                static_cast<PeerType *>(peer)->update();
+            }
+        }
+
+        /**
+         * @brief Destroys the peers that are no longer active, keeping the
+         * order of the remaining peers. The calls are made through PeerType,
+         * so they are bound at build time if PeerType is final.
+         * 
+         * @tparam PeerType The type of every peer in the profile, or Peer.
+         * @return u16 The number of peers that were destroyed.
+         */
+        template <typename PeerType>
+        u16 prune_peers_of()
+        {
+            return this->peers.remove_if([this](Peer *peer) {
+                if (static_cast<PeerType *>(peer)->is_active())
+                {
+                    return false;
+                }
+
+                this->destroy_peer(peer);
+                return true;
+            });
+        }
+
+        /**
+         * @brief Unregisters a peer from the node, destroys it and notifies
+         * peer removed listeners. The peer must already have been taken out of
+         * the internal list of peers.
+         * 
+         * @param peer Pointer to the peer to destroy.
+         */
+        void destroy_peer(Peer *peer);
+
+        /**
+         * @brief Replaces the peer added and peer removed emitters, for
+         * example with emitters that also notify listeners bound at build
+         * time (see StaticEventEmitter). Must be called before any listeners
+         * are registered, typically from the constructor of a child class.
+         * The profile takes ownership of the emitters.
+         * 
+         * @param peer_added The emitter for peer added events.
+         * @param peer_removed The emitter for peer removed events.
+         */
+        void set_peer_events(EventEmitter<PeerListEventData> *peer_added,
+                             EventEmitter<PeerListEventData> *peer_removed);
 
         /**
          * @brief Creates a new peer object, typically when establishing a
@@ -74,6 +186,64 @@ namespace thingnet
          */
         virtual Peer *create_peer(PeerMessage *message) = 0;
 
+        /**
+         * @brief Creates a peer object from a record that was saved in a
+         * previous session. Child classes can override this implementation to
+         * restore different peers based on specific requirements.
+         * 
+         * @param record A pointer to the saved peer record.
+         * @return Peer* Pointer to a newly created peer object, or a null value
+         * if the peer should not be restored.
+         */
+        virtual Peer *restore_peer(PeerRecord *record);
+
+        /**
+         * @brief Creates the peer object for a connection with the given mac
+         * address. The default implementation creates a BasicPeer. Child
+         * classes can override this implementation to change the type of peer
+         * used for all connections.
+         * 
+         * @param mac_address The mac address of the peer.
+         * @param timeout The initial timeout of the peer, in milliseconds.
+         * @return Peer* Pointer to a newly created peer object.
+         */
+        virtual Peer *new_peer(MacAddress mac_address, u32 timeout);
+
+        /**
+         * @brief Allows each peer to perform update actions.
+         */
+        virtual void update_peers();
+
+        /**
+         * @brief Destroys the peers that are no longer active, keeping the
+         * order of the remaining peers.
+         * 
+         * @return u16 The number of peers that were destroyed.
+         */
+        virtual u16 prune_peers();
+
+        /**
+         * @brief Registers a peer with the node and adds it to the internal
+         * list of peers, notifying peer added listeners. The profile takes
+         * ownership of the peer, and will destroy it if it cannot be added.
+         * 
+         * @param peer Pointer to the peer to add.
+         * @return int A non success value will be returned if the add operation
+         * resulted in an error. See error codes for more information.
+         */
+        int add_peer(Peer *peer);
+
+        /**
+         * @brief Removes a peer from the internal list of peers, unregisters it
+         * from the node and destroys it, notifying peer removed listeners.
+         * 
+         * @param peer Pointer to the peer to remove.
+         * @return int A non success value will be returned if the remove
+         * operation resulted in an error. See error codes for more information.
+         */
+        int remove_peer(Peer *peer);
+
+
     public:
         /**
          * @brief Construct a new Node Profile object
@@ -93,6 +263,38 @@ namespace thingnet
          */
         int set_prune_period(u32 timeout);
 
+        /**
+         * @brief Sets the store used to persist peers across restarts. This
+         * must be done before the profile is initialized.
+         * 
+         * @param store Pointer to an initialized peer store.
+         * @return int A non success value will be returned if the add operation
+         * resulted in an error. See error codes for more information.
+         */
+        int set_peer_store(PeerStore *store);
+
+        /**
+         * @brief Sets the minimum period between writes to the peer store, so
+         * that frequent peer changes do not wear out the flash.
+         * 
+         * @param period The checkpoint period in milliseconds.
+         * @return int A non success value will be returned if the add operation
+         * resulted in an error. See error codes for more information.
+         */
+        int set_checkpoint_period(u32 period);
+
+        /**
+         * @brief Enables or disables deferred peer events. When enabled, peer
+         * added and removed events are queued and dispatched from update(),
+         * instead of from within the message processing callback. A peer that
+         * is added and removed between updates produces no events at all.
+         * 
+         * @param is_deferred Whether or not peer events should be deferred.
+         * @return int A non success value will be returned if the operation
+         * resulted in an error. See error codes for more information.
+         */
+        int set_deferred_events(bool is_deferred);
+
         /**
          * @brief Gets the number of active peers associated with the profile.
          * 
@@ -100,6 +302,35 @@ namespace thingnet
          */
         int get_peer_count();
 
+        /**
+         * @brief Returns a range over the peers currently associated with the
+         * profile, which can be used in a range based for loop. The range
+         * refers to the internal list of peers, and does not allocate memory.
+         * It is invalidated when peers are added or removed, so it should not
+         * be held across calls to update().
+         * 
+         * @return PeerRange The range of peers.
+         */
+        PeerRange get_peers();
+
+        /**
+         * @brief Gets the memory used by the profile and its tables, not
+         * including the peers themselves. Child classes that add tables of
+         * their own should include them.
+         * 
+         * @return u32 The memory used, in bytes.
+         */
+        virtual u32 get_memory_usage();
+
+        /**
+         * @brief Finds a peer in the internal list of peers by mac address.
+         * 
+         * @param mac_address The mac address of the peer.
+         * @return Peer* Pointer to the peer, or a null value if the peer has
+         * not been added to the profile.
+         */
+        Peer *find_peer(MacAddress mac_address);
+
         /**
          * @brief Processes a message and returns a result that reflects the
          * result of the processing. If the incoming message represents a new
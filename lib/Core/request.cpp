@@ -0,0 +1,262 @@
+#include <Arduino.h>
+
+#include "log.h"
+#include "clock.h"
+#include "timer.h"
+#include "timer_service.h"
+#include "error_codes.h"
+#include "messages.h"
+#include "node.h"
+#include "request.h"
+
+using namespace thingnet::utils;
+
+static constinit Logger logger("request");
+
+namespace thingnet
+{
+    CoroutineFramePool::CoroutineFramePool()
+    {
+        // Nothing to do here.
+    }
+
+    CoroutineFramePool &CoroutineFramePool::get_instance()
+    {
+        static CoroutineFramePool instance;
+        return instance;
+    }
+
+    void *CoroutineFramePool::allocate(size_t size)
+    {
+        if (size > __COROUTINE_FRAME_SIZE)
+        {
+            LOG_ERROR(logger, "Coroutine not started, its frame of [%d] bytes exceeds the frame size [%d]",
+                      size, __COROUTINE_FRAME_SIZE);
+            return 0;
+        }
+
+        u16 index;
+        if (this->frame_pool.allocate(&index) != 0)
+        {
+            LOG_ERROR(logger, "Coroutine not started, all [%d] frames are in use",
+                      __MAX_COROUTINE_FRAMES);
+            return 0;
+        }
+
+        return this->frames[index];
+    }
+
+    void CoroutineFramePool::release(void *frame)
+    {
+        u32 offset = (u8 *)frame - &this->frames[0][0];
+        if (offset < sizeof(this->frames))
+        {
+            this->frame_pool.release(offset / __COROUTINE_FRAME_SIZE);
+        }
+    }
+
+    u8 CoroutineFramePool::get_available_count()
+    {
+        return this->frame_pool.get_available_count();
+    }
+
+    RequestManager::RequestManager()
+    {
+        this->request_count = 0;
+        for (u8 index = 0; index < __MAX_PENDING_REQUESTS; index++)
+        {
+            this->requests[index].is_used = false;
+        }
+        this->timeout_timer = new Timer(0);
+    }
+
+    RequestManager &RequestManager::get_instance()
+    {
+        static RequestManager instance;
+        return instance;
+    }
+
+    int RequestManager::add(MacAddress destination, u16 message_id, u32 timeout, PeerMessage *response,
+                            int *result, std::coroutine_handle<> handle)
+    {
+        for (u8 index = 0; index < __MAX_PENDING_REQUESTS; index++)
+        {
+            PendingRequest *request = &this->requests[index];
+            if (request->is_used)
+            {
+                continue;
+            }
+
+            request->destination = destination;
+            request->message_id = message_id;
+            request->deadline = Clock::now_millis() + timeout;
+            request->response = response;
+            request->result = result;
+            request->handle = handle;
+            request->is_complete = false;
+            request->is_used = true;
+            this->request_count++;
+            this->schedule_timeout();
+            return RESULT_OK;
+        }
+
+        LOG_WARN(logger, "Pending request limit reached");
+        return ERR_REQUEST_LIMIT_EXCEEDED;
+    }
+
+    int RequestManager::cancel(u16 message_id)
+    {
+        for (u8 index = 0; index < __MAX_PENDING_REQUESTS; index++)
+        {
+            PendingRequest *request = &this->requests[index];
+            if (request->is_used && request->message_id == message_id)
+            {
+                request->is_used = false;
+                this->request_count--;
+                return RESULT_OK;
+            }
+        }
+        return RESULT_NO_EXIST;
+    }
+
+    bool RequestManager::process_response(PeerMessage *message)
+    {
+        if (this->request_count == 0 ||
+            (message->payload.type != MSG_TYPE_ACK && message->payload.type != MSG_TYPE_NACK) ||
+            message->body_length < 2)
+        {
+            return false;
+        }
+
+        u16 message_id;
+        memcpy(&message_id, message->payload.body, 2);
+        for (u8 index = 0; index < __MAX_PENDING_REQUESTS; index++)
+        {
+            PendingRequest *request = &this->requests[index];
+            if (!request->is_used || request->is_complete ||
+                request->message_id != message_id ||
+                request->destination != message->sender)
+            {
+                continue;
+            }
+
+            LOG_TRACE(logger, "Response received for request [%d]", message_id);
+            if (request->response != 0)
+            {
+                memcpy(request->response, message, sizeof(PeerMessage));
+            }
+            *request->result = RESULT_OK;
+            request->is_complete = true;
+            TimerService::get_instance().wake();
+            return true;
+        }
+
+        return false;
+    }
+
+    u8 RequestManager::update()
+    {
+        if (this->request_count == 0)
+        {
+            return 0;
+        }
+
+        u8 resumed_count = 0;
+        u64 now = Clock::now_millis();
+        for (u8 index = 0; index < __MAX_PENDING_REQUESTS; index++)
+        {
+            PendingRequest *request = &this->requests[index];
+            if (!request->is_used)
+            {
+                continue;
+            }
+
+            if (!request->is_complete)
+            {
+                if (now < request->deadline)
+                {
+                    continue;
+                }
+                LOG_DEBUG(logger, "Request [%d] to [%s] timed out", request->message_id,
+                          LOG_FORMAT_MAC(request->destination));
+                *request->result = ERR_REQUEST_TIMEOUT;
+            }
+
+            // The slot is released before resuming, as the coroutine may
+            // immediately make another request.
+            std::coroutine_handle<> handle = request->handle;
+            request->is_used = false;
+            this->request_count--;
+            resumed_count++;
+            handle.resume();
+        }
+
+        this->schedule_timeout();
+        return resumed_count;
+    }
+
+    void RequestManager::schedule_timeout()
+    {
+        u64 deadline = 0;
+        for (u8 index = 0; index < __MAX_PENDING_REQUESTS; index++)
+        {
+            PendingRequest *request = &this->requests[index];
+            if (request->is_used && !request->is_complete &&
+                (deadline == 0 || request->deadline < deadline))
+            {
+                deadline = request->deadline;
+            }
+        }
+
+        this->timeout_timer->stop();
+        if (deadline == 0)
+        {
+            return;
+        }
+
+        u64 now = Clock::now_millis();
+        this->timeout_timer->set_duration(deadline > now ? deadline - now : 0);
+        this->timeout_timer->start();
+    }
+
+    u8 RequestManager::get_pending_count()
+    {
+        return this->request_count;
+    }
+
+    RequestAwaitable::RequestAwaitable(MacAddress destination, MessagePayload *payload, u8 body_length,
+                                       u32 timeout, PeerMessage *response)
+    {
+        this->destination = destination;
+        this->payload = payload;
+        this->body_length = body_length;
+        this->timeout = timeout;
+        this->response = response;
+        this->result = RESULT_OK;
+    }
+
+    bool RequestAwaitable::await_suspend(std::coroutine_handle<> handle)
+    {
+        Node &node = Node::get_instance();
+        RequestManager &manager = RequestManager::get_instance();
+
+        this->payload->message_id = node.get_next_message_id();
+        int result = manager.add(this->destination, this->payload->message_id, this->timeout,
+                                 this->response, &this->result, handle);
+        if (result != RESULT_OK)
+        {
+            this->result = result;
+            return false;
+        }
+
+        result = node.send_message(this->destination, this->payload, this->body_length);
+        if (result != RESULT_OK)
+        {
+            manager.cancel(this->payload->message_id);
+            this->result = result;
+            return false;
+        }
+
+        return true;
+    }
+}
\ No newline at end of file
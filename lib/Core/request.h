@@ -0,0 +1,267 @@
+#ifndef __REQUEST_H
+#define __REQUEST_H
+
+#include <Arduino.h>
+#include <coroutine>
+
+#include "messages.h"
+#include "timer.h"
+#include "index_pool.h"
+#include "node_config.h"
+
+namespace thingnet
+{
+    const u8 __MAX_PENDING_REQUESTS = NODE_MAX_PENDING_REQUESTS;
+    const u8 __MAX_COROUTINE_FRAMES = NODE_MAX_COROUTINE_FRAMES;
+    const u16 __COROUTINE_FRAME_SIZE = NODE_COROUTINE_FRAME_SIZE;
+
+    // The space taken by the coroutine's own state, the awaited request and
+    // a few locals, on top of the request payload and response.
+    const u16 __COROUTINE_FRAME_OVERHEAD = 128;
+
+    static_assert(__COROUTINE_FRAME_SIZE >=
+                      sizeof(MessagePayload) + sizeof(PeerMessage) + __COROUTINE_FRAME_OVERHEAD,
+                  "Coroutine frames must fit a request payload and its response");
+
+    /**
+     * @brief A fixed pool of coroutine frames, so that coroutines can be
+     * started without allocating from the heap. Frames that are larger than
+     * the pool's frame size cannot be allocated.
+     */
+    class CoroutineFramePool
+    {
+    private:
+        alignas(8) u8 frames[__MAX_COROUTINE_FRAMES][__COROUTINE_FRAME_SIZE];
+        utils::IndexPool<__MAX_COROUTINE_FRAMES> frame_pool;
+
+        CoroutineFramePool();
+
+    public:
+        /**
+         * @brief Get the instance object
+         *
+         * @return CoroutineFramePool&
+         */
+        static CoroutineFramePool &get_instance();
+
+        /**
+         * @brief Allocates a frame from the pool.
+         * 
+         * @param size The size of the frame.
+         * @return void* A pointer to the frame, or a null value if the frame is
+         * too large, or all frames are in use.
+         */
+        void *allocate(size_t size);
+
+        /**
+         * @brief Returns a frame to the pool.
+         * 
+         * @param frame A pointer to the frame.
+         */
+        void release(void *frame);
+
+        /**
+         * @brief Gets the number of frames that are available.
+         * 
+         * @return u8 The number of available frames.
+         */
+        u8 get_available_count();
+    };
+
+    /**
+     * @brief The return type of coroutines that exchange messages with peers.
+     * Tasks start running immediately, and release their frame when they
+     * complete. A task is invalid if no frame could be allocated for it, in
+     * which case the coroutine does not run at all, and an error is logged.
+     * A coroutine can keep a payload and a response in its frame, as below,
+     * but larger frames need NODE_COROUTINE_FRAME_SIZE to be raised. For
+     * example:
+     * 
+     * Task check_peer(MacAddress mac_address)
+     * {
+     *     MessagePayload payload(MSG_TYPE_HEARTBEAT);
+     *     PeerMessage response;
+     *     int result = co_await Node::get_instance().request(
+     *         mac_address, &payload, 0, 100, &response);
+     *     ...
+     * }
+     */
+    class Task
+    {
+    private:
+        bool is_started;
+
+        Task(bool is_started) : is_started(is_started) {}
+
+    public:
+        struct promise_type
+        {
+            Task get_return_object() { return Task(true); }
+            static Task get_return_object_on_allocation_failure() { return Task(false); }
+            std::suspend_never initial_suspend() noexcept { return {}; }
+            std::suspend_never final_suspend() noexcept { return {}; }
+            void return_void() {}
+            void unhandled_exception() {}
+
+            static void *operator new(size_t size) noexcept
+            {
+                return CoroutineFramePool::get_instance().allocate(size);
+            }
+
+            static void operator delete(void *frame)
+            {
+                CoroutineFramePool::get_instance().release(frame);
+            }
+        };
+
+        /**
+         * @brief Determines whether or not the coroutine was started.
+         * 
+         * @return true If a frame was allocated and the coroutine started.
+         * @return false If the coroutine could not be started.
+         */
+        bool is_valid() const { return this->is_started; }
+    };
+
+    /**
+     * @brief A request that is waiting for a response.
+     */
+    typedef struct PendingRequest
+    {
+        MacAddress destination;
+        u16 message_id;
+        u64 deadline;
+        PeerMessage *response;
+        int *result;
+        std::coroutine_handle<> handle;
+        bool is_used;
+        bool is_complete;
+    } PendingRequest;
+
+    /**
+     * @brief Tracks requests made by coroutines, matching responses to them
+     * and resuming the coroutines once a response arrives or the request times
+     * out.
+     * 
+     * A response is an ACK or NACK from the destination, with the message id
+     * of the request in the first two bytes of the body - the convention used
+     * by CONNECT and HEARTBEAT messages. Responses are matched in the receive
+     * callback, but coroutines are only resumed from update(), so they never
+     * run within the callback. Matched responses are still passed on to the
+     * message handlers.
+     * 
+     * A timer runs until the earliest pending request times out, and matched
+     * responses wake the loop, so the loop can idle while requests are
+     * pending.
+     */
+    class RequestManager
+    {
+    private:
+        PendingRequest requests[__MAX_PENDING_REQUESTS];
+        u8 request_count;
+        utils::Timer *timeout_timer;
+
+        RequestManager();
+
+        /**
+         * @brief Runs the timeout timer until the earliest deadline of the
+         * requests that are still waiting for a response, or stops it if there
+         * are none.
+         */
+        void schedule_timeout();
+
+    public:
+        /**
+         * @brief Get the instance object
+         *
+         * @return RequestManager&
+         */
+        static RequestManager &get_instance();
+
+        /**
+         * @brief Registers a request that a coroutine is waiting on.
+         * 
+         * @param destination The mac address of the peer.
+         * @param message_id The message id of the request.
+         * @param timeout The time to wait for a response, in milliseconds.
+         * @param response Where the response will be copied, or a null value
+         * if the response is not required.
+         * @param result Where the result of the request will be written.
+         * @param handle The coroutine to resume.
+         * @return int A non success value will be returned if the request
+         * could not be registered. See error codes for more information.
+         */
+        int add(MacAddress destination, u16 message_id, u32 timeout, PeerMessage *response,
+                int *result, std::coroutine_handle<> handle);
+
+        /**
+         * @brief Cancels a request without resuming its coroutine.
+         * 
+         * @param message_id The message id of the request.
+         * @return int A non success value will be returned if the request does
+         * not exist. See error codes for more information.
+         */
+        int cancel(u16 message_id);
+
+        /**
+         * @brief Completes the request that a message responds to, if any.
+         * 
+         * @param message The received message.
+         * @return true If the message completed a request.
+         * @return false If the message is not a response to a request.
+         */
+        bool process_response(PeerMessage *message);
+
+        /**
+         * @brief Resumes the coroutines of requests that have completed or
+         * timed out.
+         * 
+         * @return u8 The number of coroutines that were resumed.
+         */
+        u8 update();
+
+        /**
+         * @brief Gets the number of requests waiting for a response.
+         * 
+         * @return u8 The number of pending requests.
+         */
+        u8 get_pending_count();
+    };
+
+    /**
+     * @brief Sends a request when awaited, and suspends the coroutine until
+     * a response arrives or the request times out. Created by Node::request().
+     * Awaiting evaluates to RESULT_OK if a response was received, or an error
+     * code otherwise.
+     */
+    class RequestAwaitable
+    {
+    private:
+        MacAddress destination;
+        MessagePayload *payload;
+        u8 body_length;
+        u32 timeout;
+        PeerMessage *response;
+        int result;
+
+    public:
+        /**
+         * @brief Construct a new request awaitable object
+         * 
+         * @param destination The mac address of the peer.
+         * @param payload The request. A new message id will be assigned.
+         * @param body_length The length of the request body.
+         * @param timeout The time to wait for a response, in milliseconds.
+         * @param response Where the response will be copied, or a null value
+         * if the response is not required.
+         */
+        RequestAwaitable(MacAddress destination, MessagePayload *payload, u8 body_length,
+                         u32 timeout, PeerMessage *response);
+
+        bool await_ready() { return false; }
+        bool await_suspend(std::coroutine_handle<> handle);
+        int await_resume() { return this->result; }
+    };
+}
+
+#endif
\ No newline at end of file
@@ -1,6 +1,7 @@
 #include <Arduino.h>
 
 #include "log.h"
+#include "clock.h"
 #include "timer.h"
 
 #include "error_codes.h"
@@ -12,24 +13,61 @@
 
 using namespace thingnet::utils;
 
-static Logger *logger = new Logger("server-prof");
+static constinit Logger logger("server-prof");
 
 namespace thingnet
 {
-    static const u8 __BROADCAST_PEER[6] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
+    static const int __DEFAULT_ADMISSION_PERIOD = 10;
+    static const u8 __DEFAULT_ADMISSION_BATCH_SIZE = 1;
+    static const u32 __DEFAULT_BEACON_MIN_INTERVAL = 250;
+    static const u32 __DEFAULT_BEACON_MAX_INTERVAL = 64000;
+
+    // Airtime of an ESP-NOW frame at 1 Mbps: long PLCP preamble and header,
+    // plus the 802.11 action frame and vendor specific element overhead.
+    static const u32 __BEACON_PREAMBLE_TIME = 192;
+    static const u32 __BEACON_FRAME_OVERHEAD = 43;
+    static const u32 __BEACON_BYTE_TIME = 8;
+    static const u32 __SOLICITED_PEER_TIMEOUT = 1000;
+    // Discovery requests can arrive for every frame, so warnings about them
+    // are limited to one per period.
+    static const u32 __WARNING_PERIOD = 1000;
 
     ServerNodeProfile::ServerNodeProfile(Node *node) : NodeProfile(node)
     {
+        this->admission_timer = 0;
+        this->admission_period = __DEFAULT_ADMISSION_PERIOD;
+        this->admission_batch_size = __DEFAULT_ADMISSION_BATCH_SIZE;
+        this->advertise_time = 0;
+        this->beacon_min_interval = __DEFAULT_BEACON_MIN_INTERVAL;
+        this->beacon_max_interval = __DEFAULT_BEACON_MAX_INTERVAL;
+        this->beacon_timer = 0;
+        this->beacon_interval_timer = 0;
+        this->solicited_timer = 0;
     }
 
     int ServerNodeProfile::init()
     {
         ASSERT_OK(NodeProfile::init());
 
+        // The admission timer is started when a connect request is queued.
+        this->admission_timer = new Timer(this->admission_period, true);
+        this->admission_timer->set_callback(on_admission_due, this);
+
+        this->solicited_timer = new Timer(__SOLICITED_PEER_TIMEOUT);
+        this->solicited_timer->set_callback(on_solicited_peer_expired, this);
+
         LOG_TRACE(logger, "Registering broadcast peer");
-        ASSERT_OK(this->node->register_peer((u8 *)__BROADCAST_PEER,
+        ASSERT_OK(this->node->register_peer(BROADCAST_MAC_ADDRESS,
                                             ESP_NOW_ROLE_CONTROLLER));
 
+        LOG_TRACE(logger, "Starting beacon interval");
+        this->beacon_timer = new Timer(0);
+        this->beacon_timer->set_callback(on_beacon_due, this);
+        this->beacon_interval_timer = new Timer(0);
+        this->beacon_interval_timer->set_callback(on_beacon_interval_end, this);
+        this->beacon_stats.interval = this->beacon_min_interval;
+        this->start_beacon_interval();
+
         LOG_TRACE(logger, "Server node profile initialized");
         return RESULT_OK;
     }
@@ -43,15 +81,287 @@ namespace thingnet
         }
 
         LOG_TRACE(logger, "Advertising server to peers");
+        this->advertise_time = Clock::now_millis();
+        return this->send_advertisement(BROADCAST_MAC_ADDRESS, 0);
+    }
+
+    int ServerNodeProfile::send_advertisement(MacAddress destination, u8 flags)
+    {
+        // Peers waiting for admission count towards the load, so that clients
+        // do not pile onto a server that is already busy admitting peers.
+        u16 load = this->peers.size() + this->admission_queue.size();
+
         MessagePayload payload(MSG_TYPE_ADVERTISEMENT);
-        this->node->read_mac_address(payload.body);
+        this->node->get_mac_address().to_bytes(payload.body);
+        payload.body[6] = flags;
+        payload.body[7] = load > __SERVER_PEER_CAPACITY ? __SERVER_PEER_CAPACITY : load;
+        payload.body[8] = __SERVER_PEER_CAPACITY;
+
+        this->beacon_stats.beacons_sent++;
+        this->beacon_stats.airtime += __BEACON_PREAMBLE_TIME +
+                                      (__BEACON_FRAME_OVERHEAD + 3 + 9) * __BEACON_BYTE_TIME;
+
+        return this->node->send_message(destination, &payload, 9);
+    }
+
+    int ServerNodeProfile::respond_to_discovery(PeerMessage *message)
+    {
+        LOG_DEBUG(logger, "[DISCOVERY] received from [%s]",
+                  LOG_FORMAT_MAC(message->sender));
+        this->reset_beacon_interval();
+
+        if (this->find_peer(message->sender) == 0)
+        {
+            u64 expiry_time = Clock::now_millis() + __SOLICITED_PEER_TIMEOUT;
+            u64 *solicited_expiry_time = this->solicited_peers.find(message->sender);
+            if (solicited_expiry_time != 0)
+            {
+                *solicited_expiry_time = expiry_time;
+            }
+            else
+            {
+                if (this->solicited_peers.is_full())
+                {
+                    // The node will retry the discovery request.
+                    LOG_WARN(logger, "Too many solicited nodes. Ignoring discovery from [%s]",
+                             LOG_FORMAT_MAC(message->sender));
+                    return RESULT_OK;
+                }
+
+                // The radio's peer table can be full, even if the solicited
+                // node table is not. The node will retry the discovery
+                // request.
+                int result = this->node->register_peer(message->sender, ESP_NOW_ROLE_COMBO);
+                if (result > RESULT_SUCCESS_BOUNDARY)
+                {
+                    LOG_RATE_LIMITED(LOG_WARN, logger, __WARNING_PERIOD,
+                                     "Unable to register [%s]. Ignoring discovery. Error [%d]",
+                                     LOG_FORMAT_MAC(message->sender), result);
+                    return RESULT_OK;
+                }
+                this->solicited_peers.insert(message->sender, expiry_time);
+                if (!this->solicited_timer->is_running())
+                {
+                    this->solicited_timer->set_duration(__SOLICITED_PEER_TIMEOUT);
+                    this->solicited_timer->start();
+                }
+            }
+        }
+
+        return this->send_advertisement(message->sender, MSG_ADVERTISEMENT_FLAG_SOLICITED);
+    }
+
+    void ServerNodeProfile::expire_solicited_peers()
+    {
+        u64 now = Clock::now_millis();
+        this->solicited_peers.remove_if([this, now](MacAddress mac_address, u64 expiry_time) {
+            if (now < expiry_time)
+            {
+                return false;
+            }
+
+            if (this->find_peer(mac_address) == 0)
+            {
+                LOG_DEBUG(logger, "Solicited node [%s] did not connect",
+                          LOG_FORMAT_MAC(mac_address));
+                this->node->unregister_peer(mac_address);
+            }
+            return true;
+        });
+
+        u64 next_expiry_time = 0;
+        for (u16 index = 0; index < this->solicited_peers.size(); index++)
+        {
+            u64 expiry_time = this->solicited_peers.value_at(index);
+            if (next_expiry_time == 0 || expiry_time < next_expiry_time)
+            {
+                next_expiry_time = expiry_time;
+            }
+        }
+
+        if (next_expiry_time != 0)
+        {
+            this->solicited_timer->set_duration(next_expiry_time - now);
+            this->solicited_timer->start();
+        }
+    }
+
+    void ServerNodeProfile::on_solicited_peer_expired(void *context)
+    {
+        ((ServerNodeProfile *)context)->expire_solicited_peers();
+    }
+
+    int ServerNodeProfile::set_beacon_interval(u32 min_interval, u32 max_interval)
+    {
+        if (!this->is_initialized)
+        {
+            LOG_WARN(logger, "Node profile has not been initialized");
+            return ERR_NODE_PROFILE_NOT_INITIALIZED;
+        }
+
+        this->beacon_min_interval = min_interval;
+        this->beacon_max_interval = max_interval < min_interval ? min_interval
+                                                                : max_interval;
+        this->beacon_stats.interval = min_interval;
+        this->start_beacon_interval();
+
+        return RESULT_OK;
+    }
+
+    const BeaconStats *ServerNodeProfile::get_beacon_stats()
+    {
+        return &this->beacon_stats;
+    }
+
+    u32 ServerNodeProfile::get_memory_usage()
+    {
+        return NodeProfile::get_memory_usage() + sizeof(ServerNodeProfile) - sizeof(NodeProfile);
+    }
+
+    void ServerNodeProfile::start_beacon_interval()
+    {
+        this->beacon_timer->stop();
+        this->beacon_interval_timer->stop();
+        if (this->beacon_max_interval == 0)
+        {
+            return;
+        }
+
+        u32 interval = this->beacon_stats.interval;
+        this->beacon_timer->set_duration(interval / 2 + random(interval / 2 + 1));
+        this->beacon_timer->start();
+        this->beacon_interval_timer->set_duration(interval);
+        this->beacon_interval_timer->start();
+    }
+
+    void ServerNodeProfile::on_beacon_due(void *context)
+    {
+        LOG_TRACE(logger, "Sending periodic advertisement");
+        ((ServerNodeProfile *)context)->advertise();
+    }
+
+    void ServerNodeProfile::on_beacon_interval_end(void *context)
+    {
+        ServerNodeProfile *profile = (ServerNodeProfile *)context;
+        u32 interval = profile->beacon_stats.interval * 2;
+        profile->beacon_stats.interval = interval > profile->beacon_max_interval
+                                             ? profile->beacon_max_interval
+                                             : interval;
+        profile->start_beacon_interval();
+    }
+
+    void ServerNodeProfile::reset_beacon_interval()
+    {
+        this->beacon_stats.reset_count++;
+        if (this->beacon_stats.interval > this->beacon_min_interval)
+        {
+            LOG_DEBUG(logger, "Topology changed. Resetting beacon interval");
+            this->beacon_stats.interval = this->beacon_min_interval;
+            this->start_beacon_interval();
+        }
+    }
+
+    int ServerNodeProfile::set_admission_period(u32 period)
+    {
+        if (!this->is_initialized)
+        {
+            LOG_WARN(logger, "Node profile has not been initialized");
+            return ERR_NODE_PROFILE_NOT_INITIALIZED;
+        }
+
+        this->admission_period = period;
+        this->admission_timer->set_duration(period);
+
+        return RESULT_OK;
+    }
+
+    int ServerNodeProfile::set_admission_batch_size(u8 batch_size)
+    {
+        if (!this->is_initialized)
+        {
+            LOG_WARN(logger, "Node profile has not been initialized");
+            return ERR_NODE_PROFILE_NOT_INITIALIZED;
+        }
+
+        this->admission_batch_size = batch_size;
+
+        return RESULT_OK;
+    }
+
+    int ServerNodeProfile::update()
+    {
+        u8 peer_count = this->peers.size();
+        ASSERT_OK(NodeProfile::update());
+
+        if (this->peers.size() < peer_count)
+        {
+            this->reset_beacon_interval();
+        }
 
-        this->node->send_message((u8 *)__BROADCAST_PEER, &payload, 6);
         return RESULT_OK;
     }
 
+    void ServerNodeProfile::on_admission_due(void *context)
+    {
+        ServerNodeProfile *profile = (ServerNodeProfile *)context;
+        u8 admitted = 0;
+        PendingAdmission admission;
+        while (admitted < profile->admission_batch_size &&
+               profile->admission_queue.pop(&admission) == 0)
+        {
+            profile->admit_peer(&admission);
+            admitted++;
+        }
+
+        if (profile->admission_queue.is_empty())
+        {
+            profile->admission_timer->stop();
+        }
+    }
+
+    int ServerNodeProfile::admit_peer(PendingAdmission *admission)
+    {
+        LOG_TRACE(logger, "Admitting peer [%s]", LOG_FORMAT_MAC(admission->mac_address));
+
+        int result = this->add_peer(this->new_peer(admission->mac_address, BASIC_PEER_DEFAULT_TIMEOUT));
+        if (result > RESULT_SUCCESS_BOUNDARY)
+        {
+            LOG_WARN(logger, "Unable to admit peer [%s]. Error [%d]",
+                     LOG_FORMAT_MAC(admission->mac_address), result);
+            return result;
+        }
+
+        LOG_INFO(logger, "Admitted [%s] [%d] ms after advertisement. Peer count [%d]",
+                 LOG_FORMAT_MAC(admission->mac_address),
+                 (u32)(Clock::now_millis() - this->advertise_time),
+                 this->peers.size());
+        this->reset_beacon_interval();
+
+        LOG_TRACE(logger, "Confirming connection");
+        MessagePayload payload(MSG_TYPE_ACK);
+        memcpy(payload.body, &admission->message_id, 2);
+
+        return this->node->send_message(admission->mac_address, &payload, 2);
+    }
+
     Peer *ServerNodeProfile::create_peer(PeerMessage *message)
     {
+        if (message->payload.type == MSG_TYPE_HEARTBEAT)
+        {
+            // The sender believes it is connected, but is not known to the
+            // server (after a server restart, for example).
+            LOG_DEBUG(logger, "[HEARTBEAT] from unknown node [%s]",
+                      LOG_FORMAT_MAC(message->sender));
+            this->reset_beacon_interval();
+            return 0;
+        }
+
+        if (message->payload.type == MSG_TYPE_DISCOVERY)
+        {
+            this->respond_to_discovery(message);
+            return 0;
+        }
+
         if (message->payload.type != MSG_TYPE_CONNECT)
         {
             LOG_DEBUG(logger, "Unexpected message [%02x] from [%s]. Ignoring.",
@@ -63,7 +373,32 @@ namespace thingnet
 
         LOG_DEBUG(logger, "[CONNECT] received from [%s]",
                   LOG_FORMAT_MAC(message->sender));
+        this->reset_beacon_interval();
+
+        for (u8 index = 0; index < this->admission_queue.size(); index++)
+        {
+            if (this->admission_queue[index].mac_address == message->sender)
+            {
+                LOG_DEBUG(logger, "Connect request is already queued. Ignoring.");
+                return 0;
+            }
+        }
+
+        PendingAdmission admission;
+        admission.mac_address = message->sender;
+        admission.message_id = message->payload.message_id;
+        if (this->admission_queue.push(admission) != 0)
+        {
+            // The peer will retry the connection.
+            LOG_WARN(logger, "Admission queue is full. Dropping connect from [%s]",
+                     LOG_FORMAT_MAC(message->sender));
+            return 0;
+        }
+
+        LOG_TRACE(logger, "Connect request queued. Pending admissions [%d]",
+                  this->admission_queue.size());
+        this->admission_timer->start();
 
-        return new BasicPeer(this->node, message->sender);
+        return 0;
     }
 }
\ No newline at end of file
@@ -9,6 +9,8 @@
 #include "peer.h"
 #include "node_profile.h"
 #include "timer.h"
+#include "flat_map.h"
+#include "ring_buffer.h"
 
 using namespace thingnet::message_handlers;
 using namespace thingnet::utils;
@@ -16,22 +18,169 @@ using namespace thingnet::peers;
 
 namespace thingnet
 {
+    const u8 __MAX_PENDING_ADMISSIONS = 16;
+    const u8 __MAX_SOLICITED_PEERS = 8;
+
+    // The number of peers the server can hold, which is advertised to clients.
+    // The radio's peer table limits this, as it also holds the broadcast
+    // address.
+    const u8 __SERVER_PEER_CAPACITY = NODE_MAX_PEERS < NODE_RADIO_MAX_PEERS - 1
+                                          ? NODE_MAX_PEERS
+                                          : NODE_RADIO_MAX_PEERS - 1;
+
+    /**
+     * @brief A connect request that has been received by the server, but not
+     * yet admitted.
+     */
+    typedef struct PendingAdmission
+    {
+        MacAddress mac_address;
+        u16 message_id;
+    } PendingAdmission;
+
+    /**
+     * @brief Statistics for periodic server advertisements.
+     */
+    typedef struct BeaconStats
+    {
+        u32 beacons_sent;
+        u32 airtime;
+        u32 interval;
+        u32 reset_count;
+
+        BeaconStats()
+        {
+            memset(this, 0, sizeof(BeaconStats));
+        }
+    } BeaconStats;
+
     /**
      * @brief A node profile implementation for server nodes. Provides basic
      * server functions such as dynamic peer registration, server advertisement,
      * disconnected peer pruning, etc.
+     * 
+     * Advertisements are sent periodically on a Trickle interval: the interval
+     * is reset to its minimum when the topology changes (a peer is added or
+     * removed, or a connect or heartbeat is received from an unknown node),
+     * and doubles up to its maximum each time it elapses without a change.
+     * Unlike Trickle, advertisements are never suppressed, as every server
+     * needs to advertise itself.
      */
     class ServerNodeProfile : public NodeProfile
     {
     private:
+        RingBuffer<PendingAdmission, __MAX_PENDING_ADMISSIONS> admission_queue;
+        Timer *admission_timer;
+        u32 admission_period;
+        u8 admission_batch_size;
+        u64 advertise_time;
+
+        u32 beacon_min_interval;
+        u32 beacon_max_interval;
+        // Runs until the advertisement in the current beacon interval is due.
+        Timer *beacon_timer;
+        // Runs until the end of the current beacon interval.
+        Timer *beacon_interval_timer;
+        BeaconStats beacon_stats;
+
+        // Nodes that have been sent an advertisement in response to a
+        // discovery request, and were registered with the node to allow it to
+        // be sent, mapped to the time at which they expire.
+        FlatMap<MacAddress, u64, __MAX_SOLICITED_PEERS> solicited_peers;
+        // Runs until the earliest solicited node expires.
+        Timer *solicited_timer;
+
+        /**
+         * @brief Sends an advertisement message to the given destination.
+         * 
+         * @param destination The mac address to send the advertisement to.
+         * @param flags Advertisement flags to include in the message.
+         * @return int A non success value will be returned if the send
+         * operation resulted in an error. See error codes for more information.
+         */
+        int send_advertisement(MacAddress destination, u8 flags);
+
+        /**
+         * @brief Responds to a discovery request with a unicast advertisement,
+         * temporarily registering the sender with the node if required.
+         * 
+         * @param message A pointer to the discovery request.
+         * @return int A non success value will be returned if the response
+         * resulted in an error. See error codes for more information.
+         */
+        int respond_to_discovery(PeerMessage *message);
+
+        /**
+         * @brief Unregisters solicited nodes that did not connect to the
+         * server in time, and runs the solicited timer until the next node
+         * expires.
+         */
+        void expire_solicited_peers();
+
+        /**
+         * @brief Starts a new beacon interval, picking a random time in the
+         * second half of the interval at which to advertise.
+         */
+        void start_beacon_interval();
+
+        /**
+         * @brief Resets the beacon interval to its minimum value. Called when
+         * the topology of the network changes.
+         */
+        void reset_beacon_interval();
+
+        /**
+         * @brief Creates a peer for a queued connect request, and confirms the
+         * connection with the peer.
+         * 
+         * @param admission Pointer to the connect request to admit.
+         * @return int A non success value will be returned if the admit
+         * operation resulted in an error. See error codes for more information.
+         */
+        int admit_peer(PendingAdmission *admission);
+
+        /**
+         * @brief Admits the next batch of queued connect requests, stopping
+         * the admission timer once the queue is empty.
+         * 
+         * @param context The server node profile.
+         */
+        static void on_admission_due(void *context);
+
+        /**
+         * @brief Sends the advertisement for the current beacon interval.
+         * 
+         * @param context The server node profile.
+         */
+        static void on_beacon_due(void *context);
+
+        /**
+         * @brief Doubles the beacon interval (up to its maximum), and starts
+         * the next interval.
+         * 
+         * @param context The server node profile.
+         */
+        static void on_beacon_interval_end(void *context);
+
+        /**
+         * @brief Expires solicited nodes that did not connect in time.
+         * 
+         * @param context The server node profile.
+         */
+        static void on_solicited_peer_expired(void *context);
+
     protected:
         /**
-         * @brief Creates a new peer object if a connect message is received
-         * from the peer.
+         * @brief Queues connect messages received from peers for admission.
+         * Peers are not created here, but by the admission timer, at the rate
+         * configured via set_admission_period() and set_admission_batch_size(),
+         * which only runs while requests are queued. This
+         * keeps peer registration out of the receive callback, and spreads out
+         * the work when many peers respond to an advertisement at once.
          * 
          * @param message A pointer to the message that was received from the
          * peer.
-         * @return Peer* Pointer to a newly created peer object.
+         * @return Peer* Always returns a null value.
          */
         virtual Peer *create_peer(PeerMessage *message);
 
@@ -57,6 +206,64 @@ namespace thingnet
          * operation resulted in an error. See error codes for more information.
          */
         int init();
+
+        /**
+         * @brief Sets the period at which queued connect requests are
+         * admitted.
+         * 
+         * @param period The admission period in milliseconds.
+         * @return int A non success value will be returned if the add operation
+         * resulted in an error. See error codes for more information.
+         */
+        int set_admission_period(u32 period);
+
+        /**
+         * @brief Sets the maximum number of queued connect requests that are
+         * admitted in each admission period.
+         * 
+         * @param batch_size The maximum number of peers admitted per period.
+         * @return int A non success value will be returned if the add operation
+         * resulted in an error. See error codes for more information.
+         */
+        int set_admission_batch_size(u8 batch_size);
+
+        /**
+         * @brief Sets the bounds of the periodic advertisement interval.
+         * 
+         * @param min_interval The interval used after a topology change, in
+         * milliseconds.
+         * @param max_interval The interval used when the network is stable, in
+         * milliseconds. Setting this to zero disables periodic advertisements.
+         * @return int A non success value will be returned if the add operation
+         * resulted in an error. See error codes for more information.
+         */
+        int set_beacon_interval(u32 min_interval, u32 max_interval);
+
+        /**
+         * @brief Returns statistics for advertisements sent by the server. The
+         * airtime is an estimate in microseconds, assuming the 1 Mbps rate
+         * used by ESP-NOW.
+         * 
+         * @return const BeaconStats* Pointer to the beacon statistics.
+         */
+        const BeaconStats *get_beacon_stats();
+
+        /**
+         * @brief Gets the memory used by the profile, including the admission
+         * queue and solicited peer table.
+         * 
+         * @return u32 The memory used, in bytes.
+         */
+        u32 get_memory_usage();
+
+        /**
+         * @brief Performs basic housekeeping, and admits queued connect
+         * requests at the configured rate.
+         * 
+         * @return int A non success value will be returned if the add operation
+         * resulted in an error. See error codes for more information.
+         */
+        int update();
     };
 }
 
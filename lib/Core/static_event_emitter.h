@@ -0,0 +1,109 @@
+#ifndef __STATIC_EVENT_EMITTER_H
+#define __STATIC_EVENT_EMITTER_H
+
+#include <Arduino.h>
+#include "event_emitter.h"
+
+namespace thingnet
+{
+    /**
+     * @brief A compile time list of listener types. Each listener type must
+     * declare a static `on_event(int event_type, T event_data)` method.
+     * 
+     * @tparam Listeners The listener types.
+     */
+    template <typename... Listeners>
+    struct ListenerList
+    {
+    };
+
+    /**
+     * @brief Adapts a plain function to a listener type, so that it can be
+     * added to a listener list. For example:
+     * `ListenerList<FunctionListener<&on_peer_added>>`.
+     * 
+     * @tparam function The function to invoke when the event occurs.
+     */
+    template <auto function>
+    struct FunctionListener
+    {
+        template <typename T>
+        static inline void on_event(int event_type, T event_data)
+        {
+            function(event_type, event_data);
+        }
+    };
+
+    /**
+     * @brief An event emitter with a listener set that is fixed at build time.
+     * Listeners are notified through direct calls that the compiler can
+     * inline, and the emitter requires no storage for listeners.
+     * 
+     * Runtime listener registration can be enabled by setting
+     * has_runtime_listeners, in which case the emitter is an EventEmitter,
+     * and can be used anywhere one is expected (including in deferred mode).
+     * Statically bound listeners are always notified first.
+     * 
+     * @tparam T The data type of the event payload.
+     * @tparam Listeners A ListenerList of the listener types to notify.
+     * @tparam has_runtime_listeners Whether or not listeners can also be
+     * registered at runtime.
+     */
+    template <typename T, typename Listeners, bool has_runtime_listeners = false>
+    class StaticEventEmitter;
+
+    template <typename T, typename... Listeners>
+    class StaticEventEmitter<T, ListenerList<Listeners...>, false>
+    {
+    private:
+        int event_type;
+
+    public:
+        /**
+         * @brief Construct a new static event emitter object
+         *
+         * @param event_type The type of the event, passed to each listener.
+         */
+        StaticEventEmitter(int event_type) : event_type(event_type) {}
+
+        /**
+         * @brief Notify all listeners of an event.
+         *
+         * @param event_data The event data to be passed to each listener.
+         */
+        inline void emit(T event_data)
+        {
+            (Listeners::on_event(this->event_type, event_data), ...);
+        }
+    };
+
+    template <typename T, typename... Listeners>
+    class StaticEventEmitter<T, ListenerList<Listeners...>, true> : public EventEmitter<T>
+    {
+    private:
+        int event_type;
+
+    public:
+        /**
+         * @brief Construct a new static event emitter object
+         *
+         * @param event_type The type of the event, passed to each listener.
+         */
+        StaticEventEmitter(int event_type) : EventEmitter<T>(event_type), event_type(event_type) {}
+
+        /**
+         * @brief Notify all statically bound listeners of an event, followed
+         * by the listeners registered at runtime. Invoked by emit(), or by the
+         * deferred queue when the emitter is in deferred mode.
+         *
+         * @param event_data The event data to be passed to each listener.
+         */
+        void dispatch(T event_data) override
+        {
+            (Listeners::on_event(this->event_type, event_data), ...);
+            EventEmitter<T>::dispatch(event_data);
+        }
+    };
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,119 @@
+#ifndef __STATIC_NODE_PROFILE_H
+#define __STATIC_NODE_PROFILE_H
+
+#include <Arduino.h>
+#include <type_traits>
+
+#include "log.h"
+#include "error_codes.h"
+#include "node.h"
+#include "node_profile.h"
+#include "static_peer.h"
+#include "static_event_emitter.h"
+
+namespace thingnet
+{
+    inline constinit Logger _static_node_profile_logger("static-prof");
+
+    /**
+     * @brief A node profile whose peers are all of a single type that is
+     * known at build time. Every peer the profile creates or restores is a
+     * PeerType. Messages are passed to the peers through a peer router (see
+     * Node::set_peer_router) instead of registering every peer as a message
+     * handler, and the router and the loops that update and prune peers call
+     * PeerType directly, so the compiler can bind (and inline) the calls. The
+     * profile and its peers can still be used through the runtime interfaces.
+     * 
+     * Peer added and peer removed listeners can also be bound at build time,
+     * in which case they are notified before any listeners registered at
+     * runtime.
+     * 
+     * For example:
+     * `new StaticNodeProfile<ServerNodeProfile>(&node)`
+     * 
+     * @tparam Profile The node profile to build on.
+     * @tparam PeerType The type of every peer in the profile. Must be final,
+     * and derive from PeerBase<PeerType>.
+     * @tparam PeerAddedListeners A ListenerList of peer added listeners.
+     * @tparam PeerRemovedListeners A ListenerList of peer removed listeners.
+     */
+    template <typename Profile,
+              typename PeerType = StaticBasicPeer,
+              typename PeerAddedListeners = ListenerList<>,
+              typename PeerRemovedListeners = ListenerList<>>
+    class StaticNodeProfile final : public Profile
+    {
+        static_assert(std::is_base_of_v<NodeProfile, Profile>, "Profile must be a node profile");
+        static_assert(std::is_base_of_v<PeerBase<PeerType>, PeerType>, "PeerType must derive from PeerBase<PeerType>");
+        static_assert(std::is_final_v<PeerType>, "PeerType must be final, so calls can be bound at build time");
+
+    private:
+        static PeerType *as_peer_type(Peer *peer) { return static_cast<PeerType *>(peer); }
+
+        /**
+         * @brief Passes a received message to the peer that it is from.
+         * 
+         * @param context The profile.
+         * @param message A pointer to the received message.
+         * @return ProcessingResult The result of processing the message, or
+         * ProcessingResult::chain if the message is not from a peer.
+         */
+        static ProcessingResult route_message(void *context, PeerMessage *message)
+        {
+            StaticNodeProfile *profile = static_cast<StaticNodeProfile *>(context);
+            for (Peer *peer : profile->peers)
+            {
+                PeerType *typed_peer = as_peer_type(peer);
+                if (typed_peer->static_can_handle(message))
+                {
+                    return typed_peer->static_process(message);
+                }
+            }
+            return ProcessingResult::chain;
+        }
+
+    protected:
+        Peer *new_peer(MacAddress mac_address, u32 timeout)
+        {
+            return new PeerType(this->node, mac_address, timeout);
+        }
+
+        void update_peers()
+        {
+            LOG_DEBUG(_static_node_profile_logger, "Updating [%d] peers", this->peers.size());
+            this->template update_peers_of<PeerType>();
+        }
+
+        u16 prune_peers()
+        {
+            return this->template prune_peers_of<PeerType>();
+        }
+
+    public:
+        StaticNodeProfile(Node *node) : Profile(node)
+        {
+            this->is_routing_peers = true;
+
+            if constexpr (!std::is_same_v<PeerAddedListeners, ListenerList<>> ||
+                          !std::is_same_v<PeerRemovedListeners, ListenerList<>>)
+            {
+                this->set_peer_events(
+                    new StaticEventEmitter<PeerListEventData, PeerAddedListeners, true>(PEER_ADDED_EVENT),
+                    new StaticEventEmitter<PeerListEventData, PeerRemovedListeners, true>(PEER_REMOVED_EVENT));
+            }
+        }
+
+        int init()
+        {
+            int result = Profile::init();
+            if (result != RESULT_OK)
+            {
+                return result;
+            }
+
+            return this->node->set_peer_router(&StaticNodeProfile::route_message, this);
+        }
+    };
+}
+
+#endif
\ No newline at end of file
@@ -7,7 +7,7 @@
 
 using namespace thingnet::utils;
 
-static Logger *logger = new Logger("gen-msgh");
+static constinit Logger logger("gen-msgh");
 
 namespace thingnet::message_handlers
 {
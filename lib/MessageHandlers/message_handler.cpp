@@ -6,7 +6,7 @@
 
 using namespace thingnet::utils;
 
-static Logger *logger = new Logger("msgh");
+static constinit Logger logger("msgh");
 
 namespace thingnet::message_handlers
 {
@@ -8,19 +8,19 @@
 
 using namespace thingnet::utils;
 
-static Logger *logger = new Logger("peer-msgh");
+static constinit Logger logger("peer-msgh");
 
 namespace thingnet::message_handlers
 {
-    PeerMessageHandler::PeerMessageHandler(u8 *peer_mac_address)
+    PeerMessageHandler::PeerMessageHandler(MacAddress peer_mac_address)
     {
         // Store the peer mac address for future comparison
-        memcpy(this->peer_mac_address, peer_mac_address, 6);
+        this->peer_mac_address = peer_mac_address;
     }
 
     bool PeerMessageHandler::can_handle(PeerMessage *message)
     {
-        if (memcmp(this->peer_mac_address, message->sender, 6) == 0)
+        if (this->peer_mac_address == message->sender)
         {
             return true;
         };
@@ -14,7 +14,7 @@ namespace thingnet::message_handlers
     class PeerMessageHandler : public MessageHandler
     {
     private:
-        u8 peer_mac_address[6];
+        MacAddress peer_mac_address;
 
     public:
         /**
@@ -23,7 +23,7 @@ namespace thingnet::message_handlers
          * @param peer_mac_address The mac address of the peer whose messages
          * will be handled by this handler.
          */
-        PeerMessageHandler(u8 *peer_mac_address);
+        PeerMessageHandler(MacAddress peer_mac_address);
 
         /**
          * @brief Returns true only if the message is from a peer that this
@@ -1,84 +1,225 @@
 #include <Arduino.h>
 
 #include "log.h"
+#include "clock.h"
 #include "error_codes.h"
 #include "messages.h"
 #include "basic_peer.h"
 
 using namespace thingnet::utils;
 
-static Logger *logger = new Logger("basic-peer");
-
 namespace thingnet::peers
 {
-    BasicPeer::BasicPeer(Node *node, u8 *peer_mac_address, u32 timeout)
-        : Peer(node, peer_mac_address)
+    // Smoothing follows the fixed point scheme used for TCP retransmit
+    // timers: means are stored scaled by 8 (gain 1/8) and mean deviations
+    // scaled by 4 (gain 1/4). Loss rate is stored in parts per thousand,
+    // scaled by 8.
+    static const u8 __MEAN_SHIFT = 3;
+    static const u8 __VARIANCE_SHIFT = 2;
+    static const u32 __LOSS_RATE_SCALE = 1000;
+    static const u32 __MAX_LOSS_RATE = 900;
+
+    /**
+     * @brief Updates a scaled mean/deviation pair with a new sample.
+     *
+     * @param mean Pointer to the mean, scaled by 8.
+     * @param variance Pointer to the mean deviation, scaled by 4.
+     * @param sample The new sample value.
+     * @param is_first Set to true if this is the first sample.
+     */
+    static void __update_estimate(u32 *mean, u32 *variance, u32 sample, bool is_first)
     {
-        this->timeout = timeout;
-        this->last_message_time = millis();
+        if (is_first)
+        {
+            *mean = sample << __MEAN_SHIFT;
+            *variance = sample << (__VARIANCE_SHIFT - 1);
+            return;
+        }
+
+        s32 delta = (s32)sample - (s32)(*mean >> __MEAN_SHIFT);
+        *mean = (u32)((s32)*mean + delta);
+        if (delta < 0)
+        {
+            delta = -delta;
+        }
+        delta -= (s32)(*variance >> __VARIANCE_SHIFT);
+        *variance = (u32)((s32)*variance + delta);
     }
 
-    BasicPeer::BasicPeer(Node *node, u8 *peer_mac_address)
+    BasicPeer::BasicPeer(Node *node, MacAddress peer_mac_address, u32 timeout)
+        : BasicPeerBase(node, peer_mac_address, timeout)
+    {
+    }
+
+    BasicPeer::BasicPeer(Node *node, MacAddress peer_mac_address)
         : BasicPeer(node, peer_mac_address, BASIC_PEER_DEFAULT_TIMEOUT)
     {
     }
 
-    ProcessingResult BasicPeer::process(PeerMessage *message)
+    LinkEstimator::LinkEstimator(u32 timeout)
     {
-        LOG_TRACE(logger, "Processing message");
-        this->last_message_time = millis();
+        this->timeout = timeout;
+        this->scaled_rtt = 0;
+        this->scaled_rtt_variance = 0;
+        this->scaled_interval = 0;
+        this->scaled_interval_variance = 0;
+        this->scaled_loss_rate = 0;
+        this->interval_sample_count = 0;
+        this->has_rtt_sample = false;
+        this->is_probe_pending = false;
 
-        int result = RESULT_OK;
-        if (message->payload.type == MSG_TYPE_HEARTBEAT)
-        {
-            LOG_DEBUG(logger, "[HEARTBEAT] Message id [%d] from [%s]",
-                      message->payload.message_id,
-                      LOG_FORMAT_MAC(message->sender));
+        this->link_stats.retransmit_timeout = BASIC_PEER_DEFAULT_RETRANSMIT_TIMEOUT;
+        this->link_stats.timeout = timeout;
+    }
 
-            MessagePayload payload(MSG_TYPE_ACK);
-            memcpy(payload.body, &message->payload.message_id, 2);
+    void LinkEstimator::record_heartbeat_sent()
+    {
+        this->link_stats.heartbeats_sent++;
+    }
 
-            result = this->node->send_message((u8 *)message->sender,
-                                              &payload, 2);
+    u32 LinkEstimator::record_heartbeat_received(u32 interval)
+    {
+        this->link_stats.heartbeats_received++;
+        if (interval == 0)
+        {
+            return 0;
         }
-        else if (message->payload.type == MSG_TYPE_ACK)
+
+        u32 missed = 0;
+        if (this->interval_sample_count >= BASIC_PEER_MIN_INTERVAL_SAMPLES)
         {
-            LOG_DEBUG(logger, "[ACK] from [%s] for message id [%02x:%02x]",
-                      LOG_FORMAT_MAC(message->sender),
-                      message->payload.body[0],
-                      message->payload.body[1]);
+            u32 expected = this->scaled_interval >> __MEAN_SHIFT;
+            if (expected > 0 && interval > expected + expected / 2)
+            {
+                missed = (interval + expected / 2) / expected - 1;
+            }
         }
-        else if (message->payload.type == MSG_TYPE_ADVERTISEMENT)
+
+        for (u32 index = 0; index < missed; index++)
         {
-            u8 mac_addr[6];
-            memcpy(mac_addr, message->payload.body, 6);
-            LOG_DEBUG(logger, "[ADVERTISEMENT] from [%s] for [%s]",
-                     LOG_FORMAT_MAC(message->sender),
-                     LOG_FORMAT_MAC(mac_addr));
+            this->record_heartbeat(true);
         }
-        else
+        this->record_heartbeat(false);
+        this->record_interval(interval / (missed + 1));
+
+        return missed;
+    }
+
+    void LinkEstimator::record_ack(u32 rtt)
+    {
+        this->link_stats.acks_received++;
+        this->record_rtt(rtt);
+        this->record_heartbeat(false);
+    }
+
+    void LinkEstimator::record_ack_missed()
+    {
+        this->record_heartbeat(true);
+    }
+
+    void LinkEstimator::start_probe(u32 timeout)
+    {
+        this->is_probe_pending = true;
+        this->link_stats.timeout = timeout;
+    }
+
+    void LinkEstimator::end_probe()
+    {
+        this->is_probe_pending = false;
+        this->update_timeout();
+    }
+
+    void LinkEstimator::record_heartbeat(bool lost)
+    {
+        u32 sample = lost ? __LOSS_RATE_SCALE : 0;
+
+        // Loss rate uses the same 1/8 gain as the mean estimates.
+        this->scaled_loss_rate -= this->scaled_loss_rate >> __MEAN_SHIFT;
+        this->scaled_loss_rate += sample;
+        this->link_stats.loss_rate = (u16)(this->scaled_loss_rate >> __MEAN_SHIFT);
+
+        this->update_timeout();
+    }
+
+    void LinkEstimator::record_interval(u32 interval)
+    {
+        __update_estimate(&this->scaled_interval,
+                          &this->scaled_interval_variance,
+                          interval,
+                          this->interval_sample_count == 0);
+
+        if (this->interval_sample_count < BASIC_PEER_MIN_INTERVAL_SAMPLES)
         {
-            LOG_WARN(logger, "[UNKNOWN] Message type [%02x] from [%s]",
-                     message->payload.type,
-                     LOG_FORMAT_MAC(message->sender));
+            this->interval_sample_count++;
         }
+        this->link_stats.heartbeat_interval = this->scaled_interval >> __MEAN_SHIFT;
 
-        return result == RESULT_OK ? ProcessingResult::handled : ProcessingResult::error;
+        this->update_timeout();
     }
 
-    bool BasicPeer::is_active()
+    void LinkEstimator::record_rtt(u32 rtt)
     {
-        return (millis() - this->last_message_time) < this->timeout;
+        __update_estimate(&this->scaled_rtt,
+                          &this->scaled_rtt_variance,
+                          rtt,
+                          !this->has_rtt_sample);
+        this->has_rtt_sample = true;
+
+        this->link_stats.smoothed_rtt = this->scaled_rtt >> __MEAN_SHIFT;
+        this->link_stats.rtt_variance = this->scaled_rtt_variance >> __VARIANCE_SHIFT;
+
+        // RTO = SRTT + 4 * RTTVAR, where the scaled variance already carries
+        // the factor of four. Rounded up to whole milliseconds.
+        u32 retransmit_timeout = (this->link_stats.smoothed_rtt + this->scaled_rtt_variance + 999) / 1000;
+        if (retransmit_timeout < BASIC_PEER_MIN_RETRANSMIT_TIMEOUT)
+        {
+            retransmit_timeout = BASIC_PEER_MIN_RETRANSMIT_TIMEOUT;
+        }
+        this->link_stats.retransmit_timeout = retransmit_timeout;
+
+        LOG_TRACE(_basic_peer_logger, "RTT sample [%d] us. SRTT [%d] us, RTO [%d] ms",
+                  rtt, this->link_stats.smoothed_rtt, this->link_stats.retransmit_timeout);
+
+        this->update_timeout();
     }
 
-    int BasicPeer::update()
+    void LinkEstimator::update_timeout()
     {
-        LOG_DEBUG(logger, "Sending heartbeat message to peer");
-        MessagePayload payload(MSG_TYPE_HEARTBEAT);
+        if (this->is_probe_pending)
+        {
+            // Keep the probe timeout until the peer responds.
+            return;
+        }
 
-        this->node->send_message((u8 *)this->peer_mac_address, &payload, 6);
+        if (this->interval_sample_count < BASIC_PEER_MIN_INTERVAL_SAMPLES)
+        {
+            // Not enough data yet - stick to the configured timeout.
+            this->link_stats.timeout = this->timeout;
+            return;
+        }
 
-        return RESULT_OK;
+        // Allow for a worst case heartbeat interval (mean + 4 deviations),
+        // and tolerate more missed heartbeats as the loss rate increases, so
+        // that the expected number of heartbeats received before eviction
+        // remains constant.
+        u32 interval = (this->scaled_interval >> __MEAN_SHIFT) +
+                       this->scaled_interval_variance;
+        u32 loss_rate = this->link_stats.loss_rate > __MAX_LOSS_RATE
+                            ? __MAX_LOSS_RATE
+                            : this->link_stats.loss_rate;
+        u64 timeout = (u64)interval * BASIC_PEER_MIN_MISSED_HEARTBEATS *
+                          __LOSS_RATE_SCALE / (__LOSS_RATE_SCALE - loss_rate) +
+                      this->link_stats.retransmit_timeout;
+
+        if (timeout < BASIC_PEER_MIN_TIMEOUT)
+        {
+            timeout = BASIC_PEER_MIN_TIMEOUT;
+        }
+        else if (timeout > BASIC_PEER_MAX_TIMEOUT)
+        {
+            timeout = BASIC_PEER_MAX_TIMEOUT;
+        }
+        this->link_stats.timeout = (u32)timeout;
     }
 
 }
\ No newline at end of file
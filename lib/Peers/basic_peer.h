@@ -3,52 +3,233 @@
 
 #include <Arduino.h>
 
+#include "log.h"
+#include "clock.h"
+#include "error_codes.h"
 #include "messages.h"
 #include "peer.h"
 
 namespace thingnet::peers
 {
+    inline constinit utils::Logger _basic_peer_logger("basic-peer");
+
     const u32 BASIC_PEER_DEFAULT_TIMEOUT = 60000;
+    const u32 BASIC_PEER_MIN_TIMEOUT = 3000;
+    const u32 BASIC_PEER_MAX_TIMEOUT = 300000;
+    const u32 BASIC_PEER_DEFAULT_RETRANSMIT_TIMEOUT = 1000;
+    const u32 BASIC_PEER_MIN_RETRANSMIT_TIMEOUT = 20;
+    const u8 BASIC_PEER_MIN_MISSED_HEARTBEATS = 3;
+    const u8 BASIC_PEER_MIN_INTERVAL_SAMPLES = 2;
+    // Warnings on the receive path can repeat for every frame, so they are
+    // limited to one per period.
+    const u32 __BASIC_PEER_WARNING_PERIOD = 1000;
+    // Round trip times are measured in microseconds. Samples are capped so
+    // that the scaled estimates cannot overflow.
+    const u32 __BASIC_PEER_MAX_RTT_SAMPLE = 10000000;
 
     /**
-     * @brief A very basic implementation of a remote peer. Does nothing other
-     * than track whether or not the remote peer is active based on time elapsed
-     * since the last message was received.
+     * @brief Link quality estimates for a peer, derived from the heartbeat
+     * exchange. Round trip times are in microseconds, and all other times are
+     * in milliseconds.
      */
-    class BasicPeer : public Peer
+    typedef struct LinkStats
+    {
+        u32 smoothed_rtt;
+        u32 rtt_variance;
+        u32 retransmit_timeout;
+        u32 heartbeat_interval;
+        u32 timeout;
+        u16 loss_rate;
+        u32 heartbeats_sent;
+        u32 heartbeats_received;
+        u32 acks_received;
+
+        LinkStats()
+        {
+            memset(this, 0, sizeof(LinkStats));
+        }
+    } LinkStats;
+
+    /**
+     * @brief Estimates the round trip time, heartbeat interval and loss rate
+     * of a link from the heartbeat exchange, and derives the timeout after
+     * which the peer is deemed inactive. Once enough samples have been
+     * collected, the estimates replace the configured timeout.
+     */
+    class LinkEstimator
     {
     private:
-        u64 last_message_time;
         u32 timeout;
+        u32 scaled_rtt;
+        u32 scaled_rtt_variance;
+        u32 scaled_interval;
+        u32 scaled_interval_variance;
+        u32 scaled_loss_rate;
+        u8 interval_sample_count;
+        bool has_rtt_sample;
+        bool is_probe_pending;
+        LinkStats link_stats;
+
+        /**
+         * @brief Records the outcome of a single heartbeat, updating the
+         * smoothed loss rate.
+         * 
+         * @param lost Set to true if the heartbeat was lost.
+         */
+        void record_heartbeat(bool lost);
+
+        /**
+         * @brief Records a round trip time sample, updating the smoothed round
+         * trip time and retransmit timeout.
+         * 
+         * @param rtt The round trip time in microseconds.
+         */
+        void record_rtt(u32 rtt);
+
+        /**
+         * @brief Recomputes the liveness timeout from the current estimates.
+         */
+        void update_timeout();
 
     public:
         /**
-         * @brief Construct a new basic peer object
+         * @brief Construct a new link estimator object
          * 
-         * @param node Reference to the node object that will be used for low
-         * level peer communication and management.
-         * @param peer_mac_address The mac address of the peer that is
-         * represented by this object
-         * @param timeout The number of milliseconds since the last message was
-         * received after which the peer will be deemed to be inactive.
+         * @param timeout The timeout to use until enough heartbeats have been
+         * exchanged to estimate an adaptive timeout, in milliseconds.
          */
-        BasicPeer(Node *node, u8 *peer_mac_address, u32 timeout);
+        LinkEstimator(u32 timeout);
 
         /**
-         * @brief Construct a new basic peer object. Sets the timeout to a
-         * default value of 300s.
+         * @brief Records the time between two successive heartbeats, updating
+         * the smoothed heartbeat interval.
+         * 
+         * @param interval The time between heartbeats in milliseconds.
+         */
+        void record_interval(u32 interval);
+
+        /**
+         * @brief Records a heartbeat sent to the peer.
+         */
+        void record_heartbeat_sent();
+
+        /**
+         * @brief Records a heartbeat received from the peer. A gap of more
+         * than one and a half expected intervals means that one or more
+         * heartbeats from the peer were lost.
+         * 
+         * @param interval The time since the previous heartbeat from the peer
+         * in milliseconds, or zero if this is the first heartbeat.
+         * @return u32 The number of heartbeats that were lost.
+         */
+        u32 record_heartbeat_received(u32 interval);
+
+        /**
+         * @brief Records the acknowledgement of a heartbeat sent to the peer.
+         * 
+         * @param rtt The round trip time in microseconds.
+         */
+        void record_ack(u32 rtt);
+
+        /**
+         * @brief Records a heartbeat sent to the peer that was never
+         * acknowledged.
+         */
+        void record_ack_missed();
+
+        /**
+         * @brief Replaces the timeout with a shorter one until the peer
+         * responds. See end_probe().
+         * 
+         * @param timeout The number of milliseconds to wait for a response.
+         */
+        void start_probe(u32 timeout);
+
+        /**
+         * @brief Restores the estimated timeout once the peer has responded
+         * to a probe.
+         */
+        void end_probe();
+
+        /**
+         * @brief Determines whether or not a probe is awaiting a response.
+         */
+        bool is_probing() { return this->is_probe_pending; }
+
+        /**
+         * @brief Gets the timeout after which the peer is deemed inactive.
+         * 
+         * @return u32 The timeout in milliseconds.
+         */
+        u32 get_active_timeout() { return this->link_stats.timeout; }
+
+        /**
+         * @brief Gets the timeout to persist for the peer, which excludes
+         * the probe timeout.
+         * 
+         * @return u32 The timeout in milliseconds.
+         */
+        u32 get_timeout() { return this->is_probe_pending ? this->timeout : this->link_stats.timeout; }
+
+        /**
+         * @brief Returns the current link quality estimates.
+         * 
+         * @return const LinkStats* Pointer to the link stats.
+         */
+        const LinkStats *get_link_stats() { return &this->link_stats; }
+    };
+
+    /**
+     * @brief The implementation of the basic peer, shared by BasicPeer and
+     * the peers whose type is known at build time (see PeerBase). Tracks
+     * whether or not the remote peer is active based on time elapsed since
+     * the last message was received.
+     * 
+     * Round trip time is estimated from matched HEARTBEAT/ACK message ids, and
+     * the heartbeat interval and loss rate are estimated from missing ACKs (on
+     * the sending side) or gaps between heartbeats (on the receiving side).
+     * See LinkEstimator.
+     * 
+     * @tparam Derived The peer type that derives from this class.
+     */
+    template <typename Derived>
+    class BasicPeerBase : public PeerBase<Derived>
+    {
+    private:
+        u64 last_message_time;
+        u64 last_heartbeat_time;
+        u64 pending_heartbeat_time;
+        u16 pending_message_id;
+        bool is_ack_pending;
+        LinkEstimator link;
+
+    public:
+        /**
+         * @brief Construct a new basic peer object
          * 
          * @param node Reference to the node object that will be used for low
          * level peer communication and management.
          * @param peer_mac_address The mac address of the peer that is
          * represented by this object
+         * @param timeout The number of milliseconds since the last message was
+         * received after which the peer will be deemed to be inactive. This
+         * value is used until enough heartbeats have been exchanged to estimate
+         * an adaptive timeout.
          */
-        BasicPeer(Node *node, u8 *peer_mac_address);
+        BasicPeerBase(Node *node, MacAddress peer_mac_address, u32 timeout)
+            : PeerBase<Derived>(node, peer_mac_address), link(timeout)
+        {
+            this->last_message_time = utils::Clock::now_millis();
+            this->last_heartbeat_time = 0;
+            this->pending_heartbeat_time = 0;
+            this->pending_message_id = 0;
+            this->is_ack_pending = false;
+        }
 
         /**
          * @brief Processes a message and returns a result that reflects the
          * result of the processing.
-         *
+         * 
          * @param message A pointer to the message that the handler will
          *        receive.
          * @return ProcessingResult::handled If the message was completely
@@ -60,15 +241,129 @@ namespace thingnet::peers
          * @return ProcessingResult::error If there was an error processing
          *         the message.
          */
-        virtual ProcessingResult process(PeerMessage *message);
+        ProcessingResult static_process(PeerMessage *message)
+        {
+            LOG_TRACE(_basic_peer_logger, "Processing message");
+            this->record_message(message);
+            u64 now = utils::Clock::now_millis();
+            this->last_message_time = now;
+
+            if (this->link.is_probing())
+            {
+                LOG_DEBUG(_basic_peer_logger, "Probe confirmed by [%s]", LOG_FORMAT_MAC(message->sender));
+                this->link.end_probe();
+            }
+
+            int result = RESULT_OK;
+            if (message->payload.type == MSG_TYPE_HEARTBEAT)
+            {
+                LOG_DEBUG(_basic_peer_logger, "[HEARTBEAT] Message id [%d] from [%s]",
+                          message->payload.message_id,
+                          LOG_FORMAT_MAC(message->sender));
+
+                u32 interval = this->last_heartbeat_time != 0 ? (u32)(now - this->last_heartbeat_time) : 0;
+                this->stats.heartbeat_misses += this->link.record_heartbeat_received(interval);
+                this->last_heartbeat_time = now;
+
+                MessagePayload payload(MSG_TYPE_ACK);
+                memcpy(payload.body, &message->payload.message_id, 2);
+
+                result = this->send_message(&payload, 2);
+            }
+            else if (message->payload.type == MSG_TYPE_ACK)
+            {
+                LOG_DEBUG(_basic_peer_logger, "[ACK] from [%s] for message id [%02x:%02x]",
+                          LOG_FORMAT_MAC(message->sender),
+                          message->payload.body[0],
+                          message->payload.body[1]);
+
+                u16 message_id;
+                memcpy(&message_id, message->payload.body, 2);
+                if (this->is_ack_pending && message_id == this->pending_message_id)
+                {
+                    this->is_ack_pending = false;
+                    u64 rtt = utils::Clock::now_micros() - this->pending_heartbeat_time;
+                    this->link.record_ack(rtt > __BASIC_PEER_MAX_RTT_SAMPLE ? __BASIC_PEER_MAX_RTT_SAMPLE : (u32)rtt);
+                }
+            }
+            else if (message->payload.type == MSG_TYPE_CONNECT)
+            {
+                // The peer has already been admitted, but did not receive the
+                // confirmation. Acknowledge the connect again.
+                LOG_DEBUG(_basic_peer_logger, "[CONNECT] Message id [%d] from connected peer [%s]",
+                          message->payload.message_id,
+                          LOG_FORMAT_MAC(message->sender));
+
+                MessagePayload payload(MSG_TYPE_ACK);
+                memcpy(payload.body, &message->payload.message_id, 2);
+
+                result = this->send_message(&payload, 2);
+            }
+            else if (message->payload.type == MSG_TYPE_DISCOVERY)
+            {
+                // The peer has lost its connection to this node. Let the node
+                // profile respond to the request.
+                LOG_DEBUG(_basic_peer_logger, "[DISCOVERY] from connected peer [%s]",
+                          LOG_FORMAT_MAC(message->sender));
+                return ProcessingResult::chain;
+            }
+            else if (message->payload.type == MSG_TYPE_ADVERTISEMENT)
+            {
+                MacAddress mac_addr = MacAddress::from_bytes(message->payload.body);
+                LOG_DEBUG(_basic_peer_logger, "[ADVERTISEMENT] from [%s] for [%s]",
+                          LOG_FORMAT_MAC(message->sender),
+                          LOG_FORMAT_MAC(mac_addr));
+
+                // Allow the node profile to track the load of the server.
+                return ProcessingResult::chain;
+            }
+            else
+            {
+                LOG_RATE_LIMITED(LOG_WARN, _basic_peer_logger, __BASIC_PEER_WARNING_PERIOD,
+                                 "[UNKNOWN] Message type [%02x] from [%s]",
+                                 message->payload.type,
+                                 LOG_FORMAT_MAC(message->sender));
+            }
+
+            return result == RESULT_OK ? ProcessingResult::handled : ProcessingResult::error;
+        }
 
         /**
-         * @brief Allows the peer to run periodic updates.
+         * @brief Sends a heartbeat to the peer, recording the previous one as
+         * lost if it was never acknowledged.
          * 
-         * @return int A non success value will be returned if the add operation
-         * resulted in an error. See error codes for more information.
+         * @return int A non success value will be returned if the send
+         * operation resulted in an error. See error codes for more information.
          */
-        virtual int update();
+        int static_update()
+        {
+            u64 now = utils::Clock::now_millis();
+
+            if (this->is_ack_pending)
+            {
+                LOG_DEBUG(_basic_peer_logger, "No ack received for heartbeat [%d]",
+                          this->pending_message_id);
+                this->stats.heartbeat_misses++;
+                this->link.record_ack_missed();
+            }
+
+            if (this->last_heartbeat_time != 0)
+            {
+                this->link.record_interval((u32)(now - this->last_heartbeat_time));
+            }
+
+            LOG_DEBUG(_basic_peer_logger, "Sending heartbeat message to peer");
+            MessagePayload payload(MSG_TYPE_HEARTBEAT);
+            payload.message_id = this->node->get_next_message_id();
+
+            this->pending_message_id = payload.message_id;
+            this->pending_heartbeat_time = utils::Clock::now_micros();
+            this->last_heartbeat_time = now;
+            this->is_ack_pending = true;
+            this->link.record_heartbeat_sent();
+
+            return this->send_message(&payload, 6);
+        }
 
         /**
          * @brief Determines whether or not the peer is still active based on
@@ -77,7 +372,79 @@ namespace thingnet::peers
          * @return true If the peer is still active
          * @return false If the peer is no longer active
          */
-        virtual bool is_active();
+        bool static_is_active()
+        {
+            return (utils::Clock::now_millis() - this->last_message_time) < this->link.get_active_timeout();
+        }
+
+        /**
+         * @brief Returns the current link quality estimates for the peer.
+         * 
+         * @return const LinkStats* Pointer to the link stats of the peer.
+         */
+        const LinkStats *get_link_stats()
+        {
+            return this->link.get_link_stats();
+        }
+
+        /**
+         * @brief Sends a heartbeat to the peer, and shortens the timeout until
+         * the first message is received from the peer.
+         * 
+         * @param timeout The number of milliseconds to wait for a response.
+         * @return int A non success value will be returned if the probe
+         * resulted in an error. See error codes for more information.
+         */
+        int probe(u32 timeout) override
+        {
+            LOG_DEBUG(_basic_peer_logger, "Probing peer");
+            this->last_message_time = utils::Clock::now_millis();
+            this->link.start_probe(timeout);
+
+            return this->derived()->static_update();
+        }
+
+        /**
+         * @brief Gets the current (adaptive) timeout of the peer.
+         * 
+         * @return u32 The timeout in milliseconds.
+         */
+        u32 get_timeout() override
+        {
+            return this->link.get_timeout();
+        }
+    };
+
+    /**
+     * @brief A very basic implementation of a remote peer, for use through the
+     * runtime Peer interface. Child classes can override the virtual methods
+     * of Peer as usual. See BasicPeerBase.
+     */
+    class BasicPeer : public BasicPeerBase<BasicPeer>
+    {
+    public:
+        /**
+         * @brief Construct a new basic peer object
+         * 
+         * @param node Reference to the node object that will be used for low
+         * level peer communication and management.
+         * @param peer_mac_address The mac address of the peer that is
+         * represented by this object
+         * @param timeout The number of milliseconds since the last message was
+         * received after which the peer will be deemed to be inactive.
+         */
+        BasicPeer(Node *node, MacAddress peer_mac_address, u32 timeout);
+
+        /**
+         * @brief Construct a new basic peer object. Sets the timeout to a
+         * default value of 60s.
+         * 
+         * @param node Reference to the node object that will be used for low
+         * level peer communication and management.
+         * @param peer_mac_address The mac address of the peer that is
+         * represented by this object
+         */
+        BasicPeer(Node *node, MacAddress peer_mac_address);
     };
 }
 
@@ -1,6 +1,7 @@
 #include <Arduino.h>
 
 #include "log.h"
+#include "clock.h"
 #include "error_codes.h"
 
 #include "node.h"
@@ -9,29 +10,66 @@
 
 using namespace thingnet::utils;
 
-static Logger *logger = new Logger("server-prof");
+static constinit Logger logger("peer");
 
 namespace thingnet::peers
 {
-    Peer::Peer(Node *node, u8 *peer_mac_address)
+    Peer::Peer(Node *node, MacAddress peer_mac_address)
     {
         this->node = node;
-        memcpy(this->peer_mac_address, peer_mac_address, 6);
+        this->peer_mac_address = peer_mac_address;
+        this->stats.last_seen_time = Clock::now_millis();
     }
 
-    int Peer::read_mac_address(u8 *buffer)
+    MacAddress Peer::get_mac_address()
     {
-        memcpy(buffer, this->peer_mac_address, 6);
-        return RESULT_OK;
+        return this->peer_mac_address;
+    }
+
+    bool Peer::has_mac_address(MacAddress input_mac)
+    {
+        return this->peer_mac_address == input_mac;
     }
 
     bool Peer::can_handle(PeerMessage *message)
     {
-        if (memcmp(this->peer_mac_address, message->sender, 6) == 0)
+        return this->has_mac_address(message->sender);
+    }
+
+    ProcessingResult Peer::process(PeerMessage *message)
+    {
+        this->record_message(message);
+
+        return ProcessingResult::handled;
+    }
+
+    int Peer::send_message(MessagePayload *payload, u8 data_size)
+    {
+        this->stats.frames_out++;
+        this->stats.bytes_out += data_size + 3;
+
+        int result = this->node->send_message(this->peer_mac_address, payload, data_size);
+        if (result != RESULT_OK)
         {
-            return true;
-        };
-        return false;
+            this->stats.send_failures++;
+        }
+
+        return result;
+    }
+
+    const PeerStats *Peer::get_stats()
+    {
+        return &this->stats;
+    }
+
+    u32 Peer::get_last_seen_age()
+    {
+        return (u32)(Clock::now_millis() - this->stats.last_seen_time);
+    }
+
+    void Peer::record_send_failure()
+    {
+        this->stats.send_failures++;
     }
 
     Peer::~Peer()
@@ -43,4 +81,14 @@ namespace thingnet::peers
     {
         return RESULT_OK;
     }
+
+    int Peer::probe(u32 timeout)
+    {
+        return RESULT_OK;
+    }
+
+    u32 Peer::get_timeout()
+    {
+        return 0;
+    }
 }
\ No newline at end of file
@@ -3,6 +3,8 @@
 
 #include <Arduino.h>
 
+#include "clock.h"
+#include "error_codes.h"
 #include "messages.h"
 #include "message_handler.h"
 #include "node.h"
@@ -11,6 +13,26 @@ using namespace thingnet::message_handlers;
 
 namespace thingnet::peers
 {
+    /**
+     * @brief Traffic statistics for a peer. Frame and byte counts include the
+     * message header.
+     */
+    typedef struct PeerStats
+    {
+        u32 frames_in;
+        u32 frames_out;
+        u32 bytes_in;
+        u32 bytes_out;
+        u32 heartbeat_misses;
+        u32 send_failures;
+        u64 last_seen_time;
+
+        PeerStats()
+        {
+            memset(this, 0, sizeof(PeerStats));
+        }
+    } PeerStats;
+
     /**
      * @brief Represents a remote peer that is connected to the current node.
      */
@@ -18,7 +40,32 @@ namespace thingnet::peers
     {
     protected:
         Node *node;
-        u8 peer_mac_address[6];
+        MacAddress peer_mac_address;
+        PeerStats stats;
+
+        /**
+         * @brief Sends a message to the peer, updating the outbound traffic
+         * statistics.
+         * 
+         * @param payload A pointer to the message payload
+         * @param data_size The length of the payload, not including headers
+         * @return int A non success value will be returned if the send
+         * operation resulted in an error. See error codes for more information.
+         */
+        int send_message(MessagePayload *payload, u8 data_size);
+
+        /**
+         * @brief Updates the inbound traffic statistics for a message received
+         * from the peer.
+         * 
+         * @param message A pointer to the message that was received.
+         */
+        void record_message(PeerMessage *message)
+        {
+            this->stats.frames_in++;
+            this->stats.bytes_in += message->body_length + 3;
+            this->stats.last_seen_time = utils::Clock::now_millis();
+        }
 
     public:
         /**
@@ -30,7 +77,7 @@ namespace thingnet::peers
          * @param peer_mac_address The mac address of the peer that is
          * represented by this object
          */
-        Peer(Node *node, u8 *peer_mac_address);
+        Peer(Node *node, MacAddress peer_mac_address);
 
         /**
          * @brief Destroy the Peer object
@@ -38,14 +85,20 @@ namespace thingnet::peers
         virtual ~Peer();
 
         /**
-         * @brief Copies the mac address of the current peer into the given
-         * buffer.
+         * @brief Gets the mac address of the current peer.
          * 
-         * @param buffer A buffer into which the mac address will be copied.
-         * @return int A non success value will be returned if the add operation
-         * resulted in an error. See error codes for more information.
+         * @return MacAddress The mac address of the peer.
          */
-        int read_mac_address(u8 *buffer);
+        MacAddress get_mac_address();
+
+        /**
+         * @brief Matches the input against the mac address of the peer.
+         * 
+         * @param input_mac The mac address to compare with the current peer.
+         * @return true If the input mac address matches the peer's mac address
+         * @return false If the input mac address does not match.
+         */
+        bool has_mac_address(MacAddress input_mac);
 
         /**
          * @brief Returns true only if the message is from a peer that this
@@ -58,6 +111,38 @@ namespace thingnet::peers
          */
         virtual bool can_handle(PeerMessage *message);
 
+        /**
+         * @brief Updates the inbound traffic statistics for the peer. Child
+         * classes that override this method should call it before processing
+         * the message.
+         *
+         * @param message A pointer to the message that the handler will
+         * receive.
+         * @return ProcessingResult::handled Always.
+         */
+        virtual ProcessingResult process(PeerMessage *message);
+
+        /**
+         * @brief Returns the traffic statistics for the peer.
+         * 
+         * @return const PeerStats* Pointer to the statistics of the peer.
+         */
+        const PeerStats *get_stats();
+
+        /**
+         * @brief Gets the time elapsed since a message was last received from
+         * the peer.
+         * 
+         * @return u32 The time in milliseconds.
+         */
+        u32 get_last_seen_age();
+
+        /**
+         * @brief Records a failed delivery to the peer, as reported by the
+         * transport.
+         */
+        void record_send_failure();
+
         /**
          * @brief Allows the peer to run periodic updates.
          * 
@@ -73,6 +158,67 @@ namespace thingnet::peers
          * @return false If the peer is no longer active
          */
         virtual bool is_active() = 0;
+
+        /**
+         * @brief Sends a lightweight message to confirm that a peer restored
+         * from a previous session is still present. The peer should be deemed
+         * inactive if it does not respond within the given timeout. The
+         * default implementation does nothing.
+         * 
+         * @param timeout The number of milliseconds to wait for a response.
+         * @return int A non success value will be returned if the probe
+         * resulted in an error. See error codes for more information.
+         */
+        virtual int probe(u32 timeout);
+
+        /**
+         * @brief Gets the time after which the peer will be deemed inactive if
+         * no messages are received from it.
+         * 
+         * @return u32 The timeout in milliseconds, or zero if the peer does
+         * not use a timeout.
+         */
+        virtual u32 get_timeout();
+    };
+
+    /**
+     * @brief A variant of Peer for peers whose type is known at build time,
+     * using the curiously recurring template pattern. The behaviour of the
+     * peer is implemented by the static_* methods of the derived type, which
+     * are not virtual, so callers that hold the derived type (such as
+     * StaticNodeProfile) bind them at build time and can inline them. The
+     * virtual methods of Peer forward to the same methods, so the peer can
+     * still be used anywhere a Peer is expected.
+     * 
+     * The derived type replaces the default behaviour by hiding the static_*
+     * methods, and must implement static_is_active(). For example:
+     * `class SensorPeer final : public PeerBase<SensorPeer> { ... };`
+     * 
+     * @tparam Derived The peer type that derives from this class.
+     */
+    template <typename Derived>
+    class PeerBase : public Peer
+    {
+    protected:
+        Derived *derived() { return static_cast<Derived *>(this); }
+
+    public:
+        using Peer::Peer;
+
+        bool can_handle(PeerMessage *message) override { return this->derived()->static_can_handle(message); }
+        ProcessingResult process(PeerMessage *message) override { return this->derived()->static_process(message); }
+        int update() override { return this->derived()->static_update(); }
+        bool is_active() override { return this->derived()->static_is_active(); }
+
+        bool static_can_handle(PeerMessage *message) { return this->peer_mac_address == message->sender; }
+
+        ProcessingResult static_process(PeerMessage *message)
+        {
+            this->record_message(message);
+            return ProcessingResult::handled;
+        }
+
+        int static_update() { return RESULT_OK; }
     };
 }
 
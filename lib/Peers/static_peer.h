@@ -0,0 +1,28 @@
+#ifndef __STATIC_PEER_H
+#define __STATIC_PEER_H
+
+#include <Arduino.h>
+
+#include "messages.h"
+#include "peer.h"
+#include "basic_peer.h"
+
+namespace thingnet::peers
+{
+    /**
+     * @brief A basic peer with its behaviour bound at build time. It behaves
+     * exactly like BasicPeer, but is final, so a StaticNodeProfile can call
+     * its static_* methods directly. See PeerBase.
+     *
+     * Peers with custom behaviour derive from BasicPeerBase (or PeerBase) in
+     * the same way, hiding the static_* methods they replace. For example:
+     * `class SensorPeer final : public BasicPeerBase<SensorPeer> { ... };`
+     */
+    class StaticBasicPeer final : public BasicPeerBase<StaticBasicPeer>
+    {
+    public:
+        using BasicPeerBase::BasicPeerBase;
+    };
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,108 @@
+#include <Arduino.h>
+#include <stdio.h>
+
+#include "log.h"
+#include "error_codes.h"
+#include "peer_store.h"
+#include "file_peer_store.h"
+
+using namespace thingnet::utils;
+
+static constinit Logger logger("file-store");
+
+namespace thingnet::storage
+{
+    static const u8 __MAX_PATH_LENGTH = 64;
+
+    int FilePeerStore::init()
+    {
+        if (this->is_initialized)
+        {
+            LOG_WARN(logger, "Peer store has already been initialized");
+            return RESULT_DUPLICATE;
+        }
+
+        this->is_initialized = true;
+        return RESULT_OK;
+    }
+
+    int FilePeerStore::load(PeerRecord *records, u8 max_count, u8 *count)
+    {
+        *count = 0;
+        if (!this->is_initialized)
+        {
+            LOG_ERROR(logger, "Peer store has not been initialized");
+            return ERR_STORAGE_INIT_FAILED;
+        }
+
+        FILE *file = fopen(this->path, "rb");
+        if (file == NULL)
+        {
+            LOG_DEBUG(logger, "No saved peers at [%s]", this->path);
+            return RESULT_NO_EXIST;
+        }
+
+        PeerFileHeader header;
+        if (fread(&header, 1, sizeof(PeerFileHeader), file) != sizeof(PeerFileHeader) ||
+            header.magic != PEER_FILE_MAGIC ||
+            header.version != PEER_FILE_VERSION)
+        {
+            LOG_WARN(logger, "Ignoring unrecognized peer file [%s]", this->path);
+            fclose(file);
+            return ERR_STORAGE_READ_FAILED;
+        }
+
+        u8 record_count = header.count > max_count ? max_count : header.count;
+        size_t size = record_count * sizeof(PeerRecord);
+        if (fread(records, 1, size, file) != size)
+        {
+            LOG_WARN(logger, "Peer file [%s] is truncated", this->path);
+            fclose(file);
+            return ERR_STORAGE_READ_FAILED;
+        }
+        fclose(file);
+
+        *count = record_count;
+        LOG_DEBUG(logger, "Loaded [%d] peers from [%s]", record_count, this->path);
+        return RESULT_OK;
+    }
+
+    int FilePeerStore::save(PeerRecord *records, u8 count)
+    {
+        if (!this->is_initialized)
+        {
+            LOG_ERROR(logger, "Peer store has not been initialized");
+            return ERR_STORAGE_INIT_FAILED;
+        }
+
+        char temp_path[__MAX_PATH_LENGTH];
+        snprintf(temp_path, __MAX_PATH_LENGTH, "%s.tmp", this->path);
+
+        FILE *file = fopen(temp_path, "wb");
+        if (file == NULL)
+        {
+            LOG_ERROR(logger, "Error opening [%s]", temp_path);
+            return ERR_STORAGE_WRITE_FAILED;
+        }
+
+        PeerFileHeader header;
+        header.magic = PEER_FILE_MAGIC;
+        header.version = PEER_FILE_VERSION;
+        header.count = count;
+
+        size_t size = count * sizeof(PeerRecord);
+        bool is_written = fwrite(&header, 1, sizeof(PeerFileHeader), file) == sizeof(PeerFileHeader) &&
+                          fwrite(records, 1, size, file) == size;
+        is_written = fclose(file) == 0 && is_written;
+
+        if (!is_written || rename(temp_path, this->path) != 0)
+        {
+            LOG_ERROR(logger, "Error writing [%s]", this->path);
+            remove(temp_path);
+            return ERR_STORAGE_WRITE_FAILED;
+        }
+
+        LOG_DEBUG(logger, "Saved [%d] peers to [%s]", count, this->path);
+        return RESULT_OK;
+    }
+}
\ No newline at end of file
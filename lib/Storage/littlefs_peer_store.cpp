@@ -0,0 +1,121 @@
+#include <Arduino.h>
+#include <LittleFS.h>
+
+#include "log.h"
+#include "error_codes.h"
+#include "peer_store.h"
+#include "littlefs_peer_store.h"
+
+using namespace thingnet::utils;
+
+static constinit Logger logger("lfs-store");
+
+namespace thingnet::storage
+{
+    static const u8 __MAX_PATH_LENGTH = 32;
+
+    int LittleFsPeerStore::init()
+    {
+        if (this->is_initialized)
+        {
+            LOG_WARN(logger, "Peer store has already been initialized");
+            return RESULT_DUPLICATE;
+        }
+
+        LOG_TRACE(logger, "Mounting file system");
+        if (!LittleFS.begin())
+        {
+            LOG_ERROR(logger, "Error mounting file system");
+            return ERR_STORAGE_INIT_FAILED;
+        }
+
+        this->is_initialized = true;
+        return RESULT_OK;
+    }
+
+    int LittleFsPeerStore::load(PeerRecord *records, u8 max_count, u8 *count)
+    {
+        *count = 0;
+        if (!this->is_initialized)
+        {
+            LOG_ERROR(logger, "Peer store has not been initialized");
+            return ERR_STORAGE_INIT_FAILED;
+        }
+
+        if (!LittleFS.exists(this->path))
+        {
+            LOG_DEBUG(logger, "No saved peers at [%s]", this->path);
+            return RESULT_NO_EXIST;
+        }
+
+        File file = LittleFS.open(this->path, "r");
+        if (!file)
+        {
+            LOG_ERROR(logger, "Error opening [%s]", this->path);
+            return ERR_STORAGE_READ_FAILED;
+        }
+
+        PeerFileHeader header;
+        if (file.read((u8 *)&header, sizeof(PeerFileHeader)) != sizeof(PeerFileHeader) ||
+            header.magic != PEER_FILE_MAGIC ||
+            header.version != PEER_FILE_VERSION)
+        {
+            LOG_WARN(logger, "Ignoring unrecognized peer file [%s]", this->path);
+            file.close();
+            return ERR_STORAGE_READ_FAILED;
+        }
+
+        u8 record_count = header.count > max_count ? max_count : header.count;
+        size_t size = record_count * sizeof(PeerRecord);
+        if (file.read((u8 *)records, size) != size)
+        {
+            LOG_WARN(logger, "Peer file [%s] is truncated", this->path);
+            file.close();
+            return ERR_STORAGE_READ_FAILED;
+        }
+        file.close();
+
+        *count = record_count;
+        LOG_DEBUG(logger, "Loaded [%d] peers from [%s]", record_count, this->path);
+        return RESULT_OK;
+    }
+
+    int LittleFsPeerStore::save(PeerRecord *records, u8 count)
+    {
+        if (!this->is_initialized)
+        {
+            LOG_ERROR(logger, "Peer store has not been initialized");
+            return ERR_STORAGE_INIT_FAILED;
+        }
+
+        char temp_path[__MAX_PATH_LENGTH];
+        snprintf(temp_path, __MAX_PATH_LENGTH, "%s.tmp", this->path);
+
+        File file = LittleFS.open(temp_path, "w");
+        if (!file)
+        {
+            LOG_ERROR(logger, "Error opening [%s]", temp_path);
+            return ERR_STORAGE_WRITE_FAILED;
+        }
+
+        PeerFileHeader header;
+        header.magic = PEER_FILE_MAGIC;
+        header.version = PEER_FILE_VERSION;
+        header.count = count;
+
+        size_t size = count * sizeof(PeerRecord);
+        bool is_written = file.write((u8 *)&header, sizeof(PeerFileHeader)) == sizeof(PeerFileHeader) &&
+                          file.write((u8 *)records, size) == size;
+        file.close();
+
+        if (!is_written || !LittleFS.rename(temp_path, this->path))
+        {
+            LOG_ERROR(logger, "Error writing [%s]", this->path);
+            LittleFS.remove(temp_path);
+            return ERR_STORAGE_WRITE_FAILED;
+        }
+
+        LOG_DEBUG(logger, "Saved [%d] peers to [%s]", count, this->path);
+        return RESULT_OK;
+    }
+}
\ No newline at end of file
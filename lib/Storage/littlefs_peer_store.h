@@ -0,0 +1,62 @@
+#ifndef __LITTLEFS_PEER_STORE_H
+#define __LITTLEFS_PEER_STORE_H
+
+#include <Arduino.h>
+
+#include "peer_store.h"
+
+namespace thingnet::storage
+{
+    /**
+     * @brief A peer store that saves peer records to a file on the LittleFS
+     * flash file system. Records are written to a temporary file that then
+     * replaces the previous file, so that a reset during a write does not
+     * corrupt the saved records.
+     */
+    class LittleFsPeerStore : public PeerStore
+    {
+    private:
+        const char *path;
+        bool is_initialized;
+
+    public:
+        /**
+         * @brief Construct a new LittleFS peer store object
+         * 
+         * @param path The path of the file in which records will be saved.
+         */
+        constexpr LittleFsPeerStore(const char *path) : path(path), is_initialized(false) {}
+
+        /**
+         * @brief Mounts the file system.
+         * 
+         * @return int A non success value will be returned if the init
+         * operation resulted in an error. See error codes for more information.
+         */
+        int init();
+
+        /**
+         * @brief Loads previously saved peer records.
+         * 
+         * @param records A buffer into which the records will be read.
+         * @param max_count The maximum number of records that the buffer can
+         * hold.
+         * @param count Set to the number of records that were read.
+         * @return int A non success value will be returned if the load
+         * operation resulted in an error. See error codes for more information.
+         */
+        int load(PeerRecord *records, u8 max_count, u8 *count);
+
+        /**
+         * @brief Saves peer records, replacing any previously saved records.
+         * 
+         * @param records The records to save.
+         * @param count The number of records to save.
+         * @return int A non success value will be returned if the save
+         * operation resulted in an error. See error codes for more information.
+         */
+        int save(PeerRecord *records, u8 count);
+    };
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,11 @@
+#include <Arduino.h>
+
+#include "peer_store.h"
+
+namespace thingnet::storage
+{
+    PeerStore::~PeerStore()
+    {
+        // Nothing to release here.
+    }
+}
\ No newline at end of file
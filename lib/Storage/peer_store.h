@@ -0,0 +1,84 @@
+#ifndef __PEER_STORE_H
+#define __PEER_STORE_H
+
+#include <Arduino.h>
+
+namespace thingnet::storage
+{
+    // Identifies a peer record file, and the layout of the records in it.
+    const u16 PEER_FILE_MAGIC = 0x4E54;
+    const u8 PEER_FILE_VERSION = 1;
+
+    /**
+     * @brief A persisted entry from the peer registry of a node profile.
+     */
+    typedef struct PeerRecord
+    {
+        u8 mac_address[6];
+        u8 role;
+        u32 timeout;
+    } PeerRecord;
+
+    /**
+     * @brief Header written at the start of a peer record file, followed by
+     * count records.
+     */
+    typedef struct PeerFileHeader
+    {
+        u16 magic;
+        u8 version;
+        u8 count;
+    } PeerFileHeader;
+
+    /**
+     * @brief Base class for peer stores, which persist the peer registry of a
+     * node profile across restarts. Implementations can use any storage
+     * medium, such as flash (see LittleFsPeerStore) or a plain file when
+     * running on a host.
+     */
+    class PeerStore
+    {
+    public:
+        /**
+         * @brief Construct a new peer store object
+         */
+        constexpr PeerStore() {}
+
+        /**
+         * @brief Destroy the peer store object
+         */
+        virtual ~PeerStore();
+
+        /**
+         * @brief Allows the store to initialize the underlying storage medium.
+         * 
+         * @return int A non success value will be returned if the init
+         * operation resulted in an error. See error codes for more information.
+         */
+        virtual int init() = 0;
+
+        /**
+         * @brief Loads previously saved peer records.
+         * 
+         * @param records A buffer into which the records will be read.
+         * @param max_count The maximum number of records that the buffer can
+         * hold.
+         * @param count Set to the number of records that were read.
+         * @return int A non success value will be returned if the load
+         * operation resulted in an error. See error codes for more information.
+         */
+        virtual int load(PeerRecord *records, u8 max_count, u8 *count) = 0;
+
+        /**
+         * @brief Saves peer records, replacing any previously saved records.
+         * 
+         * @param records The records to save.
+         * @param count The number of records to save.
+         * @return int A non success value will be returned if the save
+         * operation resulted in an error. See error codes for more information.
+         */
+        virtual int save(PeerRecord *records, u8 count) = 0;
+    };
+}
+
+#endif
\ No newline at end of file
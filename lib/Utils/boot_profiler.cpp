@@ -0,0 +1,99 @@
+#include <Arduino.h>
+
+#include "log.h"
+#include "boot_profiler.h"
+
+using namespace thingnet::utils;
+
+static constinit Logger logger("boot");
+
+namespace thingnet::utils
+{
+    BootProfiler::BootProfiler()
+    {
+        this->phase_count = 0;
+        this->is_complete = false;
+    }
+
+    BootProfiler &BootProfiler::get_instance()
+    {
+        static BootProfiler instance;
+        return instance;
+    }
+
+    int BootProfiler::mark(const char *name)
+    {
+        if (this->phase_count >= __MAX_BOOT_PHASES)
+        {
+            return 1;
+        }
+
+        BootPhase *phase = &this->phases[this->phase_count];
+        phase->name = name;
+        phase->timestamp = micros();
+        this->phase_count++;
+
+        if (this->is_complete)
+        {
+            this->log_phase(this->phase_count - 1);
+        }
+
+        return 0;
+    }
+
+    int BootProfiler::complete()
+    {
+        if (this->is_complete)
+        {
+            return 1;
+        }
+
+        this->mark("boot");
+        this->is_complete = true;
+
+        LOG_INFO(logger, "Boot completed in [%d] us", this->phases[this->phase_count - 1].timestamp);
+        for (u8 index = 0; index < this->phase_count; index++)
+        {
+            this->log_phase(index);
+        }
+
+        return 0;
+    }
+
+    void BootProfiler::log_phase(u8 index)
+    {
+        BootPhase *phase = &this->phases[index];
+        u32 previous = index > 0 ? this->phases[index - 1].timestamp : 0;
+
+        LOG_INFO(logger, "%-14s %8d us (+%d)",
+                 phase->name,
+                 phase->timestamp,
+                 phase->timestamp - previous);
+    }
+
+    u8 BootProfiler::get_phase_count()
+    {
+        return this->phase_count;
+    }
+
+    const BootPhase *BootProfiler::get_phase(u8 index)
+    {
+        if (index >= this->phase_count)
+        {
+            return 0;
+        }
+        return &this->phases[index];
+    }
+
+    const BootPhase *BootProfiler::find_phase(const char *name)
+    {
+        for (u8 index = 0; index < this->phase_count; index++)
+        {
+            if (strcmp(this->phases[index].name, name) == 0)
+            {
+                return &this->phases[index];
+            }
+        }
+        return 0;
+    }
+}
\ No newline at end of file
@@ -0,0 +1,105 @@
+#ifndef __BOOT_PROFILER_H
+#define __BOOT_PROFILER_H
+
+#include <Arduino.h>
+
+namespace thingnet::utils
+{
+    const u8 __MAX_BOOT_PHASES = 16;
+
+    /**
+     * @brief A named point in the boot sequence, and the time at which it was
+     * reached.
+     */
+    typedef struct BootPhase
+    {
+        const char *name;
+        u32 timestamp;
+    } BootPhase;
+
+    /**
+     * @brief Records the time taken by each phase of the boot sequence, so
+     * that the phases that dominate the time to first frame can be
+     * identified. Each phase is marked when it completes, and a summary is
+     * logged once boot is complete. Phases marked after boot completes (such
+     * as the first frame) are logged as they occur.
+     */
+    class BootProfiler
+    {
+    private:
+        BootPhase phases[__MAX_BOOT_PHASES];
+        u8 phase_count;
+        bool is_complete;
+
+        BootProfiler();
+
+        /**
+         * @brief Logs the given phase, along with the time since the previous
+         * phase.
+         * 
+         * @param index The index of the phase to log.
+         */
+        void log_phase(u8 index);
+
+    public:
+        /**
+         * @brief Get the instance object
+         *
+         * @return BootProfiler&
+         */
+        static BootProfiler &get_instance();
+
+        /**
+         * @brief Records the completion of a boot phase. Phases beyond the
+         * maximum phase count are ignored.
+         * 
+         * @param name The name of the phase. This must be a string literal, or
+         * otherwise remain valid for the lifetime of the program.
+         * @return int A non success value will be returned if the mark
+         * operation resulted in an error. See error codes for more information.
+         */
+        int mark(const char *name);
+
+        /**
+         * @brief Marks the boot sequence as complete, and logs a summary of
+         * the phases recorded so far. This method will have no effect if boot
+         * has already been completed.
+         * 
+         * @return int A non success value will be returned if the complete
+         * operation resulted in an error. See error codes for more information.
+         */
+        int complete();
+
+        /**
+         * @brief Gets the number of phases that have been recorded.
+         * 
+         * @return u8 The number of phases.
+         */
+        u8 get_phase_count();
+
+        /**
+         * @brief Gets a recorded phase.
+         * 
+         * @param index The index of the phase.
+         * @return const BootPhase* Pointer to the phase, or a null value if
+         * the index is out of range.
+         */
+        const BootPhase *get_phase(u8 index);
+
+        /**
+         * @brief Finds a recorded phase by name.
+         * 
+         * @param name The name of the phase.
+         * @return const BootPhase* Pointer to the phase, or a null value if
+         * the phase has not been recorded.
+         */
+        const BootPhase *find_phase(const char *name);
+
+        // Singleton implementation.
+        // See: https://stackoverflow.com/questions/1008019/c-singleton-design-pattern
+        BootProfiler(BootProfiler const &) = delete;
+        void operator=(BootProfiler const &) = delete;
+    };
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,25 @@
+#ifndef __BOUNDS_CHECK_H
+#define __BOUNDS_CHECK_H
+
+#include <Arduino.h>
+#include "log.h"
+
+/**
+ * @brief Checks the index and capacity preconditions of the containers. The
+ * checks are only compiled in when CONTAINER_BOUNDS_CHECK is defined, which
+ * is intended for debug builds. A failed check is fatal.
+ */
+#ifdef CONTAINER_BOUNDS_CHECK
+#define BOUNDS_CHECK(expr)                                                                            \
+  {                                                                                                   \
+    if (!(expr))                                                                                      \
+    {                                                                                                 \
+      LOG_FATAL("Bounds check failed: (%s) [%s, line %d]", #expr, __FILE__, __LINE__);                \
+      exit(1);                                                                                        \
+    }                                                                                                 \
+  }
+#else
+#define BOUNDS_CHECK(expr)
+#endif
+
+#endif
\ No newline at end of file
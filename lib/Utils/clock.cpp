@@ -0,0 +1,37 @@
+#include <Arduino.h>
+#include "clock.h"
+
+namespace thingnet::utils
+{
+    static clock_source_t __clock_source = 0;
+    static u32 __last_micros = 0;
+    static u32 __micros_epoch = 0;
+
+    u64 Clock::now_micros()
+    {
+        if (__clock_source != 0)
+        {
+            return __clock_source();
+        }
+
+        u32 now = micros();
+        if (now < __last_micros)
+        {
+            // The hardware counter has wrapped since the last read.
+            __micros_epoch++;
+        }
+        __last_micros = now;
+
+        return ((u64)__micros_epoch << 32) | now;
+    }
+
+    u64 Clock::now_millis()
+    {
+        return Clock::now_micros() / 1000;
+    }
+
+    void Clock::set_source(clock_source_t source)
+    {
+        __clock_source = source;
+    }
+}
\ No newline at end of file
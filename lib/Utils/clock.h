@@ -0,0 +1,53 @@
+#ifndef __CLOCK_H
+#define __CLOCK_H
+
+#include <Arduino.h>
+
+namespace thingnet::utils
+{
+    /**
+     * @brief A function that returns the current time in microseconds. Used to
+     * replace the hardware clock, on the host for example.
+     */
+    typedef u64 (*clock_source_t)();
+
+    /**
+     * @brief A monotonic 64 bit microsecond clock, that extends the 32 bit
+     * micros() counter across its wraparound (every 71 minutes). Timestamps
+     * from this clock can be compared and subtracted safely for the lifetime
+     * of the device.
+     * 
+     * Wraparound is detected when the clock is read, so the clock must be
+     * read at least once per wrap period. The timer service reads it on every
+     * pass of the main loop. The clock must not be read from an interrupt
+     * handler.
+     */
+    class Clock
+    {
+    public:
+        /**
+         * @brief Gets the current time.
+         * 
+         * @return u64 The time since startup, in microseconds.
+         */
+        static u64 now_micros();
+
+        /**
+         * @brief Gets the current time.
+         * 
+         * @return u64 The time since startup, in milliseconds.
+         */
+        static u64 now_millis();
+
+        /**
+         * @brief Replaces the source of the clock, allowing time to be
+         * controlled when running off the device.
+         * 
+         * @param source The function that will provide the current time, or a
+         * null value to use the hardware clock.
+         */
+        static void set_source(clock_source_t source);
+    };
+}
+
+#endif
\ No newline at end of file
@@ -1,6 +1,6 @@
 #include <Arduino.h>
 
-#include "timer.h"
+#include "clock.h"
 #include "debounced_input.h"
 
 using namespace thingnet::utils;
@@ -10,9 +10,19 @@ namespace thingnet::utils
     DebouncedInput::DebouncedInput(uint8_t pin, u64 duration, bool trigger_low)
     {
         this->pin = pin;
-        this->trigger_detected = false;
-        this->debounce_timer = new Timer(duration);
-        this->debounce_timer->stop();
+        this->duration = (u32)(duration * 1000);
+        this->is_interrupt_enabled = false;
+        this->edge_head = 0;
+        this->edge_tail = 0;
+        this->overflow_count = 0;
+        this->overflow_time = 0;
+        this->handled_overflow_count = 0;
+        this->candidate_time = 0;
+        this->bounce_start_time = 0;
+        this->is_bouncing = false;
+        this->press_start_time = 0;
+        this->press_duration = 0;
+        this->is_press_pending = false;
         if (trigger_low)
         {
             this->trigger_value = LOW;
@@ -23,6 +33,12 @@ namespace thingnet::utils
             this->trigger_value = HIGH;
             pinMode(this->pin, INPUT);
         }
+
+        // The input starts released, so that an input that is already held
+        // is reported as a press once it has been debounced.
+        this->stable_level = !this->trigger_value;
+        this->candidate_level = this->stable_level;
+        this->sampled_level = this->stable_level;
     }
 
     DebouncedInput::DebouncedInput(uint8_t pin, u64 duration)
@@ -30,35 +46,157 @@ namespace thingnet::utils
     {
     }
 
-    bool DebouncedInput::is_triggered()
+    DebouncedInput::~DebouncedInput()
     {
-        if (!this->trigger_detected)
+        if (this->is_interrupt_enabled)
         {
-            // We haven't sensed a trigger yet. Check to see if there's one now.
-            if (digitalRead(this->pin) == this->trigger_value)
-            {
-                // We've detected a trigger.
-                this->trigger_detected = true;
-                this->debounce_timer->start();
-            }
+            detachInterrupt(digitalPinToInterrupt(this->pin));
+        }
+    }
+
+    int DebouncedInput::enable_interrupts()
+    {
+        if (this->is_interrupt_enabled)
+        {
+            return 1;
+        }
+
+        this->is_interrupt_enabled = true;
+        attachInterruptArg(digitalPinToInterrupt(this->pin), DebouncedInput::on_edge, this, CHANGE);
+
+        // Edges before the handler was attached were not seen.
+        u8 level = digitalRead(this->pin);
+        if (level != this->sampled_level)
+        {
+            this->record_edge(level, micros());
+        }
+        return 0;
+    }
 
-            return false;
+    void IRAM_ATTR DebouncedInput::on_edge(void *context)
+    {
+        DebouncedInput *input = (DebouncedInput *)context;
+        input->record_edge(digitalRead(input->pin), micros());
+    }
+
+    void IRAM_ATTR DebouncedInput::record_edge(u8 level, u32 time)
+    {
+        u8 next_head = (this->edge_head + 1) & (__MAX_INPUT_EDGES - 1);
+        if (next_head == this->edge_tail)
+        {
+            this->overflow_time = time;
+            this->overflow_count = this->overflow_count + 1;
+            return;
         }
 
-        // If we've come this far, that means a trigger was previously detected.
-        if (this->debounce_timer->is_complete())
+        this->edges[this->edge_head].time = time;
+        this->edges[this->edge_head].level = level;
+        this->edge_head = next_head;
+        this->sampled_level = level;
+    }
+
+    void DebouncedInput::settle(u32 time)
+    {
+        if (!this->is_bouncing || time - this->candidate_time < this->duration)
         {
-            // The debounce period has completed - return true if the pin
-            // reports the trigger value.
-            this->trigger_detected = false;
-            bool result = digitalRead(this->pin) == this->trigger_value;
+            return;
+        }
 
-            return result;
+        this->is_bouncing = false;
+        if (this->candidate_level == this->stable_level)
+        {
+            // The input bounced, but came back to where it was.
+            return;
+        }
+
+        this->stable_level = this->candidate_level;
+        if (this->stable_level == this->trigger_value)
+        {
+            this->press_start_time = this->bounce_start_time;
+            this->is_press_pending = true;
         }
         else
         {
-            // Still waiting for the debounce period to expire.
-            return false;
+            this->press_duration = this->bounce_start_time - this->press_start_time;
+        }
+    }
+
+    void DebouncedInput::update()
+    {
+        u32 now = (u32)Clock::now_micros();
+        if (!this->is_interrupt_enabled)
+        {
+            u8 level = digitalRead(this->pin);
+            if (level != this->sampled_level)
+            {
+                this->record_edge(level, now);
+            }
+        }
+
+        // Only the overflows seen before draining are handled, so that the
+        // pin is always read after the dropped edges.
+        u8 overflow_count = this->overflow_count;
+        u32 overflow_time = this->overflow_time;
+
+        u32 last_edge_time = this->candidate_time;
+        while (this->edge_tail != this->edge_head)
+        {
+            InputEdge edge;
+            edge.time = this->edges[this->edge_tail].time;
+            edge.level = this->edges[this->edge_tail].level;
+            this->edge_tail = (this->edge_tail + 1) & (__MAX_INPUT_EDGES - 1);
+
+            this->settle(edge.time);
+            if (!this->is_bouncing)
+            {
+                this->is_bouncing = true;
+                this->bounce_start_time = edge.time;
+            }
+            this->candidate_level = edge.level;
+            this->candidate_time = edge.time;
+            last_edge_time = edge.time;
+        }
+
+        if (overflow_count != this->handled_overflow_count)
+        {
+            // Edges were dropped, so the level after them is unknown. Treat
+            // the pin as having changed to its current level with the last
+            // dropped edge, which restarts the debounce period.
+            this->handled_overflow_count = overflow_count;
+            if (!this->is_bouncing)
+            {
+                this->is_bouncing = true;
+                this->bounce_start_time = overflow_time;
+            }
+            this->candidate_level = digitalRead(this->pin);
+            this->candidate_time =
+                (s32)(overflow_time - last_edge_time) > 0 ? overflow_time : last_edge_time;
+            this->sampled_level = this->candidate_level;
+        }
+
+        this->settle(now);
+    }
+
+    bool DebouncedInput::is_triggered()
+    {
+        this->update();
+        bool result = this->is_press_pending;
+        this->is_press_pending = false;
+        return result;
+    }
+
+    bool DebouncedInput::is_active()
+    {
+        this->update();
+        return this->stable_level == this->trigger_value;
+    }
+
+    u32 DebouncedInput::get_press_duration()
+    {
+        if (this->is_active())
+        {
+            return ((u32)Clock::now_micros() - this->press_start_time) / 1000;
         }
+        return this->press_duration / 1000;
     }
 }
\ No newline at end of file
@@ -2,21 +2,94 @@
 #define __DEBOUNCED_INPUT_H
 
 #include <Arduino.h>
-#include "timer.h"
 
 namespace thingnet::utils
 {
+    // Must be a power of two.
+    const u8 __MAX_INPUT_EDGES = 8;
+
+    /**
+     * @brief An edge seen on an input, and the level of the input after it.
+     */
+    typedef struct InputEdge
+    {
+        u32 time;
+        u8 level;
+    } InputEdge;
+
     /**
      * @brief Abstracted class that can detect a detect a digital high/low after
      * debouncing for a preset duration.
+     * 
+     * Edges on the input are recorded, with their timestamps, into a small
+     * buffer, and are only debounced when the input is queried. The input is
+     * considered stable once it has not changed for the debounce duration,
+     * and a press is timed from the first edge of the bounce that started it,
+     * so press durations do not depend on how often the input is queried.
+     * 
+     * By default the input is polled, and an edge can only be seen if the
+     * input is queried while the pin is at the new level. Once interrupts are
+     * enabled, edges are recorded by an interrupt handler instead, so short
+     * presses are not missed and nothing is polled.
      */
     class DebouncedInput
     {
     private:
         uint8_t pin;
         uint8_t trigger_value;
-        bool trigger_detected;
-        Timer *debounce_timer;
+        u32 duration;
+        bool is_interrupt_enabled;
+
+        // Written by the interrupt handler.
+        volatile InputEdge edges[__MAX_INPUT_EDGES];
+        volatile u8 edge_head;
+        volatile u8 edge_tail;
+        volatile u8 overflow_count;
+        volatile u32 overflow_time;
+
+        u8 handled_overflow_count;
+        u8 sampled_level;
+        u8 stable_level;
+        u8 candidate_level;
+        u32 candidate_time;
+        u32 bounce_start_time;
+        bool is_bouncing;
+        u32 press_start_time;
+        u32 press_duration;
+        bool is_press_pending;
+
+        /**
+         * @brief The interrupt handler, called on every edge of the pin.
+         * 
+         * @param context The debounced input.
+         */
+        static void on_edge(void *context);
+
+        /**
+         * @brief Records an edge on the input, from the interrupt handler or
+         * when polling. Edges that arrive while the edge buffer is full are
+         * dropped, and the input is resynchronized from the pin when it is
+         * next queried.
+         * 
+         * @param level The level of the input after the edge.
+         * @param time The time of the edge, in microseconds. This must use the
+         * same time base as Clock, truncated to 32 bits.
+         */
+        void record_edge(u8 level, u32 time);
+
+        /**
+         * @brief Settles the input if it has been stable for the debounce
+         * duration at the given time.
+         * 
+         * @param time The time, in microseconds.
+         */
+        void settle(u32 time);
+
+        /**
+         * @brief Processes the recorded edges, and brings the debounced state
+         * of the input up to date.
+         */
+        void update();
 
     public:
         /**
@@ -38,14 +111,45 @@ namespace thingnet::utils
          */
         DebouncedInput(uint8_t pin, u64 duration);
 
+        /**
+         * @brief Destroy the Debounced Input object, detaching the interrupt
+         * handler if interrupts are enabled.
+         */
+        ~DebouncedInput();
+
+        /**
+         * @brief Records edges on the input from an interrupt handler, rather
+         * than by polling the pin.
+         * 
+         * @return int 1 if interrupts are already enabled, 0 otherwise.
+         */
+        int enable_interrupts();
+
         /**
          * @brief Detects whether or not the input has been triggered after
-         * the specified debounce period.
+         * the specified debounce period. Each press is reported once.
          *
          * @return true The input has been triggered
          * @return false The input has not been triggered
          */
         bool is_triggered();
+
+        /**
+         * @brief Determines whether or not the debounced input is currently at
+         * the trigger value.
+         * 
+         * @return true The input is pressed
+         * @return false The input is not pressed
+         */
+        bool is_active();
+
+        /**
+         * @brief Gets the duration of the current press, or of the last press
+         * if the input is not pressed.
+         * 
+         * @return u32 The duration of the press in milliseconds.
+         */
+        u32 get_press_duration();
     };
 }
 
@@ -0,0 +1,79 @@
+#include <Arduino.h>
+
+#include "clock.h"
+#include "debounced_input_bank.h"
+
+namespace thingnet::utils
+{
+    DebouncedInputBank::DebouncedInputBank(u16 pin_mask, u16 trigger_low_mask, u32 duration)
+    {
+        this->pin_mask = pin_mask;
+        this->trigger_low_mask = trigger_low_mask & pin_mask;
+        this->state = 0;
+        this->count_low = 0;
+        this->count_high = 0;
+        this->rising_edges = 0;
+        this->falling_edges = 0;
+        this->sample_period = duration >= 4 ? duration / 4 : 1;
+        this->sample_time = 0;
+        this->source = 0;
+
+        for (u8 pin = 0; pin < 16; pin++)
+        {
+            if ((this->pin_mask & (1 << pin)) == 0)
+            {
+                continue;
+            }
+            pinMode(pin, (this->trigger_low_mask & (1 << pin)) ? INPUT_PULLUP : INPUT);
+        }
+    }
+
+    void DebouncedInputBank::set_source(input_source_t source)
+    {
+        this->source = source;
+    }
+
+    bool DebouncedInputBank::update()
+    {
+        // The edges of the last sample are kept until the next one, however
+        // often the bank is updated in between.
+        u64 now = Clock::now_millis();
+        if (now - this->sample_time < this->sample_period)
+        {
+            return false;
+        }
+        this->sample_time = now;
+
+        u16 levels = this->source != 0 ? this->source() : (u16)GPI;
+        u16 sample = (levels ^ this->trigger_low_mask) & this->pin_mask;
+
+        // Count the samples that differ from the debounced state, resetting
+        // the count of any input that matches it. An input changes state when
+        // its count wraps back to zero.
+        u16 delta = sample ^ this->state;
+        this->count_high = (this->count_high ^ this->count_low) & delta;
+        this->count_low = ~this->count_low & delta;
+        u16 toggle = delta & ~(this->count_low | this->count_high);
+
+        this->state ^= toggle;
+        this->rising_edges = toggle & this->state;
+        this->falling_edges = toggle & ~this->state;
+
+        return true;
+    }
+
+    u16 DebouncedInputBank::get_state()
+    {
+        return this->state;
+    }
+
+    u16 DebouncedInputBank::get_rising_edges()
+    {
+        return this->rising_edges;
+    }
+
+    u16 DebouncedInputBank::get_falling_edges()
+    {
+        return this->falling_edges;
+    }
+}
\ No newline at end of file
@@ -0,0 +1,94 @@
+#ifndef __DEBOUNCED_INPUT_BANK_H
+#define __DEBOUNCED_INPUT_BANK_H
+
+#include <Arduino.h>
+
+namespace thingnet::utils
+{
+    /**
+     * @brief A function that returns the levels of GPIO 0 to 15 as a bit mask.
+     * Used to replace the GPIO input register, on the host for example.
+     */
+    typedef u16 (*input_source_t)();
+
+    /**
+     * @brief Debounces up to 16 inputs (GPIO 0 to 15) at once. All of the
+     * inputs are sampled with a single read of the GPIO input register, and
+     * each input has a two bit counter, stored across two masks (a vertical
+     * counter), so every input is debounced with a handful of bitwise
+     * operations per sample, however many inputs there are.
+     * 
+     * An input changes state after it has been sampled at the new level four
+     * times in a row. Inputs are reported as active (1) when they are at
+     * their trigger value.
+     */
+    class DebouncedInputBank
+    {
+    private:
+        u16 pin_mask;
+        u16 trigger_low_mask;
+        u16 state;
+        u16 count_low;
+        u16 count_high;
+        u16 rising_edges;
+        u16 falling_edges;
+        u32 sample_period;
+        u64 sample_time;
+        input_source_t source;
+
+    public:
+        /**
+         * @brief Construct a new Debounced Input Bank object
+         * 
+         * @param pin_mask The GPIO pins to debounce, as a bit mask.
+         * @param trigger_low_mask The pins that are triggered when low, as a
+         * bit mask. These pins are configured with pull ups.
+         * @param duration The debounce duration in milliseconds. Inputs are
+         * sampled four times over this duration.
+         */
+        DebouncedInputBank(u16 pin_mask, u16 trigger_low_mask, u32 duration);
+
+        /**
+         * @brief Replaces the source of the input levels, allowing inputs to
+         * be simulated when running off the device.
+         * 
+         * @param source The function that will provide the input levels, or
+         * a null value to read the GPIO input register.
+         */
+        void set_source(input_source_t source);
+
+        /**
+         * @brief Samples the inputs if a sample is due. This is a non blocking
+         * call that will typically be made from within the main loop.
+         * 
+         * @return true If the inputs were sampled.
+         * @return false If a sample was not yet due.
+         */
+        bool update();
+
+        /**
+         * @brief Gets the debounced state of the inputs.
+         * 
+         * @return u16 A bit mask of the inputs that are active.
+         */
+        u16 get_state();
+
+        /**
+         * @brief Gets the inputs that became active when the inputs were last
+         * sampled. The edges are kept until the next sample is taken.
+         * 
+         * @return u16 A bit mask of the inputs that became active.
+         */
+        u16 get_rising_edges();
+
+        /**
+         * @brief Gets the inputs that became inactive when the inputs were
+         * last sampled. The edges are kept until the next sample is taken.
+         * 
+         * @return u16 A bit mask of the inputs that became inactive.
+         */
+        u16 get_falling_edges();
+    };
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,173 @@
+#ifndef __FLAT_MAP_H
+#define __FLAT_MAP_H
+
+#include <Arduino.h>
+
+#include "bounds_check.h"
+#include "static_vector.h"
+
+namespace thingnet::utils
+{
+    /**
+     * @brief A map with a fixed capacity, stored inline without using the
+     * heap. Keys are kept sorted in their own array, so lookups are a binary
+     * search over contiguous keys, and the values can be iterated as an
+     * array. Inserts and erases shift the entries after them.
+     * 
+     * @tparam K The key type. Must support < and == comparison.
+     * @tparam V The value type. Must be default constructible and copyable.
+     * @tparam N The capacity.
+     */
+    template <typename K, typename V, u16 N>
+    class FlatMap
+    {
+    private:
+        StaticVector<K, N> keys;
+        StaticVector<V, N> values;
+
+        /**
+         * @brief Finds the position of the first key that is not less than
+         * the given key.
+         */
+        u16 lower_bound(const K &key) const
+        {
+            u16 first = 0;
+            u16 length = this->keys.size();
+            while (length > 0)
+            {
+                u16 half = length / 2;
+                if (this->keys[first + half] < key)
+                {
+                    first += half + 1;
+                    length -= half + 1;
+                }
+                else
+                {
+                    length = half;
+                }
+            }
+            return first;
+        }
+
+    public:
+        constexpr FlatMap() {}
+
+        static constexpr u16 capacity() { return N; }
+        u16 size() const { return this->keys.size(); }
+        bool is_empty() const { return this->keys.is_empty(); }
+        bool is_full() const { return this->keys.is_full(); }
+
+        /**
+         * @brief Finds the value for a key.
+         * 
+         * @param key The key.
+         * @return V* A pointer to the value, or a null value if the key is not
+         * in the map. The pointer is invalidated by inserts and erases.
+         */
+        V *find(const K &key)
+        {
+            u16 index = this->lower_bound(key);
+            if (index < this->keys.size() && this->keys[index] == key)
+            {
+                return &this->values[index];
+            }
+            return 0;
+        }
+
+        bool contains(const K &key) { return this->find(key) != 0; }
+
+        /**
+         * @brief Adds a key and value to the map.
+         * 
+         * @param key The key.
+         * @param value The value.
+         * @return int 0 if the entry was added, or 1 if the key is already in
+         * the map, or the map is full.
+         */
+        int insert(const K &key, const V &value)
+        {
+            u16 index = this->lower_bound(key);
+            if ((index < this->keys.size() && this->keys[index] == key) || this->is_full())
+            {
+                return 1;
+            }
+            this->keys.insert(index, key);
+            this->values.insert(index, value);
+            return 0;
+        }
+
+        /**
+         * @brief Removes a key and its value from the map.
+         * 
+         * @param key The key.
+         * @return int 0 if the entry was removed, or 1 if the key is not in
+         * the map.
+         */
+        int erase(const K &key)
+        {
+            u16 index = this->lower_bound(key);
+            if (index >= this->keys.size() || !(this->keys[index] == key))
+            {
+                return 1;
+            }
+            this->erase_at(index);
+            return 0;
+        }
+
+        /**
+         * @brief Removes the entry at a position.
+         * 
+         * @param index The position of the entry, in key order.
+         */
+        void erase_at(u16 index)
+        {
+            this->keys.erase(index);
+            this->values.erase(index);
+        }
+
+        /**
+         * @brief Removes all entries that match a predicate in a single pass.
+         * 
+         * @param predicate A function that is given each key and value, in key
+         * order, and returns true for the entries to remove.
+         * @return u16 The number of entries removed.
+         */
+        template <typename P>
+        u16 remove_if(P predicate)
+        {
+            u16 count = this->keys.size();
+            u16 kept_count = 0;
+            for (u16 index = 0; index < count; index++)
+            {
+                if (predicate(this->keys[index], this->values[index]))
+                {
+                    continue;
+                }
+                if (kept_count != index)
+                {
+                    this->keys[kept_count] = this->keys[index];
+                    this->values[kept_count] = this->values[index];
+                }
+                kept_count++;
+            }
+
+            this->keys.truncate(kept_count);
+            this->values.truncate(kept_count);
+            return count - kept_count;
+        }
+
+        const K &key_at(u16 index) const { return this->keys[index]; }
+        V &value_at(u16 index) { return this->values[index]; }
+
+        V *begin() { return this->values.begin(); }
+        V *end() { return this->values.end(); }
+
+        void clear()
+        {
+            this->keys.clear();
+            this->values.clear();
+        }
+    };
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,88 @@
+#ifndef __INDEX_POOL_H
+#define __INDEX_POOL_H
+
+#include <Arduino.h>
+
+#include "bounds_check.h"
+
+namespace thingnet::utils
+{
+    /**
+     * @brief Allocates indices from 0 to N - 1, for managing a fixed set of
+     * slots (frames, channels, table entries) without using the heap. Free
+     * indices are tracked in a bitmap, so allocation scans 32 slots at a time
+     * and always returns the lowest free index.
+     * 
+     * @tparam N The number of indices.
+     */
+    template <u16 N>
+    class IndexPool
+    {
+    private:
+        static constexpr u16 WORD_COUNT = (N + 31) / 32;
+
+        u32 used[WORD_COUNT];
+        u16 used_count;
+
+    public:
+        constexpr IndexPool() : used(), used_count(0) {}
+
+        static constexpr u16 capacity() { return N; }
+        u16 get_used_count() const { return this->used_count; }
+        u16 get_available_count() const { return N - this->used_count; }
+
+        /**
+         * @brief Allocates the lowest free index.
+         * 
+         * @param index The allocated index.
+         * @return int 0 if an index was allocated, or 1 if all indices are in
+         * use.
+         */
+        int allocate(u16 *index)
+        {
+            for (u16 word = 0; word < WORD_COUNT; word++)
+            {
+                u32 free_bits = ~this->used[word];
+                if (free_bits == 0)
+                {
+                    continue;
+                }
+
+                u16 candidate = word * 32 + __builtin_ctz(free_bits);
+                if (candidate >= N)
+                {
+                    break;
+                }
+                this->used[word] |= 1UL << (candidate & 31);
+                this->used_count++;
+                *index = candidate;
+                return 0;
+            }
+            return 1;
+        }
+
+        /**
+         * @brief Returns an index to the pool. This method does nothing if the
+         * index is not in use.
+         * 
+         * @param index The index to release.
+         */
+        void release(u16 index)
+        {
+            BOUNDS_CHECK(index < N);
+            if (!this->is_allocated(index))
+            {
+                return;
+            }
+            this->used[index / 32] &= ~(1UL << (index & 31));
+            this->used_count--;
+        }
+
+        bool is_allocated(u16 index) const
+        {
+            return index < N && (this->used[index / 32] & (1UL << (index & 31))) != 0;
+        }
+    };
+}
+
+#endif
\ No newline at end of file
@@ -3,37 +3,386 @@
 
 namespace thingnet::utils
 {
-    static char __mac_str[18];
+    static_assert((LOG_BUFFER_SIZE & (LOG_BUFFER_SIZE - 1)) == 0,
+                  "LOG_BUFFER_SIZE must be a power of two");
 
-    char *__log_format_mac(u8 *mac_addr)
+    static const u32 __LOG_BUFFER_MASK = LOG_BUFFER_SIZE - 1;
+    static const char *__LOG_LINE_END = "\r\n";
+
+    // Log output is held in a single producer, single consumer ring buffer.
+    // Messages are written from the loop and from the radio callbacks, which
+    // do not preempt each other, and are only consumed from the loop. The
+    // indices run freely, and are masked when the buffer is accessed.
+    static char __log_buffer[LOG_BUFFER_SIZE];
+    static volatile u32 __log_head = 0;
+    static volatile u32 __log_tail = 0;
+    static volatile u32 __log_dropped_count = 0;
+    static u32 __log_reported_dropped_count = 0;
+
+    // Messages are formatted here before being copied into the ring buffer.
+    // Loggers are only used from the loop and the radio callbacks, which do
+    // not preempt each other, so a single buffer can be shared.
+    static char __log_scratch[LOG_MESSAGE_MAX_LEN];
+
+    typedef struct LevelOverride
+    {
+        char module_name[LOG_MAX_MODULE_NAME_LEN];
+        u8 level;
+    } LevelOverride;
+
+    static LevelOverride __level_overrides[LOG_MAX_LEVEL_OVERRIDES];
+    static u8 __level_override_count = 0;
+    static u8 __default_level = LOG_DEFAULT_LEVEL;
+
+    u8 Logger::current_generation = 0;
+
+    static void __log_copy(u32 position, const char *data, u32 length)
+    {
+        u32 offset = position & __LOG_BUFFER_MASK;
+        u32 first_length = LOG_BUFFER_SIZE - offset;
+        if (first_length > length)
+        {
+            first_length = length;
+        }
+
+        memcpy(&__log_buffer[offset], data, first_length);
+        memcpy(__log_buffer, data + first_length, length - first_length);
+    }
+
+    static bool __log_write(const char *leader, u32 leader_length,
+                            const char *message, u32 message_length,
+                            const char *line_end)
+    {
+        u32 head = __log_head;
+        u32 line_end_length = line_end != 0 ? 2 : 0;
+        u32 length = leader_length + message_length + line_end_length;
+        if (length > LOG_BUFFER_SIZE - (head - __log_tail))
+        {
+            // Never wait for space, as the caller may be a radio callback.
+            return false;
+        }
+
+        __log_copy(head, leader, leader_length);
+        __log_copy(head + leader_length, message, message_length);
+        if (line_end != 0)
+        {
+            __log_copy(head + leader_length + message_length, line_end, line_end_length);
+        }
+
+        // Publish the message only once it has been completely written.
+        __asm__ __volatile__("" ::: "memory");
+        __log_head = head + length;
+
+        return true;
+    }
+
+    static void __log_report_drops()
     {
-        sprintf(__mac_str,
+        if (__log_dropped_count == __log_reported_dropped_count)
+        {
+            return;
+        }
+
+        u32 dropped_count = __log_dropped_count;
+        char leader[32];
+        char message[48];
+        int leader_length = sprintf(leader, LOG_LEADER_FORMAT, "WRN", "log");
+        int length = sprintf(message, "Dropped [%u] log messages",
+                             dropped_count - __log_reported_dropped_count);
+        if (__log_write(leader, leader_length, message, length, __LOG_LINE_END))
+        {
+            __log_reported_dropped_count = dropped_count;
+        }
+    }
+
+    LogMacAddress::LogMacAddress(const u8 *mac_addr)
+    {
+        memcpy(this->bytes, mac_addr, 6);
+        this->format();
+    }
+
+    void LogMacAddress::format()
+    {
+#ifdef LOG_BINARY
+        // Formatted by the log decoder instead.
+        this->text[0] = 0;
+#else
+        sprintf(this->text,
                 "%02x:%02x:%02x:%02x:%02x:%02x",
-                mac_addr[0],
-                mac_addr[1],
-                mac_addr[2],
-                mac_addr[3],
-                mac_addr[4],
-                mac_addr[5]);
-        return __mac_str;
+                this->bytes[0],
+                this->bytes[1],
+                this->bytes[2],
+                this->bytes[3],
+                this->bytes[4],
+                this->bytes[5]);
+#endif
+    }
+
+    LogRecord::LogRecord(const char *level, const char *message, const char *module_name)
+    {
+        u32 message_address = (u32)(uintptr_t)message;
+        u32 module_address = (u32)(uintptr_t)module_name;
+
+        this->data[0] = LOG_RECORD_SYNC;
+        this->data[2] = level[0];
+        memcpy(&this->data[3], &message_address, 4);
+        memcpy(&this->data[7], &module_address, 4);
+        this->length = 11;
+        this->is_truncated = false;
+    }
+
+    bool LogRecord::append(u8 tag, const void *value, u16 size)
+    {
+        if (this->is_truncated || this->length + 1 + size > (u16)sizeof(this->data))
+        {
+            // Arguments that do not fit are omitted, along with any that
+            // follow them, and are shown as missing by the decoder.
+            this->is_truncated = true;
+            return false;
+        }
+
+        this->data[this->length] = tag;
+        memcpy(&this->data[this->length + 1], value, size);
+        this->length += 1 + size;
+        return true;
+    }
+
+    void LogRecord::add(int value)
+    {
+        this->append('i', &value, 4);
+    }
+
+    void LogRecord::add(unsigned int value)
+    {
+        this->append('i', &value, 4);
+    }
+
+    void LogRecord::add(long value)
+    {
+        this->add((long long)value);
+    }
+
+    void LogRecord::add(unsigned long value)
+    {
+        this->add((unsigned long long)value);
+    }
+
+    void LogRecord::add(long long value)
+    {
+        this->append('l', &value, 8);
+    }
+
+    void LogRecord::add(unsigned long long value)
+    {
+        this->append('l', &value, 8);
     }
 
-    Logger::Logger(const char *module_name)
+    void LogRecord::add(double value)
     {
-        this->module_name = module_name;
+        this->append('f', &value, 8);
+    }
+
+    void LogRecord::add(const char *value)
+    {
+        u16 available = sizeof(this->data) - this->length;
+        if (this->is_truncated || available < 2)
+        {
+            this->is_truncated = true;
+            return;
+        }
+
+        // Long strings are truncated to fit the record.
+        size_t length = strlen(value);
+        if (length > (size_t)(available - 2))
+        {
+            length = available - 2;
+        }
+
+        this->data[this->length] = 's';
+        this->data[this->length + 1] = length;
+        memcpy(&this->data[this->length + 2], value, length);
+        this->length += 2 + length;
+    }
+
+    void LogRecord::add(const LogMacAddress &value)
+    {
+        this->append('m', value.bytes, 6);
+    }
+
+    int LogRecord::commit()
+    {
+        __log_report_drops();
+
+        this->data[1] = this->length - 2;
+        if (!__log_write((const char *)this->data, this->length, "", 0, 0))
+        {
+            __log_dropped_count = __log_dropped_count + 1;
+            return 0;
+        }
+
+        return 1;
+    }
+
+    int LogRateLimiter::allow(u32 period, u32 *suppressed_count)
+    {
+        u32 now = millis();
+        if (this->is_started && now - this->period_start_time < period)
+        {
+            this->suppressed_count++;
+            return 0;
+        }
+
+        *suppressed_count = this->suppressed_count;
+        this->suppressed_count = 0;
+        this->period_start_time = now;
+        this->is_started = true;
+        return 1;
+    }
+
+    void Logger::refresh_level()
+    {
+        this->level = __default_level;
+        for (u8 index = 0; index < __level_override_count; index++)
+        {
+            if (strcmp(__level_overrides[index].module_name, this->module_name) == 0)
+            {
+                this->level = __level_overrides[index].level;
+                break;
+            }
+        }
+        this->generation = Logger::current_generation;
+    }
+
+    u8 Logger::get_level()
+    {
+        return this->level;
+    }
+
+    int Logger::set_level(const char *module_name, u8 level)
+    {
+        if (strcmp(module_name, "*") == 0)
+        {
+            __default_level = level;
+            __level_override_count = 0;
+            Logger::current_generation++;
+            return 1;
+        }
+
+        u8 index = 0;
+        while (index < __level_override_count &&
+               strcmp(__level_overrides[index].module_name, module_name) != 0)
+        {
+            index++;
+        }
+
+        if (index == __level_override_count)
+        {
+            if (__level_override_count >= LOG_MAX_LEVEL_OVERRIDES)
+            {
+                return 0;
+            }
+
+            strncpy(__level_overrides[index].module_name, module_name, LOG_MAX_MODULE_NAME_LEN - 1);
+            __level_overrides[index].module_name[LOG_MAX_MODULE_NAME_LEN - 1] = 0;
+            __level_override_count++;
+        }
+
+        __level_overrides[index].level = level;
+        Logger::current_generation++;
+        return 1;
+    }
+
+    u8 Logger::get_default_level()
+    {
+        return __default_level;
+    }
+
+    u8 Logger::get_level_override_count()
+    {
+        return __level_override_count;
+    }
+
+    int Logger::get_level_override(u8 index, const char **module_name, u8 *level)
+    {
+        if (index >= __level_override_count)
+        {
+            return 0;
+        }
+
+        *module_name = __level_overrides[index].module_name;
+        *level = __level_overrides[index].level;
+        return 1;
     }
 
     void Logger::log(const char *level, const char *message, ...)
     {
+        __log_report_drops();
+
         va_list v_args;
         va_start(v_args, message);
-        vsprintf(this->buffer, message, v_args);
+        int length = vsnprintf(__log_scratch, LOG_MESSAGE_MAX_LEN, message, v_args);
         va_end(v_args);
 
+        if (length < 0)
+        {
+            return;
+        }
+        if (length >= LOG_MESSAGE_MAX_LEN)
+        {
+            length = LOG_MESSAGE_MAX_LEN - 1;
+        }
+
         char leader[32];
-        sprintf(leader, LOG_LEADER_FORMAT, level, this->module_name);
+        int leader_length = sprintf(leader, LOG_LEADER_FORMAT, level, this->module_name);
+        if (!__log_write(leader, leader_length, __log_scratch, length, __LOG_LINE_END))
+        {
+            __log_dropped_count = __log_dropped_count + 1;
+        }
+    }
+
+    u16 Logger::flush(u16 byte_budget, bool is_blocking)
+    {
+        u32 head = __log_head;
+        u32 tail = __log_tail;
+        u16 written = 0;
+
+        while (tail != head && written < byte_budget)
+        {
+            u32 offset = tail & __LOG_BUFFER_MASK;
+            u32 length = head - tail;
+            if (length > LOG_BUFFER_SIZE - offset)
+            {
+                // Write up to the end of the buffer, and wrap on the next pass.
+                length = LOG_BUFFER_SIZE - offset;
+            }
+            if (length > (u32)(byte_budget - written))
+            {
+                length = byte_budget - written;
+            }
+            if (!is_blocking)
+            {
+                int available = Serial.availableForWrite();
+                if (available <= 0)
+                {
+                    break;
+                }
+                if (length > (u32)available)
+                {
+                    length = available;
+                }
+            }
+
+            Serial.write((const u8 *)&__log_buffer[offset], length);
+            tail += length;
+            written += length;
+        }
 
-        Serial.print(leader);
-        Serial.println(this->buffer);
+        __log_tail = tail;
+        return written;
+    }
+
+    u32 Logger::get_dropped_count()
+    {
+        return __log_dropped_count;
     }
 }
\ No newline at end of file
@@ -11,20 +11,167 @@
 #define LOG_LEVEL_DEBUG 5
 #define LOG_LEVEL_TRACE 6
 
+#define LOG_LEVEL_OFF 0
+#define LOG_MAX_LEVEL_OVERRIDES 16
+#define LOG_MAX_MODULE_NAME_LEN 16
+
+#ifdef LOG_LEVEL
+#define LOG_DEFAULT_LEVEL LOG_LEVEL
+#else
+#define LOG_DEFAULT_LEVEL LOG_LEVEL_OFF
+#endif
+
 #define LOG_LEADER_FORMAT "[%3s|%12s] "
 #define LOG_MESSAGE_MAX_LEN 255
 
+// Size of the buffer that holds log output until it is written to serial.
+// Must be a power of two.
+#ifndef LOG_BUFFER_SIZE
+#define LOG_BUFFER_SIZE 2048
+#endif
+
+// Binary log records start with a byte that never appears in text output, so
+// that a decoder can separate records from plain text.
+#define LOG_RECORD_SYNC 0xFE
+#define LOG_RECORD_MAX_LEN 255
+
 namespace thingnet::utils
 {
+    /**
+     * @brief A mac address captured for logging. Each instance holds its own
+     * copy of the address, so that several addresses can be used in the same
+     * log statement. This type exists for use with logging related macros,
+     * and should not be used directly.
+     */
+    typedef struct LogMacAddress
+    {
+        u8 bytes[6];
+        char text[18];
+
+        /**
+         * @brief Construct a new log mac address object
+         * 
+         * @param mac_addr A byte array that represents the mac address. Only
+         * the first six bytes of this array will be used.
+         */
+        LogMacAddress(const u8 *mac_addr);
+
+        /**
+         * @brief Construct a new log mac address object from a mac address
+         * type that can write itself out as bytes.
+         * 
+         * @param mac_addr The mac address.
+         */
+        template <typename T>
+            requires requires(const T &address, u8 *buffer) { address.to_bytes(buffer); }
+        LogMacAddress(const T &mac_addr)
+        {
+            mac_addr.to_bytes(this->bytes);
+            this->format();
+        }
+
+    private:
+        void format();
+    } LogMacAddress;
+
+    /**
+     * @brief A binary log record, used when LOG_BINARY is defined. Instead of
+     * formatted text, the record holds the addresses of the format string and
+     * module name, which remain in the firmware image, followed by the raw
+     * argument values. The log decoder tool rebuilds the text on the host.
+     * 
+     * Records are framed as the sync byte, the payload length, and the
+     * payload. The payload consists of the level character, the format string
+     * and module name addresses (4 bytes each, little endian), and the
+     * arguments. Each argument is a type tag followed by its value:
+     * - 'i': a 4 byte integer
+     * - 'l': an 8 byte integer
+     * - 'f': an 8 byte double
+     * - 's': a 1 byte length, followed by the string bytes
+     * - 'm': a 6 byte mac address
+     */
+    class LogRecord
+    {
+    private:
+        u8 data[LOG_RECORD_MAX_LEN + 2];
+        u16 length;
+        // Set once an argument has been omitted, so that later arguments are
+        // omitted as well, rather than being decoded in its place.
+        bool is_truncated;
+
+        bool append(u8 tag, const void *value, u16 size);
+
+    public:
+        /**
+         * @brief Construct a new log record object
+         * 
+         * @param level The log level of the record.
+         * @param message The format string of the record.
+         * @param module_name The name of the module creating the record.
+         */
+        LogRecord(const char *level, const char *message, const char *module_name);
+
+        void add(int value);
+        void add(unsigned int value);
+        void add(long value);
+        void add(unsigned long value);
+        void add(long long value);
+        void add(unsigned long long value);
+        void add(double value);
+        void add(const char *value);
+        void add(const LogMacAddress &value);
+
+        /**
+         * @brief Writes the record to the log buffer.
+         * 
+         * @return int 1 if the record was written, or 0 if it was dropped.
+         */
+        int commit();
+    };
+
+    /**
+     * @brief Tracks the messages emitted by a single log statement, allowing
+     * it to be rate limited. This type exists for use with logging related
+     * macros, and should not be used directly.
+     */
+    typedef struct LogRateLimiter
+    {
+        u32 period_start_time;
+        u32 suppressed_count;
+        bool is_started;
+
+        /**
+         * @brief Determines whether or not a message can be emitted.
+         * 
+         * @param period The minimum time between messages, in milliseconds.
+         * @param suppressed_count Set to the number of messages that were
+         * suppressed since the last message, if the message is allowed.
+         * @return int 1 if the message can be emitted, 0 otherwise.
+         */
+        int allow(u32 period, u32 *suppressed_count);
+    } LogRateLimiter;
+
     /**
      * @brief An object that encapsulates metadata for a given module, and
      * allows the creation of log statements.
+     * 
+     * Loggers hold no buffers, and can be constant initialized, so that they
+     * are usable before static initialization runs and cost no heap:
+     * `static constinit Logger logger("module");`. Messages are formatted in
+     * a scratch buffer that is shared by all loggers.
      */
     class Logger
     {
     private:
         const char *module_name;
-        char buffer[LOG_MESSAGE_MAX_LEN];
+        u8 level;
+        u8 generation;
+
+        /**
+         * @brief Reloads the level of this logger, after the levels have been
+         * changed at runtime.
+         */
+        void refresh_level();
 
     public:
         /**
@@ -33,7 +180,75 @@ namespace thingnet::utils
          * @param module_name The name of the module. This value will be
          * included in the emitted log messages.
          */
-        Logger(const char *module_name);
+        constexpr Logger(const char *module_name)
+            : module_name(module_name), level(LOG_DEFAULT_LEVEL), generation(0) {}
+
+        /**
+         * @brief Determines whether or not messages of the given level will be
+         * emitted by this logger.
+         * 
+         * @param level The log level of the message.
+         * @return int 1 if the message will be emitted, 0 otherwise.
+         */
+        inline int is_enabled(u8 level)
+        {
+            if (this->generation != Logger::current_generation)
+            {
+                this->refresh_level();
+            }
+            return level <= this->level;
+        }
+
+        /**
+         * @brief Gets the log level of this logger.
+         * 
+         * @return u8 The log level.
+         */
+        u8 get_level();
+
+        /**
+         * @brief Sets the log level of a module at runtime. Messages with a
+         * higher level will be discarded before they are formatted. Note that
+         * messages above the compile time LOG_LEVEL are never emitted.
+         * 
+         * @param module_name The name of the module, or "*" to set the level
+         * of all modules (clearing any module specific levels).
+         * @param level The new log level, or LOG_LEVEL_OFF.
+         * @return int 1 if the level was set, or 0 if there are too many module
+         * specific levels.
+         */
+        static int set_level(const char *module_name, u8 level);
+
+        /**
+         * @brief Gets the level that applies to modules without a module
+         * specific level.
+         * 
+         * @return u8 The log level.
+         */
+        static u8 get_default_level();
+
+        /**
+         * @brief Gets the number of modules with a module specific level.
+         * 
+         * @return u8 The number of module specific levels.
+         */
+        static u8 get_level_override_count();
+
+        /**
+         * @brief Gets a module specific level by index.
+         * 
+         * @param index The index of the module specific level.
+         * @param module_name Set to the name of the module.
+         * @param level Set to the level of the module.
+         * @return int 1 if the index is valid, 0 otherwise.
+         */
+        static int get_level_override(u8 index, const char **module_name, u8 *level);
+
+        /**
+         * @brief Incremented whenever levels are changed at runtime, so that
+         * each logger can detect that its level needs to be reloaded.
+         */
+        static u8 current_generation;
 
         /**
          * @brief Emits a log message. Prepends log level and module name to the
@@ -44,36 +259,112 @@ namespace thingnet::utils
          * @param ... 
          */
         void log(const char *level, const char *message, ...);
-    };
 
-    /**
-     * @brief Utility function that formats a binary mac address into a more
-     * human friendly format. This function exists for use with logging related
-     * macros, and should not be used directly.
-     * 
-     * @param mac_addr A byte array that represents the mac address. Only the
-     * first six bytes of this array will be used.
-     * @return char* A pointer to a formatted mac address string. Note that the
-     * data referenced by the pointer will be overwritten on subsequent calls.
-     */
-    char *__log_format_mac(u8 *mac_addr);
+        /**
+         * @brief Emits a binary log record. Arguments are copied into the
+         * record without being formatted. See LogRecord for details.
+         * 
+         * @param level The log level of the message.
+         * @param message The message value - can be a format string
+         * @param args The values to be interpolated into the message.
+         */
+        template <typename... Args>
+        void log_binary(const char *level, const char *message, Args... args)
+        {
+            LogRecord record(level, message, this->module_name);
+            (record.add(args), ...);
+            record.commit();
+        }
+
+        /**
+         * @brief Writes buffered log output to serial. Log messages are
+         * buffered so that logging never blocks the caller (the radio
+         * callbacks, in particular), and must be flushed regularly from the
+         * main loop.
+         * 
+         * @param byte_budget The maximum number of bytes to write.
+         * @param is_blocking If true, waits for serial to accept the data.
+         * Otherwise, only writes as much as the serial transmit buffer can
+         * accept without blocking.
+         * @return u16 The number of bytes written.
+         */
+        static u16 flush(u16 byte_budget, bool is_blocking = false);
+
+        /**
+         * @brief Gets the number of log messages that have been dropped since
+         * startup, because the log buffer was full.
+         * 
+         * @return u32 The number of dropped messages.
+         */
+        static u32 get_dropped_count();
+    };
 }
 
 #ifdef LOG_ENABLED
 
-#define LOG_FORMAT_MAC(mac_addr) thingnet::utils::__log_format_mac(mac_addr)
-#define LOG(level, message, ...)                           \
-    {                                                      \
-        char leader[32];                                   \
-        sprintf(leader, LOG_LEADER_FORMAT, level, "-");    \
-        Serial.print(leader);                              \
-        Serial.printf(message __VA_OPT__(, ) __VA_ARGS__); \
-        Serial.println();                                  \
+#ifdef LOG_BINARY
+#define LOG_FORMAT_MAC(mac_addr) thingnet::utils::LogMacAddress(mac_addr)
+#define LOG_EMIT(logger, level_name, message, ...) logger.log_binary(level_name, message __VA_OPT__(, ) __VA_ARGS__)
+#else
+#define LOG_FORMAT_MAC(mac_addr) thingnet::utils::LogMacAddress(mac_addr).text
+#define LOG_EMIT(logger, level_name, message, ...) logger.log(level_name, message __VA_OPT__(, ) __VA_ARGS__)
+#endif
+
+// The level is checked before any of the arguments are evaluated, so that
+// disabled log statements cost no more than a comparison.
+#define LOG_WRITE(logger, level, level_name, message, ...)                    \
+    do                                                                        \
+    {                                                                         \
+        if (logger.is_enabled(level))                                         \
+        {                                                                     \
+            LOG_EMIT(logger, level_name, message __VA_OPT__(, ) __VA_ARGS__); \
+        }                                                                     \
+    } while (0)
+
+// The level of each log macro, looked up by LOG_RATE_LIMITED.
+#define __LOG_LEVEL_OF_LOG_ERROR LOG_LEVEL_ERROR
+#define __LOG_LEVEL_OF_LOG_WARN LOG_LEVEL_WARN
+#define __LOG_LEVEL_OF_LOG_INFO LOG_LEVEL_INFO
+#define __LOG_LEVEL_OF_LOG_DEBUG LOG_LEVEL_DEBUG
+#define __LOG_LEVEL_OF_LOG_TRACE LOG_LEVEL_TRACE
+
+// Limits a log statement to one message per period (in milliseconds). The
+// number of messages suppressed in the meantime is reported with the next
+// message. Messages below the logger's level are discarded before the
+// limiter, so they are not counted as suppressed. For example:
+// LOG_RATE_LIMITED(LOG_WARN, logger, 1000, "Something happened");
+#define LOG_RATE_LIMITED(log_macro, logger, period, message, ...)                              \
+    do                                                                                         \
+    {                                                                                          \
+        static thingnet::utils::LogRateLimiter __log_rate_limiter;                             \
+        u32 __log_suppressed_count;                                                            \
+        if (LOG_DEFAULT_LEVEL >= __LOG_LEVEL_OF_##log_macro &&                                 \
+            logger.is_enabled(__LOG_LEVEL_OF_##log_macro) &&                                   \
+            __log_rate_limiter.allow(period, &__log_suppressed_count))                         \
+        {                                                                                      \
+            log_macro(logger, message __VA_OPT__(, ) __VA_ARGS__);                             \
+            if (__log_suppressed_count > 0)                                                    \
+            {                                                                                  \
+                log_macro(logger, "Suppressed [%d] similar messages", __log_suppressed_count); \
+            }                                                                                  \
+        }                                                                                      \
+    } while (0)
+
+#define LOG(level, message, ...)                               \
+    {                                                          \
+        thingnet::utils::Logger::flush(LOG_BUFFER_SIZE, true); \
+        char leader[32];                                       \
+        sprintf(leader, LOG_LEADER_FORMAT, level, "-");        \
+        Serial.print(leader);                                  \
+        Serial.printf(message __VA_OPT__(, ) __VA_ARGS__);     \
+        Serial.println();                                      \
     }
 
 #else
 
 #define LOG_FORMAT_MAC(mac_addr)
+#define LOG_WRITE(...)
+#define LOG_RATE_LIMITED(log_macro, logger, period, message, ...)
 #define LOG(level, message, ...)
 
 #endif
@@ -85,31 +376,31 @@ namespace thingnet::utils
 #endif
 
 #if LOG_LEVEL >= LOG_LEVEL_ERROR
-#define LOG_ERROR(logger, message, ...) logger->log("ERR", message __VA_OPT__(, ) __VA_ARGS__)
+#define LOG_ERROR(logger, message, ...) LOG_WRITE(logger, LOG_LEVEL_ERROR, "ERR", message __VA_OPT__(, ) __VA_ARGS__)
 #else
 #define LOG_ERROR(...)
 #endif
 
 #if LOG_LEVEL >= LOG_LEVEL_WARN
-#define LOG_WARN(logger, message, ...) logger->log("WRN", message __VA_OPT__(, ) __VA_ARGS__)
+#define LOG_WARN(logger, message, ...) LOG_WRITE(logger, LOG_LEVEL_WARN, "WRN", message __VA_OPT__(, ) __VA_ARGS__)
 #else
 #define LOG_WARN(...)
 #endif
 
 #if LOG_LEVEL >= LOG_LEVEL_INFO
-#define LOG_INFO(logger, message, ...) logger->log("INF", message __VA_OPT__(, ) __VA_ARGS__)
+#define LOG_INFO(logger, message, ...) LOG_WRITE(logger, LOG_LEVEL_INFO, "INF", message __VA_OPT__(, ) __VA_ARGS__)
 #else
 #define LOG_INFO(...)
 #endif
 
 #if LOG_LEVEL >= LOG_LEVEL_DEBUG
-#define LOG_DEBUG(logger, message, ...) logger->log("DBG", message __VA_OPT__(, ) __VA_ARGS__)
+#define LOG_DEBUG(logger, message, ...) LOG_WRITE(logger, LOG_LEVEL_DEBUG, "DBG", message __VA_OPT__(, ) __VA_ARGS__)
 #else
 #define LOG_DEBUG(...)
 #endif
 
 #if LOG_LEVEL >= LOG_LEVEL_TRACE
-#define LOG_TRACE(logger, message, ...) logger->log("TRC", message __VA_OPT__(, ) __VA_ARGS__)
+#define LOG_TRACE(logger, message, ...) LOG_WRITE(logger, LOG_LEVEL_TRACE, "TRC", message __VA_OPT__(, ) __VA_ARGS__)
 #else
 #define LOG_TRACE(...)
 #endif
@@ -0,0 +1,111 @@
+#include <Arduino.h>
+#include "log.h"
+#include "log_console.h"
+
+using namespace thingnet::utils;
+
+static constinit Logger logger("log-console");
+
+namespace thingnet::utils
+{
+    static const char *__LEVEL_NAMES[] = {"off", "fatal", "error", "warn", "info", "debug", "trace"};
+    static const u8 __LEVEL_COUNT = 7;
+
+    void LogConsole::update()
+    {
+        while (Serial.available() > 0)
+        {
+            char value = Serial.read();
+            if (value == '\r')
+            {
+                continue;
+            }
+
+            if (value == '\n')
+            {
+                this->line[this->line_length] = 0;
+                if (this->is_overflowed)
+                {
+                    LOG_WARN(logger, "Command is too long. Ignoring.");
+                }
+                else
+                {
+                    this->execute();
+                }
+                this->line_length = 0;
+                this->is_overflowed = false;
+                continue;
+            }
+
+            if (this->line_length >= __MAX_CONSOLE_LINE_LENGTH - 1)
+            {
+                this->is_overflowed = true;
+                continue;
+            }
+
+            this->line[this->line_length] = value;
+            this->line_length++;
+        }
+    }
+
+    int LogConsole::parse_level(const char *value, u8 *level)
+    {
+        for (u8 index = 0; index < __LEVEL_COUNT; index++)
+        {
+            if (strcmp(value, __LEVEL_NAMES[index]) == 0)
+            {
+                *level = index;
+                return 1;
+            }
+        }
+
+        if (value[0] >= '0' && value[0] < '0' + __LEVEL_COUNT && value[1] == 0)
+        {
+            *level = value[0] - '0';
+            return 1;
+        }
+
+        return 0;
+    }
+
+    void LogConsole::execute()
+    {
+        char *save_ptr;
+        char *command = strtok_r(this->line, " ", &save_ptr);
+        if (command == 0 || strcmp(command, "log") != 0)
+        {
+            LOG_WARN(logger, "Unknown command. Usage: log [<module|*> <level>]");
+            return;
+        }
+
+        char *module_name = strtok_r(0, " ", &save_ptr);
+        char *level_name = strtok_r(0, " ", &save_ptr);
+        if (module_name == 0)
+        {
+            LOG_INFO(logger, "[*] [%s]", __LEVEL_NAMES[Logger::get_default_level() % __LEVEL_COUNT]);
+            for (u8 index = 0; index < Logger::get_level_override_count(); index++)
+            {
+                const char *override_name;
+                u8 override_level;
+                Logger::get_level_override(index, &override_name, &override_level);
+                LOG_INFO(logger, "[%s] [%s]", override_name, __LEVEL_NAMES[override_level % __LEVEL_COUNT]);
+            }
+            return;
+        }
+
+        u8 level;
+        if (level_name == 0 || !this->parse_level(level_name, &level))
+        {
+            LOG_WARN(logger, "Invalid log level. Expected one of off, fatal, error, warn, info, debug, trace");
+            return;
+        }
+
+        if (!Logger::set_level(module_name, level))
+        {
+            LOG_WARN(logger, "Too many module log levels. Use [log * <level>] to reset.");
+            return;
+        }
+
+        LOG_INFO(logger, "Log level of [%s] set to [%s]", module_name, __LEVEL_NAMES[level]);
+    }
+}
\ No newline at end of file
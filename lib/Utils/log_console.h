@@ -0,0 +1,57 @@
+#ifndef __LOG_CONSOLE_H
+#define __LOG_CONSOLE_H
+
+#include <Arduino.h>
+
+namespace thingnet::utils
+{
+    const u8 __MAX_CONSOLE_LINE_LENGTH = 64;
+
+    /**
+     * @brief Accepts commands over serial that change log levels at runtime,
+     * so that a single module can be debugged without reflashing. Commands
+     * are terminated by a new line:
+     * - `log` lists the default level, and any module specific levels.
+     * - `log <module> <level>` sets the level of a module's logger.
+     * - `log * <level>` sets the level of all modules.
+     * 
+     * Levels can be specified by name (off, fatal, error, warn, info, debug,
+     * trace) or by number (0 - 6).
+     */
+    class LogConsole
+    {
+    private:
+        char line[__MAX_CONSOLE_LINE_LENGTH];
+        u8 line_length;
+        bool is_overflowed;
+
+        /**
+         * @brief Executes the command in the line buffer.
+         */
+        void execute();
+
+        /**
+         * @brief Parses a log level.
+         * 
+         * @param value The level name or number.
+         * @param level Set to the parsed level.
+         * @return int 1 if the level was parsed, 0 otherwise.
+         */
+        int parse_level(const char *value, u8 *level);
+
+    public:
+        /**
+         * @brief Construct a new log console object
+         */
+        constexpr LogConsole() : line{}, line_length(0), is_overflowed(false) {}
+
+        /**
+         * @brief Reads any pending serial input, and executes complete
+         * commands. This method does not block, and should be called from the
+         * main loop.
+         */
+        void update();
+    };
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,194 @@
+#include <Arduino.h>
+
+#include "clock.h"
+#include "pulse_engine.h"
+
+#if !defined(ESP32) && !defined(PULSER_SOFTWARE_TIMER)
+#define __PULSER_HARDWARE_TIMER
+#endif
+
+namespace thingnet::utils
+{
+#ifdef __PULSER_HARDWARE_TIMER
+    // timer1 runs at 80 MHz / 16, so 5000 timer ticks is one millisecond.
+    static const u32 __TIMER_TICKS_PER_TICK = 5000;
+#endif
+
+    // Used by the interrupt handler, which must not touch the function local
+    // static in get_instance().
+    static PulseEngine *__pulse_engine = 0;
+
+    PulseEngine::PulseEngine()
+    {
+        this->tick_time = 0;
+        this->is_started = false;
+        for (u8 index = 0; index < __MAX_PULSE_CHANNELS; index++)
+        {
+            this->channels[index].is_used = false;
+            this->channels[index].step_count = 0;
+        }
+    }
+
+    PulseEngine &PulseEngine::get_instance()
+    {
+        static PulseEngine instance;
+        return instance;
+    }
+
+    void PulseEngine::start()
+    {
+        if (this->is_started)
+        {
+            return;
+        }
+
+        __pulse_engine = this;
+        this->tick_time = Clock::now_millis();
+        this->is_started = true;
+#ifdef __PULSER_HARDWARE_TIMER
+        timer1_attachInterrupt(PulseEngine::on_tick);
+        timer1_enable(TIM_DIV16, TIM_EDGE, TIM_LOOP);
+        timer1_write(__TIMER_TICKS_PER_TICK);
+#endif
+    }
+
+    void IRAM_ATTR PulseEngine::advance(PulseChannel *channel, u32 ticks)
+    {
+        if (channel->step_count == 0)
+        {
+            return;
+        }
+
+        if (ticks < channel->remaining)
+        {
+            channel->remaining -= ticks;
+            return;
+        }
+
+        ticks -= channel->remaining;
+        if (ticks >= channel->period)
+        {
+            ticks %= channel->period;
+        }
+        do
+        {
+            channel->step_index++;
+            if (channel->step_index == channel->step_count)
+            {
+                channel->step_index = 0;
+            }
+            channel->remaining = channel->steps[channel->step_index];
+
+            // Steps of zero are passed over without touching the output.
+            if (ticks < channel->remaining)
+            {
+                break;
+            }
+            ticks -= channel->remaining;
+        } while (true);
+
+        channel->remaining -= ticks;
+        digitalWrite(channel->pin, (channel->step_index & 1) == 0 ? HIGH : LOW);
+    }
+
+    void IRAM_ATTR PulseEngine::on_tick()
+    {
+        for (u8 index = 0; index < __MAX_PULSE_CHANNELS; index++)
+        {
+            PulseEngine::advance(&__pulse_engine->channels[index], 1);
+        }
+    }
+
+    int PulseEngine::allocate(uint8_t pin, u8 *channel)
+    {
+        for (u8 index = 0; index < __MAX_PULSE_CHANNELS; index++)
+        {
+            if (this->channels[index].is_used)
+            {
+                continue;
+            }
+
+            pinMode(pin, OUTPUT);
+            digitalWrite(pin, LOW);
+            this->channels[index].pin = pin;
+            this->channels[index].step_count = 0;
+            this->channels[index].is_used = true;
+            *channel = index;
+            this->start();
+            return 0;
+        }
+
+        *channel = __NO_PULSE_CHANNEL;
+        return 1;
+    }
+
+    void PulseEngine::release(u8 channel)
+    {
+        if (channel >= __MAX_PULSE_CHANNELS || !this->channels[channel].is_used)
+        {
+            return;
+        }
+
+        noInterrupts();
+        this->channels[channel].step_count = 0;
+        this->channels[channel].is_used = false;
+        interrupts();
+        digitalWrite(this->channels[channel].pin, LOW);
+    }
+
+    int PulseEngine::set_pattern(u8 channel, const u16 *steps, u8 step_count)
+    {
+        if (channel >= __MAX_PULSE_CHANNELS || !this->channels[channel].is_used ||
+            step_count == 0 || step_count > __MAX_PULSE_STEPS)
+        {
+            return 1;
+        }
+
+        u32 total = 0;
+        for (u8 index = 0; index < step_count; index++)
+        {
+            total += steps[index];
+        }
+        if (total == 0)
+        {
+            return 1;
+        }
+
+        PulseChannel *target = &this->channels[channel];
+        noInterrupts();
+        memcpy(target->steps, steps, step_count * sizeof(u16));
+        target->step_count = step_count;
+        target->period = total;
+        // Start on the last step with nothing remaining, so that advancing
+        // moves to the first non empty step and writes the output.
+        target->step_index = step_count - 1;
+        target->remaining = 0;
+        PulseEngine::advance(target, 0);
+        interrupts();
+
+        return 0;
+    }
+
+    void PulseEngine::update()
+    {
+#ifndef __PULSER_HARDWARE_TIMER
+        if (!this->is_started)
+        {
+            return;
+        }
+
+        u64 now = Clock::now_millis();
+        u32 ticks = (u32)(now - this->tick_time);
+        if (ticks == 0)
+        {
+            return;
+        }
+        this->tick_time = now;
+
+        for (u8 index = 0; index < __MAX_PULSE_CHANNELS; index++)
+        {
+            PulseEngine::advance(&this->channels[index], ticks);
+        }
+#endif
+    }
+}
\ No newline at end of file
@@ -0,0 +1,115 @@
+#ifndef __PULSE_ENGINE_H
+#define __PULSE_ENGINE_H
+
+#include <Arduino.h>
+
+namespace thingnet::utils
+{
+    const u8 __MAX_PULSE_CHANNELS = 4;
+    const u8 __MAX_PULSE_STEPS = 16;
+    const u8 __NO_PULSE_CHANNEL = 0xFF;
+
+    /**
+     * @brief An output driven by the pulse engine. The pattern is a sequence
+     * of step durations in ticks, alternating between high and low, starting
+     * high, and repeats once complete. The period is the total length of the
+     * pattern.
+     */
+    typedef struct PulseChannel
+    {
+        u8 pin;
+        u8 step_count;
+        u8 step_index;
+        u16 remaining;
+        u32 period;
+        u16 steps[__MAX_PULSE_STEPS];
+        bool is_used;
+    } PulseChannel;
+
+    /**
+     * @brief Drives the outputs of several pulse channels from a single tick,
+     * with a tick period of one millisecond. The tick comes from a hardware
+     * timer interrupt on the ESP8266, so outputs do not depend on the main
+     * loop at all. Where the hardware timer is not available (on the ESP32,
+     * or when built with PULSER_SOFTWARE_TIMER, for example if timer1 is
+     * needed elsewhere), the channels are advanced from update() instead, by
+     * however many ticks have elapsed.
+     */
+    class PulseEngine
+    {
+    private:
+        PulseChannel channels[__MAX_PULSE_CHANNELS];
+        u64 tick_time;
+        bool is_started;
+
+        PulseEngine();
+
+        /**
+         * @brief Starts the tick, if it has not already been started.
+         */
+        void start();
+
+        /**
+         * @brief Advances a channel by a number of ticks, writing the output
+         * if the channel moves to a new step. Whole periods are skipped, so a
+         * long gap between updates takes no longer than a short one.
+         * 
+         * @param channel The channel to advance.
+         * @param ticks The number of ticks.
+         */
+        static void advance(PulseChannel *channel, u32 ticks);
+
+        /**
+         * @brief The hardware timer interrupt handler.
+         */
+        static void on_tick();
+
+    public:
+        /**
+         * @brief Get the instance object
+         *
+         * @return PulseEngine&
+         */
+        static PulseEngine &get_instance();
+
+        /**
+         * @brief Allocates a channel for a pin, configuring the pin as an
+         * output. The channel is idle (low) until a pattern is set.
+         * 
+         * @param pin The GPIO pin that the channel drives.
+         * @param channel The allocated channel.
+         * @return int 0 if the channel was allocated, or 1 if all channels are
+         * in use.
+         */
+        int allocate(uint8_t pin, u8 *channel);
+
+        /**
+         * @brief Stops a channel, setting its output low, and makes it
+         * available for reuse.
+         * 
+         * @param channel The channel to release.
+         */
+        void release(u8 channel);
+
+        /**
+         * @brief Replaces the pattern of a channel, restarting it from the
+         * first step.
+         * 
+         * @param channel The channel.
+         * @param steps The step durations in ticks, alternating between high
+         * and low, starting high. Steps may be zero, but not all of them.
+         * @param step_count The number of steps.
+         * @return int 0 if the pattern was set, or 1 if the pattern is invalid.
+         */
+        int set_pattern(u8 channel, const u16 *steps, u8 step_count);
+
+        /**
+         * @brief Advances the channels when the hardware timer is not in use.
+         * This is a non blocking call that will typically be made from within
+         * the main loop, and does nothing when the hardware timer is in use.
+         */
+        void update();
+    };
+}
+
+#endif
\ No newline at end of file
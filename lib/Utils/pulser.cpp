@@ -1,17 +1,28 @@
 #include <Arduino.h>
 
+#include "pulse_engine.h"
 #include "pulser.h"
 
 namespace thingnet::utils {
 
+    static const u16 __BLINK_DURATION = 200;
+    static const u16 __BLINK_CODE_PAUSE = 1000;
+
     Pulser::Pulser(uint8_t pin, u64 duration)
     {
         this->is_initialized = false;
         this->pin = pin;
+        this->channel = __NO_PULSE_CHANNEL;
         this->duration = duration;
         this->duty_cycle = 50;
-        this->transition_time = 0;
-        this->is_high = false;
+    }
+
+    Pulser::~Pulser()
+    {
+        if (this->is_initialized)
+        {
+            PulseEngine::get_instance().release(this->channel);
+        }
     }
 
     int Pulser::init()
@@ -20,9 +31,29 @@ namespace thingnet::utils {
         {
             return 1;
         }
-        pinMode(pin, OUTPUT);
+        if (PulseEngine::get_instance().allocate(this->pin, &this->channel) != 0)
+        {
+            return 1;
+        }
         this->is_initialized = true;
-        return 0;
+        return this->apply();
+    }
+
+    int Pulser::apply()
+    {
+        if (!this->is_initialized)
+        {
+            // Applied once the pulser is initialized.
+            return 0;
+        }
+
+        // Precompute the high and low times as whole ticks, so the engine
+        // only ever counts down.
+        u64 duration = this->duration > 0xFFFF ? 0xFFFF : this->duration;
+        u16 steps[2];
+        steps[0] = (u16)(duration * this->duty_cycle / 100);
+        steps[1] = (u16)duration - steps[0];
+        return PulseEngine::get_instance().set_pattern(this->channel, steps, 2);
     }
 
     int Pulser::set_duty_cycle(u8 duty_cycle)
@@ -32,37 +63,48 @@ namespace thingnet::utils {
             return 1;
         }
         this->duty_cycle = duty_cycle;
-        return 0;
+        return this->apply();
     }
 
     int Pulser::set_duration(u64 duration)
     {
         this->duration = duration;
-        return 0;
+        return this->apply();
     }
 
-    int Pulser::update()
+    int Pulser::set_sequence(const u16 *steps, u8 step_count)
     {
         if (!this->is_initialized)
         {
             return 1;
         }
+        return PulseEngine::get_instance().set_pattern(this->channel, steps, step_count);
+    }
 
-        u64 delta = millis() - this->transition_time;
+    int Pulser::set_blink_code(u8 count)
+    {
+        if (count == 0 || count > __MAX_BLINK_CODE)
+        {
+            return 1;
+        }
 
-        // Calculate what fraction of the duration the current transition time
-        // should last for.
-        double limit_fraction = this->is_high ? this->duty_cycle : 100 - this->duty_cycle;
-        limit_fraction = limit_fraction / 100;
-        u64 transition_limit = (u64)floor(this->duration * limit_fraction);
+        u16 steps[__MAX_BLINK_CODE * 2];
+        for (u8 index = 0; index < count * 2; index++)
+        {
+            steps[index] = __BLINK_DURATION;
+        }
+        steps[count * 2 - 1] = __BLINK_CODE_PAUSE;
+        return this->set_sequence(steps, count * 2);
+    }
 
-        if (delta > transition_limit)
+    int Pulser::update()
+    {
+        if (!this->is_initialized)
         {
-            this->is_high = !this->is_high;
-            this->transition_time = millis();
+            return 1;
         }
-        digitalWrite(this->pin, this->is_high ? HIGH : LOW);
 
+        PulseEngine::get_instance().update();
         return 0;
     }
 }
\ No newline at end of file
@@ -2,23 +2,35 @@
 #define __PULSER_H
 
 #include <Arduino.h>
+#include "pulse_engine.h"
 
 namespace thingnet::utils
 {
+    const u8 __MAX_BLINK_CODE = 7;
+
     /**
      * @brief A class that can be used to generate a periodic pulse without blocking
-     * the event loop.
+     * the event loop. The pulse is generated by a channel of the pulse engine,
+     * so the output does not depend on how often the main loop runs.
      */
     class Pulser
     {
     private:
         uint8_t pin;
+        u8 channel;
         u64 duration;
-        u64 transition_time;
         u8 duty_cycle;
-        bool is_high;
         bool is_initialized;
 
+        /**
+         * @brief Sets the pattern of the channel from the duration and duty
+         * cycle.
+         * 
+         * @return int A non success value will be returned if the pattern could
+         * not be set.
+         */
+        int apply();
+
     public:
         /**
          * @brief Construct a new Pulser object
@@ -29,6 +41,11 @@ namespace thingnet::utils
          */
         Pulser(uint8_t pin, u64 duration);
 
+        /**
+         * @brief Destroy the Pulser object, releasing its channel.
+         */
+        ~Pulser();
+
         /**
          * @brief Initializes the pulser object
          * 
@@ -56,9 +73,34 @@ namespace thingnet::utils
         int set_duration(u64 duration);
 
         /**
-         * @brief Allows the pulser to update its state. This is a non blocking call
-         * that will transition the state of the pulse (high -> low or low -> high)
-         * based on the current time and the duty cycle of the pulser.
+         * @brief Replaces the periodic pulse with a repeating sequence of
+         * steps. Setting the duration or duty cycle restores the periodic
+         * pulse.
+         * 
+         * @param steps The step durations in milliseconds, alternating between
+         * high and low, starting high.
+         * @param step_count The number of steps, up to __MAX_PULSE_STEPS.
+         * @return int A non success value will be returned if the pulser has
+         * not been initialized, or the sequence is invalid.
+         */
+        int set_sequence(const u16 *steps, u8 step_count);
+
+        /**
+         * @brief Replaces the periodic pulse with a blink code: a number of
+         * short blinks followed by a pause, repeated. Used to show states such
+         * as the node role, the peer count or an error on a status LED.
+         * 
+         * @param count The number of blinks, from 1 to __MAX_BLINK_CODE.
+         * @return int A non success value will be returned if the pulser has
+         * not been initialized, or the count is out of range.
+         */
+        int set_blink_code(u8 count);
+
+        /**
+         * @brief Allows the pulser to update its state. The output is driven by
+         * the hardware timer where it is available, in which case this call
+         * does nothing. Otherwise the pulse engine is advanced to the current
+         * time.
          * 
          * @return int A non success value will be returned if the add operation
          * resulted in an error. See error codes for more information.
@@ -0,0 +1,124 @@
+#ifndef __RING_BUFFER_H
+#define __RING_BUFFER_H
+
+#include <Arduino.h>
+
+#include "bounds_check.h"
+
+namespace thingnet::utils
+{
+    /**
+     * @brief A first in, first out queue with a fixed capacity, stored inline
+     * without using the heap. The read and write positions run freely and are
+     * masked on access, so the capacity must be a power of two.
+     * 
+     * @tparam T The element type. Must be default constructible and copyable.
+     * @tparam N The capacity. Must be a power of two, up to 32768.
+     */
+    template <typename T, u16 N>
+    class RingBuffer
+    {
+        static_assert(N > 0 && (N & (N - 1)) == 0, "Ring buffer capacity must be a power of two");
+        static_assert(N <= 32768, "Ring buffer capacity is too large");
+
+    private:
+        T items[N];
+        u16 head;
+        u16 tail;
+
+    public:
+        constexpr RingBuffer() : head(0), tail(0) {}
+
+        static constexpr u16 capacity() { return N; }
+        u16 size() const { return (u16)(this->head - this->tail); }
+        bool is_empty() const { return this->head == this->tail; }
+        bool is_full() const { return this->size() == N; }
+
+        /**
+         * @brief Gets an element, counting from the oldest.
+         * 
+         * @param index The position of the element, from 0 (the oldest).
+         * @return T& The element.
+         */
+        T &operator[](u16 index)
+        {
+            BOUNDS_CHECK(index < this->size());
+            return this->items[(u16)(this->tail + index) & (N - 1)];
+        }
+
+        /**
+         * @brief Adds an element to the back of the queue.
+         * 
+         * @param item The element to add.
+         * @return int 0 if the element was added, or 1 if the queue is full.
+         */
+        int push(const T &item)
+        {
+            if (this->is_full())
+            {
+                return 1;
+            }
+            this->items[this->head & (N - 1)] = item;
+            this->head++;
+            return 0;
+        }
+
+        /**
+         * @brief Adds an element to the back of the queue, discarding the
+         * oldest element if the queue is full.
+         * 
+         * @param item The element to add.
+         * @return int 0 if the element was added, or 1 if an element was
+         * discarded to make room for it.
+         */
+        int push_overwrite(const T &item)
+        {
+            int result = 0;
+            if (this->is_full())
+            {
+                this->tail++;
+                result = 1;
+            }
+            this->items[this->head & (N - 1)] = item;
+            this->head++;
+            return result;
+        }
+
+        /**
+         * @brief Removes the element at the front of the queue.
+         * 
+         * @param item Where the element will be copied, or a null value if
+         * it is not required.
+         * @return int 0 if an element was removed, or 1 if the queue is empty.
+         */
+        int pop(T *item)
+        {
+            if (this->is_empty())
+            {
+                return 1;
+            }
+            if (item != 0)
+            {
+                *item = this->items[this->tail & (N - 1)];
+            }
+            this->tail++;
+            return 0;
+        }
+
+        /**
+         * @brief Gets the element at the front of the queue, without removing
+         * it.
+         * 
+         * @return T& The oldest element.
+         */
+        T &peek()
+        {
+            BOUNDS_CHECK(!this->is_empty());
+            return this->items[this->tail & (N - 1)];
+        }
+
+        void clear() { this->tail = this->head; }
+    };
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,263 @@
+#ifndef __STATIC_VECTOR_H
+#define __STATIC_VECTOR_H
+
+#include <Arduino.h>
+#include <type_traits>
+
+#include "bounds_check.h"
+
+namespace thingnet::utils
+{
+    /**
+     * @brief A vector with a fixed capacity, stored inline without using the
+     * heap. Elements are kept contiguous, so the vector can be iterated as an
+     * array. Operations that would exceed the capacity fail rather than
+     * growing the vector.
+     * 
+     * @tparam T The element type. Must be default constructible and copyable.
+     * @tparam N The capacity.
+     */
+    template <typename T, u16 N>
+    class StaticVector
+    {
+    private:
+        T items[N];
+        u16 count;
+
+        /**
+         * @brief Moves a range of elements within the vector.
+         */
+        void move(u16 to, u16 from, u16 length)
+        {
+            if constexpr (std::is_trivially_copyable_v<T>)
+            {
+                memmove(&this->items[to], &this->items[from], length * sizeof(T));
+            }
+            else if (to < from)
+            {
+                for (u16 index = 0; index < length; index++)
+                {
+                    this->items[to + index] = this->items[from + index];
+                }
+            }
+            else
+            {
+                for (u16 index = length; index > 0; index--)
+                {
+                    this->items[to + index - 1] = this->items[from + index - 1];
+                }
+            }
+        }
+
+        /**
+         * @brief Releases the elements in a range that is no longer in use.
+         * Elements that hold no resources are simply left in place.
+         */
+        void reset(u16 from, u16 to)
+        {
+            if constexpr (!std::is_trivially_destructible_v<T>)
+            {
+                for (u16 index = from; index < to; index++)
+                {
+                    this->items[index] = T();
+                }
+            }
+        }
+
+    public:
+        constexpr StaticVector() : count(0) {}
+
+        static constexpr u16 capacity() { return N; }
+        u16 size() const { return this->count; }
+        bool is_empty() const { return this->count == 0; }
+        bool is_full() const { return this->count == N; }
+
+        T &operator[](u16 index)
+        {
+            BOUNDS_CHECK(index < this->count);
+            return this->items[index];
+        }
+
+        const T &operator[](u16 index) const
+        {
+            BOUNDS_CHECK(index < this->count);
+            return this->items[index];
+        }
+
+        T *begin() { return this->items; }
+        T *end() { return this->items + this->count; }
+        const T *begin() const { return this->items; }
+        const T *end() const { return this->items + this->count; }
+
+        T &back()
+        {
+            BOUNDS_CHECK(this->count > 0);
+            return this->items[this->count - 1];
+        }
+
+        /**
+         * @brief Adds an element to the end of the vector.
+         * 
+         * @param item The element to add.
+         * @return int 0 if the element was added, or 1 if the vector is full.
+         */
+        int push_back(const T &item)
+        {
+            if (this->count >= N)
+            {
+                return 1;
+            }
+            this->items[this->count] = item;
+            this->count++;
+            return 0;
+        }
+
+        /**
+         * @brief Inserts an element, shifting the elements after it.
+         * 
+         * @param index The position of the new element, up to the size of the
+         * vector.
+         * @param item The element to insert.
+         * @return int 0 if the element was inserted, or 1 if the vector is full.
+         */
+        int insert(u16 index, const T &item)
+        {
+            BOUNDS_CHECK(index <= this->count);
+            if (this->count >= N)
+            {
+                return 1;
+            }
+            this->move(index + 1, index, this->count - index);
+            this->items[index] = item;
+            this->count++;
+            return 0;
+        }
+
+        /**
+         * @brief Removes the last element of the vector.
+         * 
+         * @return int 0 if an element was removed, or 1 if the vector is
+         * empty.
+         */
+        int pop_back()
+        {
+            if (this->count == 0)
+            {
+                return 1;
+            }
+            this->count--;
+            this->reset(this->count, this->count + 1);
+            return 0;
+        }
+
+        /**
+         * @brief Removes an element, keeping the order of the remaining
+         * elements.
+         * 
+         * @param index The position of the element.
+         */
+        void erase(u16 index)
+        {
+            BOUNDS_CHECK(index < this->count);
+            this->move(index, index + 1, this->count - index - 1);
+            this->count--;
+            this->reset(this->count, this->count + 1);
+        }
+
+        /**
+         * @brief Removes an element in constant time, by moving the last
+         * element into its place. The order of the elements is not kept.
+         * 
+         * @param index The position of the element.
+         */
+        void swap_erase(u16 index)
+        {
+            BOUNDS_CHECK(index < this->count);
+            this->count--;
+            this->items[index] = this->items[this->count];
+            this->reset(this->count, this->count + 1);
+        }
+
+        /**
+         * @brief Removes all elements that match a predicate in a single pass,
+         * keeping the order of the remaining elements.
+         * 
+         * @param predicate A function that returns true for the elements to
+         * remove. It is called once for each element, in order.
+         * @return u16 The number of elements removed.
+         */
+        template <typename P>
+        u16 remove_if(P predicate)
+        {
+            u16 kept_count = 0;
+            for (u16 index = 0; index < this->count; index++)
+            {
+                if (predicate(this->items[index]))
+                {
+                    continue;
+                }
+                if (kept_count != index)
+                {
+                    this->items[kept_count] = this->items[index];
+                }
+                kept_count++;
+            }
+
+            u16 removed_count = this->count - kept_count;
+            this->reset(kept_count, this->count);
+            this->count = kept_count;
+            return removed_count;
+        }
+
+        /**
+         * @brief Removes all elements equal to the given value.
+         * 
+         * @param item The value to remove.
+         * @return u16 The number of elements removed.
+         */
+        u16 remove(const T &item)
+        {
+            return this->remove_if([&item](const T &current) { return current == item; });
+        }
+
+        /**
+         * @brief Finds the first element equal to the given value.
+         * 
+         * @param item The value to find.
+         * @return int The position of the element, or -1 if it was not found.
+         */
+        int index_of(const T &item) const
+        {
+            for (u16 index = 0; index < this->count; index++)
+            {
+                if (this->items[index] == item)
+                {
+                    return index;
+                }
+            }
+            return -1;
+        }
+
+        bool contains(const T &item) const { return this->index_of(item) >= 0; }
+
+        /**
+         * @brief Removes the elements beyond the given size.
+         * 
+         * @param size The new size. Must not be larger than the current size.
+         */
+        void truncate(u16 size)
+        {
+            BOUNDS_CHECK(size <= this->count);
+            this->reset(size, this->count);
+            this->count = size;
+        }
+
+        void clear()
+        {
+            this->reset(0, this->count);
+            this->count = 0;
+        }
+    };
+}
+
+#endif
\ No newline at end of file
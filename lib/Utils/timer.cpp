@@ -1,27 +1,65 @@
 #include <Arduino.h>
+#include "log.h"
+#include "clock.h"
 #include "timer.h"
+#include "timer_service.h"
+
+using namespace thingnet::utils;
+
+static constinit Logger logger("timer");
 
 namespace thingnet::utils
 {
-    Timer::Timer(u64 duration, bool auto_restart)
+    Timer::~Timer()
     {
-        this->duration = duration;
-        this->auto_restart = auto_restart;
-        this->last_time = millis();
-        this->is_started = false;
+        TimerService::get_instance().unschedule(this);
     }
 
-    Timer::Timer(u64 duration) : Timer(duration, false){};
+    int Timer::set_callback(timer_callback_t callback, void *context)
+    {
+        this->callback = callback;
+        this->context = context;
+        return 0;
+    }
 
-    bool Timer::is_complete()
+    void Timer::expire(u64 now)
     {
-        if (this->is_started && (millis() - this->last_time > this->duration))
+        TimerService &service = TimerService::get_instance();
+        if (this->auto_restart)
+        {
+            this->deadline = now + this->duration * 1000;
+            service.schedule(this);
+        }
+        else
         {
             this->is_started = false;
-            if (this->auto_restart)
+            service.unschedule(this);
+        }
+
+        if (this->callback != 0)
+        {
+            this->callback(this->context);
+        }
+        else
+        {
+            this->is_expired = true;
+        }
+    }
+
+    bool Timer::is_complete()
+    {
+        if (!this->is_expired && this->is_started)
+        {
+            u64 now = Clock::now_micros();
+            if (now > this->deadline)
             {
-                this->start();
+                this->expire(now);
             }
+        }
+
+        if (this->is_expired)
+        {
+            this->is_expired = false;
             return true;
         }
         return false;
@@ -38,8 +76,18 @@ namespace thingnet::utils
         {
             return 1;
         }
-        this->last_time = millis();
+        this->deadline = Clock::now_micros() + this->duration * 1000;
         this->is_started = true;
+        this->is_expired = false;
+        if (TimerService::get_instance().schedule(this) != 0 && this->callback != 0)
+        {
+            // Only the timer service invokes callbacks, so the timer would
+            // never fire.
+            this->is_started = false;
+            LOG_ERROR(logger, "Unable to start timer, [%d] timers are already running",
+                      __MAX_SCHEDULED_TIMERS);
+            return 1;
+        }
 
         return 0;
     }
@@ -51,6 +99,8 @@ namespace thingnet::utils
             return 1;
         }
         this->is_started = false;
+        this->is_expired = false;
+        TimerService::get_instance().unschedule(this);
 
         return 0;
     }
@@ -62,4 +112,20 @@ namespace thingnet::utils
 
         return 0;
     }
+
+    int Timer::set_duration(u64 duration)
+    {
+        if (this->is_started)
+        {
+            this->deadline = this->deadline - this->duration * 1000 + duration * 1000;
+            TimerService::get_instance().schedule(this);
+        }
+        this->duration = duration;
+        return 0;
+    }
+
+    u64 Timer::get_deadline()
+    {
+        return this->deadline;
+    }
 }
\ No newline at end of file
@@ -5,18 +5,53 @@
 
 namespace thingnet::utils
 {
+    class TimerService;
+
+    const u8 __TIMER_NOT_SCHEDULED = 0xFF;
+
+    /**
+     * @brief A function that is invoked when a timer expires.
+     */
+    typedef void (*timer_callback_t)(void *context);
+
     /**
      * @brief Simple timer implementation that determines if a certain amount of
-     * time has elapsed since it was checked previously. The checks only take place
-     * when the is_complete() method is called.
+     * time has elapsed since it was started. Durations are specified in
+     * milliseconds, and deadlines are tracked in microseconds on the Clock
+     * timebase, so timers are unaffected by the wraparound of millis().
+     * 
+     * Running timers are tracked by the timer service, which expires them as
+     * their deadlines pass, and allows the main loop to idle until the next
+     * deadline. A timer can either be polled using is_complete(), or be given
+     * a callback that is invoked by the timer service. Polled timers also
+     * check their deadline when is_complete() is called, so that they work
+     * even if the timer service is not being updated.
+     * 
+     * The deadline is only set when the timer is started, so timers can be
+     * constant initialized.
      */
     class Timer
     {
     private:
         u64 duration;
-        u64 last_time;
+        u64 deadline;
         bool is_started;
         bool auto_restart;
+        bool is_expired;
+        timer_callback_t callback;
+        void *context;
+        u8 schedule_index;
+
+        /**
+         * @brief Expires the timer, restarting it if required, and either
+         * invoking the callback or flagging the timer as complete.
+         * 
+         * @param now The current time, in microseconds.
+         */
+        void expire(u64 now);
+
+        friend class TimerService;
+
     public:
 
         /**
@@ -27,7 +62,11 @@ namespace thingnet::utils
          * it has been completed. Note that the restart will occur when
          * `is_complete()` is invoked and not when the timer expires.
          */
-        Timer(u64 duration, bool auto_restart);
+        constexpr Timer(u64 duration, bool auto_restart)
+            : duration(duration), deadline(0), is_started(false), auto_restart(auto_restart),
+              is_expired(false), callback(0), context(0), schedule_index(__TIMER_NOT_SCHEDULED)
+        {
+        }
 
         /**
          * @brief Construct a new Timer object, defaulting the auto restart option
@@ -35,11 +74,29 @@ namespace thingnet::utils
          * 
          * @param duration The duration of the timer.
          */
-        Timer(u64 duration);
+        constexpr Timer(u64 duration) : Timer(duration, false) {}
+
+        /**
+         * @brief Destroy the Timer object
+         */
+        ~Timer();
 
         /**
-         * @brief Determines whether or not the timer is complete. If complete, a
-         * new timer will be started from the current time.
+         * @brief Sets a function to be invoked by the timer service when the
+         * timer expires. Timers with a callback are never reported as complete
+         * by is_complete().
+         * 
+         * @param callback The function to invoke.
+         * @param context A pointer that will be passed to the function.
+         * @return int A non success value will be returned if the add operation
+         * resulted in an error. See error codes for more information.
+         */
+        int set_callback(timer_callback_t callback, void *context);
+
+        /**
+         * @brief Determines whether or not the timer has completed since this
+         * method was last called. If the timer auto restarts, the next run
+         * will have started from the time at which the timer expired.
          * 
          * @return true If the timer has completed
          * @return false If the timer has not completed, or has been stopped.
@@ -56,7 +113,8 @@ namespace thingnet::utils
 
         /**
          * @brief Starts the timer. If the timer has been started, this method will
-         * have no effect.
+         * have no effect. A timer with a callback is not started if the timer
+         * service has no room to schedule it.
          * 
          * @return int A non success value will be returned if the add operation
          * resulted in an error. See error codes for more information.
@@ -79,6 +137,23 @@ namespace thingnet::utils
          * resulted in an error. See error codes for more information.
          */
         int restart();
+
+        /**
+         * @brief Sets the duration of the timer. The new duration applies to
+         * the current run of the timer if it has been started.
+         * 
+         * @param duration The duration of the timer.
+         * @return int A non success value will be returned if the add operation
+         * resulted in an error. See error codes for more information.
+         */
+        int set_duration(u64 duration);
+
+        /**
+         * @brief Gets the time at which the timer will expire.
+         * 
+         * @return u64 The deadline, in microseconds on the Clock timebase.
+         */
+        u64 get_deadline();
     };
 }
 #endif
\ No newline at end of file
@@ -0,0 +1,192 @@
+#include <Arduino.h>
+#include "clock.h"
+#include "timer.h"
+#include "timer_service.h"
+
+namespace thingnet::utils
+{
+    TimerService::TimerService()
+    {
+        this->timer_count = 0;
+        this->idle_time = 0;
+        this->is_wake_pending = false;
+    }
+
+    TimerService &TimerService::get_instance()
+    {
+        static TimerService instance;
+        return instance;
+    }
+
+    void TimerService::swap(u8 first, u8 second)
+    {
+        Timer *timer = this->timers[first];
+        this->timers[first] = this->timers[second];
+        this->timers[second] = timer;
+        this->timers[first]->schedule_index = first;
+        this->timers[second]->schedule_index = second;
+    }
+
+    void TimerService::sift_up(u8 index)
+    {
+        while (index > 0)
+        {
+            u8 parent = (index - 1) / 2;
+            if (this->timers[parent]->deadline <= this->timers[index]->deadline)
+            {
+                break;
+            }
+            this->swap(parent, index);
+            index = parent;
+        }
+    }
+
+    void TimerService::sift_down(u8 index)
+    {
+        while (true)
+        {
+            u8 smallest = index;
+            u8 left = index * 2 + 1;
+            u8 right = left + 1;
+            if (left < this->timer_count &&
+                this->timers[left]->deadline < this->timers[smallest]->deadline)
+            {
+                smallest = left;
+            }
+            if (right < this->timer_count &&
+                this->timers[right]->deadline < this->timers[smallest]->deadline)
+            {
+                smallest = right;
+            }
+            if (smallest == index)
+            {
+                break;
+            }
+            this->swap(smallest, index);
+            index = smallest;
+        }
+    }
+
+    int TimerService::schedule(Timer *timer)
+    {
+        u8 index = timer->schedule_index;
+        if (index == __TIMER_NOT_SCHEDULED)
+        {
+            if (this->timer_count >= __MAX_SCHEDULED_TIMERS)
+            {
+                return 1;
+            }
+
+            index = this->timer_count;
+            this->timers[index] = timer;
+            timer->schedule_index = index;
+            this->timer_count++;
+        }
+
+        // The deadline may have moved in either direction.
+        this->sift_up(index);
+        this->sift_down(timer->schedule_index);
+
+        return 0;
+    }
+
+    int TimerService::unschedule(Timer *timer)
+    {
+        u8 index = timer->schedule_index;
+        if (index == __TIMER_NOT_SCHEDULED)
+        {
+            return 1;
+        }
+
+        this->timer_count--;
+        if (index != this->timer_count)
+        {
+            // Fill the gap with the last timer, and restore the heap order
+            // around it.
+            this->swap(index, this->timer_count);
+            Timer *moved = this->timers[index];
+            this->sift_up(index);
+            this->sift_down(moved->schedule_index);
+        }
+        timer->schedule_index = __TIMER_NOT_SCHEDULED;
+
+        return 0;
+    }
+
+    u8 TimerService::update()
+    {
+        u64 now = Clock::now_micros();
+        u8 expired_count = 0;
+
+        // Expiring a timer removes it from the top of the heap, or pushes its
+        // deadline into the future, so this always terminates.
+        while (this->timer_count > 0 && now > this->timers[0]->deadline)
+        {
+            this->timers[0]->expire(now);
+            expired_count++;
+        }
+
+        return expired_count;
+    }
+
+    u32 TimerService::get_time_until_next_deadline()
+    {
+        if (this->timer_count == 0)
+        {
+            return __NO_TIMER_DEADLINE;
+        }
+
+        u64 now = Clock::now_micros();
+        u64 deadline = this->timers[0]->deadline;
+        if (now > deadline)
+        {
+            return 0;
+        }
+
+        // Timers expire once the deadline has been passed. Round up, so that
+        // the loop never wakes before the deadline.
+        u64 remaining = (deadline - now) / 1000 + 1;
+        return remaining > __NO_TIMER_DEADLINE ? __NO_TIMER_DEADLINE : (u32)remaining;
+    }
+
+    u32 TimerService::idle(u32 max_duration)
+    {
+        u32 duration = 0;
+        while (!this->is_wake_pending && duration < max_duration)
+        {
+            u32 remaining = this->get_time_until_next_deadline();
+            if (remaining == 0)
+            {
+                break;
+            }
+
+            if (remaining > max_duration - duration)
+            {
+                remaining = max_duration - duration;
+            }
+            u32 slice = remaining > __IDLE_SLICE_DURATION ? __IDLE_SLICE_DURATION : remaining;
+            delay(slice);
+            duration += slice;
+        }
+
+        this->is_wake_pending = false;
+        this->idle_time += duration;
+
+        return duration;
+    }
+
+    void TimerService::wake()
+    {
+        this->is_wake_pending = true;
+    }
+
+    u64 TimerService::get_idle_time()
+    {
+        return this->idle_time;
+    }
+
+    u8 TimerService::get_timer_count()
+    {
+        return this->timer_count;
+    }
+}
\ No newline at end of file
@@ -0,0 +1,117 @@
+#ifndef __TIMER_SERVICE_H
+#define __TIMER_SERVICE_H
+
+#include <Arduino.h>
+#include "timer.h"
+
+namespace thingnet::utils
+{
+    const u8 __MAX_SCHEDULED_TIMERS = 32;
+    const u32 __NO_TIMER_DEADLINE = 0xFFFFFFFF;
+    // Timers can be started by radio callbacks while the loop is idle, so the
+    // schedule is checked again at least this often.
+    const u32 __IDLE_SLICE_DURATION = 1;
+
+    /**
+     * @brief Tracks the deadlines of all running timers in a min heap, so
+     * that the next deadline can be found without polling every timer. The
+     * service expires timers as their deadlines pass, invoking their
+     * callbacks, and allows the main loop to idle until there is work to do.
+     * 
+     * Timers register and unregister themselves as they are started and
+     * stopped.
+     */
+    class TimerService
+    {
+    private:
+        Timer *timers[__MAX_SCHEDULED_TIMERS];
+        u8 timer_count;
+        u64 idle_time;
+        volatile bool is_wake_pending;
+
+        TimerService();
+
+        void swap(u8 first, u8 second);
+        void sift_up(u8 index);
+        void sift_down(u8 index);
+
+    public:
+        /**
+         * @brief Get the instance object
+         *
+         * @return TimerService&
+         */
+        static TimerService &get_instance();
+
+        /**
+         * @brief Adds a timer to the schedule, or updates its position if it
+         * has already been scheduled.
+         * 
+         * @param timer The timer to schedule.
+         * @return int 0 if the timer was scheduled, or 1 if too many timers are
+         * running. Polled timers that cannot be scheduled still work, but are
+         * not considered when idling. Timers with a callback need to be
+         * scheduled to fire, so Timer::start() fails for them instead.
+         */
+        int schedule(Timer *timer);
+
+        /**
+         * @brief Removes a timer from the schedule. This method does nothing if
+         * the timer has not been scheduled.
+         * 
+         * @param timer The timer to unschedule.
+         * @return int 0 if the timer was unscheduled, 1 otherwise.
+         */
+        int unschedule(Timer *timer);
+
+        /**
+         * @brief Expires all timers whose deadlines have passed. This should be
+         * called at the start of each pass of the main loop.
+         * 
+         * @return u8 The number of timers that expired.
+         */
+        u8 update();
+
+        /**
+         * @brief Gets the time until the next timer expires.
+         * 
+         * @return u32 The time in milliseconds, 0 if a timer is already due, or
+         * __NO_TIMER_DEADLINE if no timers are running.
+         */
+        u32 get_time_until_next_deadline();
+
+        /**
+         * @brief Yields the processor until the next timer expires, the
+         * maximum duration elapses, or wake() is called. Radio callbacks
+         * continue to run while the loop is idle, and timers that they start
+         * are taken into account.
+         * 
+         * @param max_duration The maximum time to idle, in milliseconds.
+         * @return u32 The time spent idle, in milliseconds.
+         */
+        u32 idle(u32 max_duration);
+
+        /**
+         * @brief Ends the current (or next) call to idle(), so that the loop
+         * runs again. Used by radio callbacks that leave work for the loop to
+         * finish, such as resuming a request once its response has arrived.
+         */
+        void wake();
+
+        /**
+         * @brief Gets the total time spent idle since startup.
+         * 
+         * @return u64 The idle time, in milliseconds.
+         */
+        u64 get_idle_time();
+
+        /**
+         * @brief Gets the number of timers that are currently scheduled.
+         * 
+         * @return u8 The number of timers.
+         */
+        u8 get_timer_count();
+    };
+}
+
+#endif
\ No newline at end of file
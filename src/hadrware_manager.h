@@ -19,18 +19,34 @@ private:
     DebouncedInput *advertise_input;
 
     bool is_server_mode_enabled;
+    bool is_server_mode_resolved;
     bool is_advertise_triggered;
     bool is_initialized;
+    u64 sample_start_time;
+
+    /**
+     * @brief Completes sampling of the server mode pin, waiting only for
+     * whatever is left of the debounce period.
+     */
+    void resolve_server_mode();
 
 public:
     /**
      * @brief Construct a new Hardware Manager object
      */
-    HardwareManager();
+    constexpr HardwareManager()
+        : server_mode_input(0), advertise_input(0), is_server_mode_enabled(false),
+          is_server_mode_resolved(false), is_advertise_triggered(false), is_initialized(false),
+          sample_start_time(0)
+    {
+    }
 
     /**
      * @brief Allows the hardware manager to initialize itself. This method is
-     * typically invoked once at the start of the program.
+     * typically invoked once at the start of the program. Sampling of the
+     * server mode pin is started here, but only completed when the server
+     * mode is first queried, so that other initialization work can run during
+     * the debounce period.
      *
      * @return int A non success value will be returned if the add operation
      * resulted in an error. See error codes for more information.
@@ -1,6 +1,7 @@
 #include <Arduino.h>
 
 #include "log.h"
+#include "clock.h"
 #include "error_codes.h"
 #include "debounced_input.h"
 
@@ -9,14 +10,9 @@
 using namespace thingnet;
 using namespace thingnet::utils;
 
-static Logger *logger = new Logger("hw-mgr");
+static constinit Logger logger("hw-mgr");
 
-HardwareManager::HardwareManager()
-{
-    this->is_initialized = false;
-    this->is_server_mode_enabled = false;
-    this->is_advertise_triggered = false;
-}
+static const u32 __SERVER_MODE_DEBOUNCE = 100;
 
 int HardwareManager::initialize()
 {
@@ -27,14 +23,14 @@ int HardwareManager::initialize()
     }
 
     LOG_TRACE(logger, "Configuring GPIO pins");
-    this->server_mode_input = new DebouncedInput(14, 100);
+    this->server_mode_input = new DebouncedInput(14, __SERVER_MODE_DEBOUNCE);
     this->advertise_input = new DebouncedInput(12, 3000);
+    this->server_mode_input->enable_interrupts();
+    this->advertise_input->enable_interrupts();
 
     LOG_DEBUG(logger, "Reading inital pin values");
     this->server_mode_input->is_triggered();
-    // Sleep for a bit to allow the debounce checker to work.
-    delay(105);
-    this->is_server_mode_enabled = this->server_mode_input->is_triggered();
+    this->sample_start_time = Clock::now_millis();
 
     LOG_TRACE(logger, "Setting initialization flag");
     this->is_initialized = true;
@@ -56,8 +52,25 @@ int HardwareManager::update()
     return thingnet::RESULT_OK;
 }
 
+void HardwareManager::resolve_server_mode()
+{
+    // Wait for whatever is left of the debounce period, allowing the debounce
+    // checker to work.
+    u64 elapsed = Clock::now_millis() - this->sample_start_time;
+    if (elapsed <= __SERVER_MODE_DEBOUNCE)
+    {
+        delay(__SERVER_MODE_DEBOUNCE - elapsed + 5);
+    }
+    this->is_server_mode_enabled = this->server_mode_input->is_triggered();
+    this->is_server_mode_resolved = true;
+}
+
 bool HardwareManager::is_server_mode()
 {
+    if (this->is_initialized && !this->is_server_mode_resolved)
+    {
+        this->resolve_server_mode();
+    }
     return this->is_server_mode_enabled;
 }
 
@@ -7,13 +7,19 @@
 #include <espnow.h>
 
 #include "log.h"
+#include "log_console.h"
 #include "pulser.h"
 #include "timer.h"
+#include "timer_service.h"
+#include "boot_profiler.h"
 #include "error_codes.h"
 #include "node.h"
 #include "node_profile.h"
 #include "server_node_profile.h"
 #include "client_node_profile.h"
+#include "static_node_profile.h"
+#include "littlefs_peer_store.h"
+#include "basic_peer.h"
 
 #include "hadrware_manager.h"
 
@@ -21,66 +27,192 @@ using namespace thingnet;
 using namespace thingnet::message_handlers;
 using namespace thingnet::peers;
 using namespace thingnet::utils;
+using namespace thingnet::storage;
 
-static Logger *logger = new Logger("main");
+static const u16 __LOG_FLUSH_BUDGET = 128;
+static const u32 __STATUS_PERIOD = 10000;
+// The inputs and the log console are polled, rather than waking the loop.
+static const u32 __INPUT_POLL_PERIOD = 50;
+
+static constinit Logger logger("main");
 static Node &node = Node::get_instance();
 
-static Timer *status_timer = new Timer(10000, true);
-static HardwareManager *hw_manager = new HardwareManager();
+// Constant initialized, so nothing is allocated or run before setup().
+static constinit Timer status_timer(__STATUS_PERIOD, true);
+static constinit Timer input_timer(__INPUT_POLL_PERIOD, true);
+static constinit HardwareManager hw_manager;
+static constinit LittleFsPeerStore peer_store("/peers.bin");
+static constinit LogConsole log_console;
+
+void print_status(void *context)
+{
+    static u64 last_idle_time = 0;
+    u64 idle_time = TimerService::get_instance().get_idle_time();
+
+    LOG_INFO(logger, "-==-");
+    LOG_INFO(logger, "Profile    : [%s]",
+             hw_manager.is_server_mode() ? "SERVER" : "CLIENT");
+    LOG_INFO(logger, "Peer count : [%d]", node.get_profile()->get_peer_count());
+    for (Peer *peer : node.get_profile()->get_peers())
+    {
+        const PeerStats *stats = peer->get_stats();
+        LOG_INFO(logger, "  [%s] in [%d/%d] out [%d/%d] seen [%d] ms, misses [%d], failures [%d]",
+                 LOG_FORMAT_MAC(peer->get_mac_address()),
+                 stats->frames_in, stats->bytes_in,
+                 stats->frames_out, stats->bytes_out,
+                 peer->get_last_seen_age(),
+                 stats->heartbeat_misses,
+                 stats->send_failures);
+    }
+    if (hw_manager.is_server_mode())
+    {
+        const BeaconStats *stats =
+            ((ServerNodeProfile *)node.get_profile())->get_beacon_stats();
+        LOG_INFO(logger, "Beacons    : [%d] every [%d] ms, [%d] us airtime",
+                 stats->beacons_sent, stats->interval, stats->airtime);
+    }
+    else
+    {
+        ClientNodeProfile *profile = (ClientNodeProfile *)node.get_profile();
+        LOG_INFO(logger, "Reconnect  : [%d] ms", profile->get_reconnect_latency());
+        LOG_INFO(logger, "Server load: [%d]/1000", profile->get_server_load());
+    }
+    LOG_INFO(logger, "Log drops  : [%d]", Logger::get_dropped_count());
+    LOG_INFO(logger, "Idle       : [%d]%%", (u32)((idle_time - last_idle_time) * 100 / __STATUS_PERIOD));
+    LOG_INFO(logger, "-==-");
+    last_idle_time = idle_time;
+}
+
+#ifdef NODE_STATIC_DISPATCH
+void on_peer_added(int event_type, PeerListEventData event_data)
+{
+    LOG_INFO(logger, "Peer [%s] added", LOG_FORMAT_MAC(event_data.peer_mac_address));
+}
+
+void on_peer_removed(int event_type, PeerListEventData event_data)
+{
+    LOG_INFO(logger, "Peer [%s] removed", LOG_FORMAT_MAC(event_data.peer_mac_address));
+}
+
+// Peer events are logged by listeners bound at build time.
+template <typename Profile>
+using StaticProfile = StaticNodeProfile<Profile,
+                                        StaticBasicPeer,
+                                        ListenerList<FunctionListener<&on_peer_added>>,
+                                        ListenerList<FunctionListener<&on_peer_removed>>>;
+#endif
+
+void poll_inputs(void *context)
+{
+    ASSERT_OK(hw_manager.update());
+
+    if (hw_manager.send_advertisement())
+    {
+        LOG_INFO(logger, "Advertising server");
+        ServerNodeProfile *profile = (ServerNodeProfile *)node.get_profile();
+        if (profile->advertise() != RESULT_OK)
+        {
+            LOG_WARN(logger, "Unable to send advertisement");
+        }
+    }
+
+    log_console.update();
+}
 
 void setup()
 {
+    BootProfiler &profiler = BootProfiler::get_instance();
+
     Serial.begin(115200);
+    profiler.mark("serial");
 
     LOG_DEBUG(logger, "Determining node profile");
     NodeProfile *profile;
 
     LOG_DEBUG(logger, "Initializing hardware manager");
-    hw_manager->initialize();
+    hw_manager.initialize();
 
     LOG_DEBUG(logger, "Performing preliminary update on hardware manager");
-    ASSERT_OK(hw_manager->update());
+    ASSERT_OK(hw_manager.update());
+    profiler.mark("hw-manager");
+
+    // Bring the radio up while the server mode pin is being debounced.
+    LOG_DEBUG(logger, "Starting radio");
+    ASSERT_OK(node.start_radio());
 
-    if (hw_manager->is_server_mode())
+    // Every peer is a basic peer, so builds with NODE_STATIC_DISPATCH bind
+    // the calls made to peers (and to peer event listeners) at build time.
+    if (hw_manager.is_server_mode())
     {
+#ifdef NODE_STATIC_DISPATCH
+        profile = new StaticProfile<ServerNodeProfile>(&node);
+#else
         profile = new ServerNodeProfile(&node);
+#endif
         LOG_INFO(logger, "Node profile is [SERVER]");
     }
     else
     {
+#ifdef NODE_STATIC_DISPATCH
+        profile = new StaticProfile<ClientNodeProfile>(&node);
+#else
         profile = new ClientNodeProfile(&node);
+#endif
         LOG_INFO(logger, "Node profile is [CLIENT]");
     }
+    profiler.mark("server-mode");
+
+    LOG_DEBUG(logger, "Initializing peer store");
+    if (peer_store.init() == RESULT_OK)
+    {
+        ASSERT_OK(profile->set_peer_store(&peer_store));
+    }
+    else
+    {
+        LOG_WARN(logger, "Peer store unavailable. Peers will not be persisted");
+    }
+    profiler.mark("peer-store");
 
     node.set_node_profile(profile);
 
     LOG_DEBUG(logger, "Initializing node");
     ASSERT_OK(node.init());
 
+    // The tables are sized by the build. See node_config.h.
+    u32 stack_memory = node.get_memory_usage() + profile->get_memory_usage();
+    LOG_INFO(logger, "Network memory: [%d] bytes, plus [%d] bytes per peer (up to [%d] peers)",
+             stack_memory, (u32)sizeof(BasicPeer), __MAX_PEER_COUNT);
+    LOG_INFO(logger, "Coroutine frames: [%d] of [%d] bytes, included above",
+             __MAX_COROUTINE_FRAMES, __COROUTINE_FRAME_SIZE);
+
     LOG_DEBUG(logger, "Starting status timer");
-    status_timer->start();
+    status_timer.set_callback(print_status, 0);
+    status_timer.start();
+
+    LOG_DEBUG(logger, "Starting input timer");
+    input_timer.set_callback(poll_inputs, 0);
+    input_timer.start();
 
     LOG_INFO(logger, "Initialization complete");
+    profiler.complete();
+
+    // Nothing time critical is running yet, so write out the boot logs in
+    // full.
+    Logger::flush(LOG_BUFFER_SIZE, true);
 }
 
 void loop()
 {
-    ASSERT_OK(node.update());
-    ASSERT_OK(hw_manager->update());
+    TimerService &timer_service = TimerService::get_instance();
+    timer_service.update();
 
-    if (hw_manager->send_advertisement())
-    {
-        LOG_INFO(logger, "Advertising server");
-        ServerNodeProfile *profile = (ServerNodeProfile *)node.get_profile();
-        ASSERT_OK(profile->advertise());
-    }
+    ASSERT_OK(node.update());
 
-    if (status_timer->is_complete())
+    // Keep going if there is more log output waiting to be written.
+    // Otherwise, all remaining work is driven by timers (or woken by the
+    // radio), so sleep until the next one is due.
+    if (Logger::flush(__LOG_FLUSH_BUDGET) < __LOG_FLUSH_BUDGET)
     {
-        LOG_INFO(logger, "-==-");
-        LOG_INFO(logger, "Profile    : [%s]",
-                 hw_manager->is_server_mode() ? "SERVER" : "CLIENT");
-        LOG_INFO(logger, "Peer count : [%d]", node.get_profile()->get_peer_count());
-        LOG_INFO(logger, "-==-");
+        timer_service.idle(__NO_TIMER_DEADLINE);
     }
 }
\ No newline at end of file
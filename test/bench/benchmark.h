@@ -0,0 +1,53 @@
+#ifndef __BENCHMARK_H
+#define __BENCHMARK_H
+
+// Minimal timing helpers for the host benchmarks in test/test_bench_*. The
+// results are printed, rather than asserted, since they depend on the host.
+// Run with `pio test -e native -f "test_bench_*" -v` to see the output.
+
+#include <Arduino.h>
+#include <chrono>
+
+namespace benchmark
+{
+    // Written to by benchmarks so that the compiler cannot discard the work
+    // being measured.
+    inline volatile u32 sink = 0;
+
+    inline void keep(u32 value)
+    {
+        sink = sink + value;
+    }
+
+    /**
+     * @brief Runs a function repeatedly and measures the average duration.
+     * 
+     * @param iterations The number of times to run the function.
+     * @param function The function to measure, given the iteration number.
+     * @return double The average duration of each run, in nanoseconds.
+     */
+    template <typename F>
+    double measure(u32 iterations, F function)
+    {
+        auto start = std::chrono::steady_clock::now();
+        for (u32 iteration = 0; iteration < iterations; iteration++)
+        {
+            function(iteration);
+        }
+        auto duration = std::chrono::steady_clock::now() - start;
+        return std::chrono::duration<double, std::nano>(duration).count() / iterations;
+    }
+
+    /**
+     * @brief Prints the result of a benchmark.
+     * 
+     * @param name The name of the benchmark.
+     * @param duration The average duration, in nanoseconds.
+     */
+    inline void report(const char *name, double duration)
+    {
+        printf("[bench] %-44s %10.1f ns\n", name, duration);
+    }
+}
+
+#endif
\ No newline at end of file
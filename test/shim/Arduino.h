@@ -0,0 +1,162 @@
+#ifndef __SHIM_ARDUINO_H
+#define __SHIM_ARDUINO_H
+
+// Host stand-in for the parts of the Arduino core used by the libraries, so
+// they can be built and tested in the native environment. Time, pins and
+// the serial port are simulated, and can be driven by tests through the
+// arduino_shim namespace.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <math.h>
+
+typedef uint8_t u8;
+typedef uint16_t u16;
+typedef uint32_t u32;
+typedef uint64_t u64;
+typedef int8_t s8;
+typedef int16_t s16;
+typedef int32_t s32;
+typedef int64_t s64;
+
+#define HIGH 0x1
+#define LOW 0x0
+#define INPUT 0x00
+#define INPUT_PULLUP 0x02
+#define OUTPUT 0x01
+#define RISING 0x01
+#define FALLING 0x02
+#define CHANGE 0x03
+
+#define IRAM_ATTR
+#define ICACHE_RAM_ATTR
+#define PROGMEM
+#define PSTR(value) (value)
+#define F(value) (value)
+
+#define TIM_DIV16 1
+#define TIM_EDGE 0
+#define TIM_LOOP 1
+
+namespace arduino_shim
+{
+    const u8 PIN_COUNT = 32;
+
+    inline u64 now_micros = 0;
+    inline u8 pin_levels[PIN_COUNT];
+    inline void (*pin_interrupts[PIN_COUNT])(void *);
+    inline void *pin_interrupt_args[PIN_COUNT];
+    inline volatile u32 gpi = 0;
+
+    /**
+     * @brief Advances the simulated time.
+     *
+     * @param duration The time to advance by, in microseconds.
+     */
+    inline void advance_micros(u64 duration)
+    {
+        now_micros += duration;
+    }
+
+    inline void advance_millis(u64 duration)
+    {
+        now_micros += duration * 1000;
+    }
+
+    /**
+     * @brief Sets the level of an input pin, invoking its interrupt handler
+     * (if attached) when the level changes.
+     *
+     * @param pin The pin number.
+     * @param level The new level.
+     */
+    inline void set_pin(u8 pin, u8 level)
+    {
+        bool is_changed = pin_levels[pin] != level;
+        pin_levels[pin] = level;
+        gpi = level ? gpi | (1UL << pin) : gpi & ~(1UL << pin);
+        if (is_changed && pin_interrupts[pin] != 0)
+        {
+            pin_interrupts[pin](pin_interrupt_args[pin]);
+        }
+    }
+}
+
+#define GPI (arduino_shim::gpi)
+
+inline unsigned long millis() { return (unsigned long)(arduino_shim::now_micros / 1000); }
+inline unsigned long micros() { return (unsigned long)arduino_shim::now_micros; }
+inline void delay(unsigned long duration) { arduino_shim::advance_millis(duration); }
+inline void delayMicroseconds(unsigned int duration) { arduino_shim::advance_micros(duration); }
+inline void yield() {}
+
+inline void pinMode(u8 pin, u8 mode) {}
+inline int digitalRead(u8 pin) { return arduino_shim::pin_levels[pin]; }
+inline void digitalWrite(u8 pin, u8 level) { arduino_shim::pin_levels[pin] = level; }
+inline u8 digitalPinToInterrupt(u8 pin) { return pin; }
+
+inline void attachInterruptArg(u8 pin, void (*handler)(void *), void *arg, int mode)
+{
+    arduino_shim::pin_interrupts[pin] = handler;
+    arduino_shim::pin_interrupt_args[pin] = arg;
+}
+
+inline void detachInterrupt(u8 pin)
+{
+    arduino_shim::pin_interrupts[pin] = 0;
+}
+
+inline void noInterrupts() {}
+inline void interrupts() {}
+
+inline void timer1_attachInterrupt(void (*handler)()) {}
+inline void timer1_enable(u8 divider, u8 interrupt_type, u8 reload) {}
+inline void timer1_write(u32 ticks) {}
+inline void timer1_disable() {}
+
+inline long random(long max) { return max <= 0 ? 0 : rand() % max; }
+inline long random(long min, long max) { return max <= min ? min : min + rand() % (max - min); }
+inline void randomSeed(unsigned long seed) { srand(seed); }
+
+/**
+ * @brief Serial port stand-in. Output is discarded, unless echo is set, and
+ * input is read from a buffer that tests can fill.
+ */
+class HardwareSerial
+{
+public:
+    bool echo = false;
+    const char *input = "";
+
+    void begin(unsigned long baud) {}
+    int available() { return (int)strlen(this->input); }
+    int read() { return *this->input != 0 ? *this->input++ : -1; }
+    int availableForWrite() { return 128; }
+
+    size_t write(const u8 *data, size_t length)
+    {
+        return this->echo ? fwrite(data, 1, length, stdout) : length;
+    }
+
+    size_t print(const char *value) { return this->write((const u8 *)value, strlen(value)); }
+    size_t println() { return this->print("\n"); }
+    size_t println(const char *value) { return this->print(value) + this->println(); }
+
+    size_t printf(const char *format, ...)
+    {
+        char buffer[256];
+        va_list args;
+        va_start(args, format);
+        int length = vsnprintf(buffer, sizeof(buffer), format, args);
+        va_end(args);
+        return this->print(buffer) > 0 ? length : 0;
+    }
+};
+
+inline HardwareSerial Serial;
+
+#endif
\ No newline at end of file
@@ -0,0 +1,39 @@
+#ifndef __SHIM_ESP8266WIFI_H
+#define __SHIM_ESP8266WIFI_H
+
+// Host stand-in for the ESP8266 WiFi API.
+
+#include <Arduino.h>
+
+enum WiFiMode_t
+{
+    WIFI_OFF,
+    WIFI_STA,
+    WIFI_AP,
+    WIFI_AP_STA
+};
+
+class ESP8266WiFiClass
+{
+public:
+    u8 station_mac_address[6] = {0x02, 0x00, 0x00, 0x00, 0x00, 0x01};
+    u8 ap_mac_address[6] = {0x02, 0x00, 0x00, 0x00, 0x00, 0x02};
+
+    bool mode(WiFiMode_t mode) { return true; }
+
+    u8 *macAddress(u8 *mac_addr)
+    {
+        memcpy(mac_addr, this->station_mac_address, 6);
+        return mac_addr;
+    }
+
+    u8 *softAPmacAddress(u8 *mac_addr)
+    {
+        memcpy(mac_addr, this->ap_mac_address, 6);
+        return mac_addr;
+    }
+};
+
+inline ESP8266WiFiClass WiFi;
+
+#endif
\ No newline at end of file
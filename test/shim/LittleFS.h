@@ -0,0 +1,57 @@
+#ifndef __SHIM_LITTLEFS_H
+#define __SHIM_LITTLEFS_H
+
+// Host stand-in for the LittleFS API, backed by the host file system. Paths
+// are used as given, relative to the working directory of the test.
+
+#include <Arduino.h>
+
+class File
+{
+private:
+    FILE *file;
+
+public:
+    File(FILE *file = 0) : file(file) {}
+
+    operator bool() const { return this->file != 0; }
+    size_t read(u8 *data, size_t length) { return fread(data, 1, length, this->file); }
+    size_t write(const u8 *data, size_t length) { return fwrite(data, 1, length, this->file); }
+
+    void close()
+    {
+        if (this->file != 0)
+        {
+            fclose(this->file);
+            this->file = 0;
+        }
+    }
+};
+
+class LittleFSClass
+{
+public:
+    bool begin() { return true; }
+
+    bool exists(const char *path)
+    {
+        FILE *file = fopen(path, "rb");
+        if (file != 0)
+        {
+            fclose(file);
+        }
+        return file != 0;
+    }
+
+    File open(const char *path, const char *mode)
+    {
+        return File(fopen(path, mode[0] == 'w' ? "wb" : "rb"));
+    }
+
+    bool remove(const char *path) { return ::remove(path) == 0; }
+    bool rename(const char *from, const char *to) { return ::rename(from, to) == 0; }
+};
+
+inline LittleFSClass LittleFS;
+
+#endif
\ No newline at end of file
@@ -0,0 +1,101 @@
+#ifndef __SHIM_ESPNOW_H
+#define __SHIM_ESPNOW_H
+
+// Host stand-in for the ESP-NOW API. Sent frames are counted (and the last
+// one is kept), registered peers are tracked up to the SDK's limit, and tests
+// can deliver frames through the registered receive callback.
+
+#include <Arduino.h>
+
+enum esp_now_role
+{
+    ESP_NOW_ROLE_IDLE = 0,
+    ESP_NOW_ROLE_CONTROLLER,
+    ESP_NOW_ROLE_SLAVE,
+    ESP_NOW_ROLE_COMBO,
+    ESP_NOW_ROLE_MAX
+};
+
+typedef void (*esp_now_recv_cb_t)(u8 *mac_addr, u8 *data, u8 len);
+typedef void (*esp_now_send_cb_t)(u8 *mac_addr, u8 status);
+
+namespace arduino_shim
+{
+    const u8 ESP_NOW_MAX_PEERS = 20;
+
+    inline esp_now_recv_cb_t esp_now_recv_cb = 0;
+    inline esp_now_send_cb_t esp_now_send_cb = 0;
+    inline u8 esp_now_peers[ESP_NOW_MAX_PEERS][6];
+    inline u8 esp_now_peer_count = 0;
+    inline u32 esp_now_sent_count = 0;
+    inline u8 esp_now_last_destination[6];
+    inline u8 esp_now_last_frame[250];
+    inline u8 esp_now_last_length = 0;
+
+    inline int find_esp_now_peer(const u8 *mac_addr)
+    {
+        for (u8 index = 0; index < esp_now_peer_count; index++)
+        {
+            if (memcmp(esp_now_peers[index], mac_addr, 6) == 0)
+            {
+                return index;
+            }
+        }
+        return -1;
+    }
+}
+
+inline int esp_now_init() { return 0; }
+inline int esp_now_deinit() { return 0; }
+inline int esp_now_set_self_role(u8 role) { return 0; }
+
+inline int esp_now_register_recv_cb(esp_now_recv_cb_t cb)
+{
+    arduino_shim::esp_now_recv_cb = cb;
+    return 0;
+}
+
+inline int esp_now_register_send_cb(esp_now_send_cb_t cb)
+{
+    arduino_shim::esp_now_send_cb = cb;
+    return 0;
+}
+
+inline int esp_now_send(u8 *mac_addr, u8 *data, int len)
+{
+    arduino_shim::esp_now_sent_count++;
+    memcpy(arduino_shim::esp_now_last_destination, mac_addr, 6);
+    memcpy(arduino_shim::esp_now_last_frame, data, len);
+    arduino_shim::esp_now_last_length = len;
+    return 0;
+}
+
+inline int esp_now_is_peer_exist(u8 *mac_addr)
+{
+    return arduino_shim::find_esp_now_peer(mac_addr) >= 0;
+}
+
+inline int esp_now_add_peer(u8 *mac_addr, u8 role, u8 channel, u8 *key, u8 key_len)
+{
+    if (arduino_shim::esp_now_peer_count >= arduino_shim::ESP_NOW_MAX_PEERS)
+    {
+        return -1;
+    }
+    memcpy(arduino_shim::esp_now_peers[arduino_shim::esp_now_peer_count++], mac_addr, 6);
+    return 0;
+}
+
+inline int esp_now_del_peer(u8 *mac_addr)
+{
+    int index = arduino_shim::find_esp_now_peer(mac_addr);
+    if (index < 0)
+    {
+        return -1;
+    }
+    arduino_shim::esp_now_peer_count--;
+    memcpy(arduino_shim::esp_now_peers[index],
+           arduino_shim::esp_now_peers[arduino_shim::esp_now_peer_count], 6);
+    return 0;
+}
+
+#endif
\ No newline at end of file
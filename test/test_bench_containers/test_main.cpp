@@ -0,0 +1,206 @@
+#include <Arduino.h>
+#include <unity.h>
+
+#include "benchmark.h"
+#include "static_vector.h"
+#include "ring_buffer.h"
+#include "flat_map.h"
+#include "index_pool.h"
+
+using namespace thingnet::utils;
+
+// Each container is compared against the hand written code that it replaced
+// in the core.
+
+static const u32 __ITERATIONS = 200000;
+static const u16 __PEER_COUNT = 50;
+static const u16 __MAP_SIZE = 32;
+
+void setUp()
+{
+}
+
+void tearDown()
+{
+}
+
+// Prune every third peer from a full list.
+void test_bench_prune()
+{
+    double legacy = benchmark::measure(__ITERATIONS, [](u32 iteration) {
+        u32 peers[__PEER_COUNT];
+        u16 count = __PEER_COUNT;
+        for (u16 index = 0; index < count; index++)
+        {
+            peers[index] = iteration + index;
+        }
+
+        // Shift the rest of the list down over each removed peer.
+        u16 index = 0;
+        while (index < count)
+        {
+            if (peers[index] % 3 == 0)
+            {
+                for (u16 next = index; next < count - 1; next++)
+                {
+                    peers[next] = peers[next + 1];
+                }
+                count--;
+                continue;
+            }
+            index++;
+        }
+        benchmark::keep(count + peers[0]);
+    });
+
+    double vector = benchmark::measure(__ITERATIONS, [](u32 iteration) {
+        StaticVector<u32, __PEER_COUNT> peers;
+        for (u16 index = 0; index < __PEER_COUNT; index++)
+        {
+            peers.push_back(iteration + index);
+        }
+
+        peers.remove_if([](u32 peer) { return peer % 3 == 0; });
+        benchmark::keep(peers.size() + peers[0]);
+    });
+
+    benchmark::report("prune 50 peers: shifting array", legacy);
+    benchmark::report("prune 50 peers: StaticVector::remove_if", vector);
+}
+
+// Queue and admit connect requests.
+void test_bench_queue()
+{
+    static const u8 capacity = 16;
+
+    double legacy = benchmark::measure(__ITERATIONS, [](u32 iteration) {
+        static u32 queue[capacity];
+        static u8 head = 0;
+        static u8 count = 0;
+
+        for (u8 index = 0; index < 3; index++)
+        {
+            if (count < capacity)
+            {
+                queue[(head + count) % capacity] = iteration + index;
+                count++;
+            }
+        }
+        for (u8 index = 0; index < 3 && count > 0; index++)
+        {
+            benchmark::keep(queue[head]);
+            head = (head + 1) % capacity;
+            count--;
+        }
+    });
+
+    double ring = benchmark::measure(__ITERATIONS, [](u32 iteration) {
+        static RingBuffer<u32, capacity> queue;
+
+        for (u8 index = 0; index < 3; index++)
+        {
+            queue.push(iteration + index);
+        }
+        u32 item;
+        for (u8 index = 0; index < 3 && queue.pop(&item) == 0; index++)
+        {
+            benchmark::keep(item);
+        }
+    });
+
+    benchmark::report("queue 3 + admit 3: modulo ring", legacy);
+    benchmark::report("queue 3 + admit 3: RingBuffer", ring);
+}
+
+// Look up a key in a table of 32 entries.
+void test_bench_lookup()
+{
+    static u32 keys[__MAP_SIZE];
+    static u32 values[__MAP_SIZE];
+    static FlatMap<u32, u32, __MAP_SIZE> map;
+    for (u16 index = 0; index < __MAP_SIZE; index++)
+    {
+        keys[index] = index * 7;
+        values[index] = index;
+        map.insert(index * 7, index);
+    }
+
+    double legacy = benchmark::measure(__ITERATIONS, [](u32 iteration) {
+        u32 key = (iteration % __MAP_SIZE) * 7;
+        for (u16 index = 0; index < __MAP_SIZE; index++)
+        {
+            if (keys[index] == key)
+            {
+                benchmark::keep(values[index]);
+                break;
+            }
+        }
+    });
+
+    double flat_map = benchmark::measure(__ITERATIONS, [](u32 iteration) {
+        u32 *value = map.find((iteration % __MAP_SIZE) * 7);
+        benchmark::keep(*value);
+    });
+
+    TEST_ASSERT_EQUAL(5, *map.find(35));
+    benchmark::report("lookup in 32 entries: linear search", legacy);
+    benchmark::report("lookup in 32 entries: FlatMap::find", flat_map);
+}
+
+// Allocate and release a slot from a pool that is mostly in use.
+void test_bench_pool()
+{
+    static const u16 capacity = 64;
+
+    double legacy = benchmark::measure(__ITERATIONS, [](u32 iteration) {
+        static bool used[capacity];
+        static bool is_filled = false;
+        if (!is_filled)
+        {
+            for (u16 index = 0; index < capacity - 1; index++)
+            {
+                used[index] = true;
+            }
+            is_filled = true;
+        }
+
+        for (u16 index = 0; index < capacity; index++)
+        {
+            if (!used[index])
+            {
+                used[index] = true;
+                benchmark::keep(index);
+                used[index] = false;
+                break;
+            }
+        }
+    });
+
+    double pool = benchmark::measure(__ITERATIONS, [](u32 iteration) {
+        static IndexPool<capacity> pool;
+        u16 index;
+        while (pool.get_available_count() > 1)
+        {
+            pool.allocate(&index);
+        }
+
+        if (pool.allocate(&index) == 0)
+        {
+            benchmark::keep(index);
+            pool.release(index);
+        }
+    });
+
+    benchmark::report("allocate 1 of 64: bool array", legacy);
+    benchmark::report("allocate 1 of 64: IndexPool", pool);
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_bench_prune);
+    RUN_TEST(test_bench_queue);
+    RUN_TEST(test_bench_lookup);
+    RUN_TEST(test_bench_pool);
+    return UNITY_END();
+}
\ No newline at end of file
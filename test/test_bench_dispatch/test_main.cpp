@@ -0,0 +1,140 @@
+#include <Arduino.h>
+#include <unity.h>
+
+#include "benchmark.h"
+#include "static_vector.h"
+#include "messages.h"
+#include "node.h"
+#include "basic_peer.h"
+#include "static_peer.h"
+
+using namespace thingnet;
+using namespace thingnet::peers;
+using namespace thingnet::utils;
+
+// The runtime loops are the ones that the node and NodeProfile run over
+// their peers, and the static loops are the ones that StaticNodeProfile runs.
+// The flash used by each mode is compared on the device, see the esp07s_static
+// environment in platformio.ini.
+
+static const u32 __ITERATIONS = 200000;
+static const u16 __PEER_COUNT = 16;
+
+static Node &node = Node::get_instance();
+static StaticVector<MessageHandler *, __PEER_COUNT> handlers;
+static StaticVector<Peer *, __PEER_COUNT> runtime_peers;
+static StaticVector<Peer *, __PEER_COUNT> static_peers;
+
+static MacAddress peer_mac_address(u16 index)
+{
+    u8 bytes[6] = {0x02, 0x00, 0x00, 0x00, (u8)(index >> 8), (u8)index};
+    return MacAddress::from_bytes(bytes);
+}
+
+/**
+ * @brief Builds an ACK that no peer is waiting for, so that processing it
+ * does not send anything.
+ */
+static PeerMessage ack_from(u16 index)
+{
+    PeerMessage message;
+    message.sender = peer_mac_address(index);
+    message.body_length = 2;
+    message.payload.type = MSG_TYPE_ACK;
+    message.payload.message_id = 1;
+    memset(message.payload.body, 0xFF, 2);
+    return message;
+}
+
+void setUp()
+{
+}
+
+void tearDown()
+{
+}
+
+// Deliver a message from each peer in turn, walking the peers until one
+// handles it.
+void test_bench_receive()
+{
+    double runtime = benchmark::measure(__ITERATIONS, [](u32 iteration) {
+        PeerMessage message = ack_from(iteration % __PEER_COUNT);
+        for (MessageHandler *handler : handlers)
+        {
+            if (handler->can_handle(&message))
+            {
+                benchmark::keep(handler->process(&message));
+                break;
+            }
+        }
+    });
+
+    double bound = benchmark::measure(__ITERATIONS, [](u32 iteration) {
+        PeerMessage message = ack_from(iteration % __PEER_COUNT);
+        for (Peer *peer : static_peers)
+        {
+            StaticBasicPeer *typed_peer = static_cast<StaticBasicPeer *>(peer);
+            if (typed_peer->static_can_handle(&message))
+            {
+                benchmark::keep(typed_peer->static_process(&message));
+                break;
+            }
+        }
+    });
+
+    benchmark::report("receive: runtime handler chain", runtime);
+    benchmark::report("receive: static peer router", bound);
+    TEST_ASSERT_GREATER_THAN(0, runtime);
+}
+
+// Check every peer for activity, as the prune timer does.
+void test_bench_prune_check()
+{
+    double runtime = benchmark::measure(__ITERATIONS, [](u32 iteration) {
+        u32 active_count = 0;
+        for (Peer *peer : runtime_peers)
+        {
+            active_count += peer->is_active();
+        }
+        benchmark::keep(active_count);
+    });
+
+    double bound = benchmark::measure(__ITERATIONS, [](u32 iteration) {
+        u32 active_count = 0;
+        for (Peer *peer : static_peers)
+        {
+            active_count += static_cast<StaticBasicPeer *>(peer)->is_active();
+        }
+        benchmark::keep(active_count);
+    });
+
+    benchmark::report("prune check: runtime peers", runtime);
+    benchmark::report("prune check: static peers", bound);
+    TEST_ASSERT_GREATER_THAN(0, runtime);
+}
+
+// The size of each peer, which is the same in both modes.
+void test_bench_peer_size()
+{
+    printf("[bench] %-44s %10u bytes\n", "peer size: BasicPeer", (u32)sizeof(BasicPeer));
+    printf("[bench] %-44s %10u bytes\n", "peer size: StaticBasicPeer", (u32)sizeof(StaticBasicPeer));
+    TEST_ASSERT_EQUAL(sizeof(BasicPeer), sizeof(StaticBasicPeer));
+}
+
+int main(int argc, char **argv)
+{
+    for (u16 index = 0; index < __PEER_COUNT; index++)
+    {
+        BasicPeer *runtime_peer = new BasicPeer(&node, peer_mac_address(index));
+        handlers.push_back(runtime_peer);
+        runtime_peers.push_back(runtime_peer);
+        static_peers.push_back(new StaticBasicPeer(&node, peer_mac_address(index), BASIC_PEER_DEFAULT_TIMEOUT));
+    }
+
+    UNITY_BEGIN();
+    RUN_TEST(test_bench_receive);
+    RUN_TEST(test_bench_prune_check);
+    RUN_TEST(test_bench_peer_size);
+    return UNITY_END();
+}
\ No newline at end of file
@@ -0,0 +1,97 @@
+#include <Arduino.h>
+#include <unity.h>
+
+#include "benchmark.h"
+#include "event_emitter.h"
+#include "static_event_emitter.h"
+
+using namespace thingnet;
+
+// Emitting an event to the same four listeners, registered at runtime or
+// bound at build time.
+
+static const u32 __ITERATIONS = 1000000;
+static const int __EVENT_TYPE = 1;
+
+static u32 total = 0;
+
+static void on_event_a(int event_type, u32 event_data)
+{
+    total += event_data;
+}
+
+static void on_event_b(int event_type, u32 event_data)
+{
+    total ^= event_data;
+}
+
+static void on_event_c(int event_type, u32 event_data)
+{
+    total += event_type;
+}
+
+static void on_event_d(int event_type, u32 event_data)
+{
+    total = (total << 1) | (total >> 31);
+}
+
+typedef ListenerList<FunctionListener<&on_event_a>,
+                     FunctionListener<&on_event_b>,
+                     FunctionListener<&on_event_c>,
+                     FunctionListener<&on_event_d>>
+    BenchListeners;
+
+void setUp()
+{
+    total = 0;
+}
+
+void tearDown()
+{
+}
+
+void test_bench_emit()
+{
+    EventEmitter<u32> runtime(__EVENT_TYPE);
+    runtime.add_listener(&on_event_a);
+    runtime.add_listener(&on_event_b);
+    runtime.add_listener(&on_event_c);
+    runtime.add_listener(&on_event_d);
+    StaticEventEmitter<u32, BenchListeners> bound(__EVENT_TYPE);
+    EventEmitter<u32> *mixed = new StaticEventEmitter<u32, BenchListeners, true>(__EVENT_TYPE);
+
+    double runtime_duration = benchmark::measure(__ITERATIONS, [&runtime](u32 iteration) {
+        runtime.emit(iteration);
+    });
+    u32 runtime_total = total;
+
+    total = 0;
+    double bound_duration = benchmark::measure(__ITERATIONS, [&bound](u32 iteration) {
+        bound.emit(iteration);
+    });
+    u32 bound_total = total;
+
+    total = 0;
+    double mixed_duration = benchmark::measure(__ITERATIONS, [mixed](u32 iteration) {
+        mixed->emit(iteration);
+    });
+    u32 mixed_total = total;
+    benchmark::keep(total);
+
+    benchmark::report("emit: runtime listeners", runtime_duration);
+    benchmark::report("emit: static listeners", bound_duration);
+    benchmark::report("emit: static listeners, runtime enabled", mixed_duration);
+
+    // Every mode notifies the same listeners in the same order.
+    TEST_ASSERT_EQUAL(runtime_total, bound_total);
+    TEST_ASSERT_EQUAL(runtime_total, mixed_total);
+
+    delete mixed;
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_bench_emit);
+    return UNITY_END();
+}
\ No newline at end of file
@@ -0,0 +1,92 @@
+#include <Arduino.h>
+#include <unity.h>
+
+#include "benchmark.h"
+#include "debounced_input.h"
+#include "debounced_input_bank.h"
+
+using namespace thingnet::utils;
+
+// Debouncing 16 polled inputs one by one, compared with a bank that samples
+// them all with a single read of the input register. Each iteration is one
+// sample period, and the inputs toggle every 64 periods.
+
+static const u32 __ITERATIONS = 200000;
+static const u8 __INPUT_COUNT = 16;
+static const u32 __DEBOUNCE_DURATION = 20;
+static const u32 __SAMPLE_PERIOD = __DEBOUNCE_DURATION / 4;
+
+/**
+ * @brief Advances to the next sample period, toggling all of the inputs
+ * every 64 periods.
+ *
+ * @param iteration The iteration number.
+ */
+static void step(u32 iteration)
+{
+    arduino_shim::advance_millis(__SAMPLE_PERIOD);
+    if (iteration % 64 == 0)
+    {
+        u8 level = (iteration / 64) % 2;
+        for (u8 pin = 0; pin < __INPUT_COUNT; pin++)
+        {
+            arduino_shim::set_pin(pin, level);
+        }
+    }
+}
+
+void setUp()
+{
+}
+
+void tearDown()
+{
+}
+
+void test_bench_inputs()
+{
+    DebouncedInput *inputs[__INPUT_COUNT];
+    for (u8 pin = 0; pin < __INPUT_COUNT; pin++)
+    {
+        inputs[pin] = new DebouncedInput(pin, __DEBOUNCE_DURATION);
+    }
+    DebouncedInputBank bank(0xFFFF, 0xFFFF, __DEBOUNCE_DURATION);
+
+    double single = benchmark::measure(__ITERATIONS, [&inputs](u32 iteration) {
+        step(iteration);
+        u32 trigger_count = 0;
+        for (u8 pin = 0; pin < __INPUT_COUNT; pin++)
+        {
+            trigger_count += inputs[pin]->is_triggered();
+        }
+        benchmark::keep(trigger_count);
+    });
+
+    double banked = benchmark::measure(__ITERATIONS, [&bank](u32 iteration) {
+        step(iteration);
+        bank.update();
+        benchmark::keep(bank.get_rising_edges());
+    });
+
+    double toggle = benchmark::measure(__ITERATIONS, [](u32 iteration) {
+        step(iteration);
+    });
+
+    benchmark::report("16 inputs: DebouncedInput each", single - toggle);
+    benchmark::report("16 inputs: DebouncedInputBank", banked - toggle);
+    TEST_ASSERT_GREATER_THAN(0, single);
+
+    for (u8 pin = 0; pin < __INPUT_COUNT; pin++)
+    {
+        delete inputs[pin];
+    }
+}
+
+int main(int argc, char **argv)
+{
+    arduino_shim::now_micros = 1000000;
+
+    UNITY_BEGIN();
+    RUN_TEST(test_bench_inputs);
+    return UNITY_END();
+}
\ No newline at end of file
@@ -0,0 +1,138 @@
+#include <Arduino.h>
+#include <espnow.h>
+#include <unity.h>
+
+#include "clock.h"
+#include "timer_service.h"
+#include "error_codes.h"
+#include "messages.h"
+#include "node.h"
+#include "client_node_profile.h"
+
+using namespace thingnet;
+using namespace thingnet::utils;
+
+static const u8 __SERVER_MAC[6] = {0x02, 0x00, 0x00, 0x00, 0x20, 0x01};
+static const u8 __BROADCAST_MAC[6] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
+
+static Node &node = Node::get_instance();
+static ClientNodeProfile *profile;
+static u32 discovery_count = 0;
+static u32 connect_count = 0;
+
+/**
+ * @brief Runs the main loop, idling between passes the way the firmware
+ * does, until the given time has elapsed. Counts the discovery and connect
+ * messages sent along the way.
+ * 
+ * @param duration The time to run for, in milliseconds.
+ * @return u32 The number of passes made through the loop.
+ */
+static u32 run_for(u32 duration)
+{
+    TimerService &timer_service = TimerService::get_instance();
+    u64 end_time = Clock::now_millis() + duration;
+    u32 pass_count = 0;
+    while (Clock::now_millis() < end_time)
+    {
+        u32 sent_count = arduino_shim::esp_now_sent_count;
+        timer_service.update();
+        node.update();
+        if (arduino_shim::esp_now_sent_count != sent_count)
+        {
+            u8 type = arduino_shim::esp_now_last_frame[0];
+            discovery_count += type == MSG_TYPE_DISCOVERY;
+            connect_count += type == MSG_TYPE_CONNECT;
+        }
+        timer_service.idle(end_time - Clock::now_millis());
+        pass_count++;
+    }
+    return pass_count;
+}
+
+static void deliver_advertisement(u8 flags)
+{
+    u8 frame[3 + 9] = {MSG_TYPE_ADVERTISEMENT, 1, 0};
+    memcpy(frame + 3, __SERVER_MAC, 6);
+    frame[9] = flags;
+    frame[10] = 0;
+    frame[11] = 50;
+    arduino_shim::esp_now_recv_cb((u8 *)__SERVER_MAC, frame, sizeof(frame));
+}
+
+void setUp()
+{
+    discovery_count = 0;
+    connect_count = 0;
+}
+
+void tearDown()
+{
+}
+
+void test_discovery_backs_off()
+{
+    // Requests go out immediately, then after 50-75, 100-150 and 200-300 ms.
+    run_for(1);
+    TEST_ASSERT_EQUAL(1, discovery_count);
+    TEST_ASSERT_EQUAL_MEMORY(__BROADCAST_MAC, arduino_shim::esp_now_last_destination, 6);
+
+    u32 pass_count = run_for(600);
+    TEST_ASSERT_EQUAL(4, discovery_count);
+    TEST_ASSERT_LESS_THAN(10, pass_count);
+}
+
+void test_connect_retries_then_resumes_discovery()
+{
+    deliver_advertisement(MSG_ADVERTISEMENT_FLAG_SOLICITED);
+    TEST_ASSERT_TRUE(esp_now_is_peer_exist((u8 *)__SERVER_MAC));
+
+    // Solicited advertisements are connected to without any backoff.
+    run_for(2);
+    TEST_ASSERT_EQUAL(1, connect_count);
+    TEST_ASSERT_EQUAL_MEMORY(__SERVER_MAC, arduino_shim::esp_now_last_destination, 6);
+
+    // Retries back off from 100 ms, doubling each time, with up to 200 ms of
+    // jitter. Discovery is held while connecting.
+    run_for(100 + 200 + 400 + 800 + 4 * 200);
+    TEST_ASSERT_EQUAL(5, connect_count);
+    TEST_ASSERT_EQUAL(0, discovery_count);
+
+    // The connection is dropped once the last attempt goes unanswered.
+    run_for(1600 + 5 * 200);
+    TEST_ASSERT_EQUAL(5, connect_count);
+    TEST_ASSERT_GREATER_THAN(0, discovery_count);
+    TEST_ASSERT_FALSE(esp_now_is_peer_exist((u8 *)__SERVER_MAC));
+}
+
+void test_ack_connects()
+{
+    deliver_advertisement(MSG_ADVERTISEMENT_FLAG_SOLICITED);
+    run_for(2);
+    TEST_ASSERT_EQUAL(1, connect_count);
+
+    u16 message_id;
+    memcpy(&message_id, arduino_shim::esp_now_last_frame + 1, 2);
+    u8 ack[5] = {MSG_TYPE_ACK, 2, 0, (u8)message_id, (u8)(message_id >> 8)};
+    arduino_shim::esp_now_recv_cb((u8 *)__SERVER_MAC, ack, sizeof(ack));
+    TEST_ASSERT_EQUAL(1, profile->get_peer_count());
+
+    // Neither connect retries nor discovery requests are sent once connected.
+    run_for(2000);
+    TEST_ASSERT_EQUAL(1, connect_count);
+    TEST_ASSERT_EQUAL(0, discovery_count);
+}
+
+int main(int argc, char **argv)
+{
+    arduino_shim::now_micros = 1000000;
+    profile = new ClientNodeProfile(&node);
+    node.set_node_profile(profile);
+    node.init();
+
+    UNITY_BEGIN();
+    RUN_TEST(test_discovery_backs_off);
+    RUN_TEST(test_connect_retries_then_resumes_discovery);
+    RUN_TEST(test_ack_connects);
+    return UNITY_END();
+}
\ No newline at end of file
@@ -0,0 +1,159 @@
+#include <Arduino.h>
+#include <unity.h>
+
+#include "static_vector.h"
+#include "ring_buffer.h"
+#include "flat_map.h"
+#include "index_pool.h"
+
+using namespace thingnet::utils;
+
+void setUp()
+{
+}
+
+void tearDown()
+{
+}
+
+void test_static_vector_push_and_capacity()
+{
+    StaticVector<int, 4> vector;
+    for (int index = 0; index < 4; index++)
+    {
+        TEST_ASSERT_EQUAL(0, vector.push_back(index));
+    }
+    TEST_ASSERT_TRUE(vector.is_full());
+    TEST_ASSERT_EQUAL(1, vector.push_back(4));
+    TEST_ASSERT_EQUAL(4, vector.size());
+    TEST_ASSERT_EQUAL(3, vector.back());
+}
+
+void test_static_vector_erase_keeps_order()
+{
+    StaticVector<int, 8> vector;
+    for (int index = 0; index < 5; index++)
+    {
+        vector.push_back(index);
+    }
+
+    vector.erase(1);
+    TEST_ASSERT_EQUAL(4, vector.size());
+    TEST_ASSERT_EQUAL(0, vector[0]);
+    TEST_ASSERT_EQUAL(2, vector[1]);
+    TEST_ASSERT_EQUAL(4, vector[3]);
+
+    vector.insert(0, 9);
+    TEST_ASSERT_EQUAL(9, vector[0]);
+    TEST_ASSERT_EQUAL(0, vector[1]);
+
+    vector.swap_erase(0);
+    TEST_ASSERT_EQUAL(4, vector[0]);
+    TEST_ASSERT_EQUAL(4, vector.size());
+}
+
+void test_static_vector_remove_if()
+{
+    StaticVector<int, 8> vector;
+    for (int index = 0; index < 8; index++)
+    {
+        vector.push_back(index);
+    }
+
+    TEST_ASSERT_EQUAL(3, vector.remove_if([](int item) { return item % 3 == 0; }));
+    TEST_ASSERT_EQUAL(5, vector.size());
+    int expected[] = {1, 2, 4, 5, 7};
+    TEST_ASSERT_EQUAL_MEMORY(expected, vector.begin(), sizeof(expected));
+
+    TEST_ASSERT_EQUAL(1, vector.remove(4));
+    TEST_ASSERT_EQUAL(-1, vector.index_of(4));
+    TEST_ASSERT_EQUAL(2, vector.index_of(5));
+    TEST_ASSERT_TRUE(vector.contains(7));
+}
+
+void test_ring_buffer_is_fifo_across_wrap()
+{
+    RingBuffer<int, 4> buffer;
+    int item = 0;
+    for (int round = 0; round < 10; round++)
+    {
+        TEST_ASSERT_EQUAL(0, buffer.push(round));
+        TEST_ASSERT_EQUAL(0, buffer.push(round + 100));
+        TEST_ASSERT_EQUAL(round, buffer[0]);
+        TEST_ASSERT_EQUAL(0, buffer.pop(&item));
+        TEST_ASSERT_EQUAL(round, item);
+        TEST_ASSERT_EQUAL(0, buffer.pop(&item));
+        TEST_ASSERT_EQUAL(round + 100, item);
+    }
+    TEST_ASSERT_TRUE(buffer.is_empty());
+    TEST_ASSERT_EQUAL(1, buffer.pop(&item));
+}
+
+void test_ring_buffer_full()
+{
+    RingBuffer<int, 4> buffer;
+    for (int index = 0; index < 4; index++)
+    {
+        buffer.push(index);
+    }
+    TEST_ASSERT_TRUE(buffer.is_full());
+    TEST_ASSERT_EQUAL(1, buffer.push(4));
+
+    TEST_ASSERT_EQUAL(1, buffer.push_overwrite(4));
+    TEST_ASSERT_EQUAL(4, buffer.size());
+    TEST_ASSERT_EQUAL(1, buffer.peek());
+    TEST_ASSERT_EQUAL(4, buffer[3]);
+}
+
+void test_flat_map_is_sorted()
+{
+    FlatMap<int, int, 4> map;
+    TEST_ASSERT_EQUAL(0, map.insert(5, 50));
+    TEST_ASSERT_EQUAL(0, map.insert(1, 10));
+    TEST_ASSERT_EQUAL(0, map.insert(3, 30));
+    TEST_ASSERT_EQUAL(1, map.insert(3, 31));
+
+    TEST_ASSERT_EQUAL(1, map.key_at(0));
+    TEST_ASSERT_EQUAL(3, map.key_at(1));
+    TEST_ASSERT_EQUAL(5, map.key_at(2));
+    TEST_ASSERT_EQUAL(30, *map.find(3));
+    TEST_ASSERT_NULL(map.find(2));
+
+    TEST_ASSERT_EQUAL(0, map.erase(1));
+    TEST_ASSERT_EQUAL(1, map.erase(1));
+    TEST_ASSERT_EQUAL(1, map.remove_if([](int key, int value) { return key == 3; }));
+    TEST_ASSERT_EQUAL(1, map.size());
+    TEST_ASSERT_EQUAL(50, *map.find(5));
+}
+
+void test_index_pool_allocates_lowest_free()
+{
+    IndexPool<40> pool;
+    u16 index;
+    for (u16 expected = 0; expected < 40; expected++)
+    {
+        TEST_ASSERT_EQUAL(0, pool.allocate(&index));
+        TEST_ASSERT_EQUAL(expected, index);
+    }
+    TEST_ASSERT_EQUAL(1, pool.allocate(&index));
+
+    pool.release(33);
+    pool.release(33);
+    TEST_ASSERT_EQUAL(1, pool.get_available_count());
+    TEST_ASSERT_FALSE(pool.is_allocated(33));
+    TEST_ASSERT_EQUAL(0, pool.allocate(&index));
+    TEST_ASSERT_EQUAL(33, index);
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_static_vector_push_and_capacity);
+    RUN_TEST(test_static_vector_erase_keeps_order);
+    RUN_TEST(test_static_vector_remove_if);
+    RUN_TEST(test_ring_buffer_is_fifo_across_wrap);
+    RUN_TEST(test_ring_buffer_full);
+    RUN_TEST(test_flat_map_is_sorted);
+    RUN_TEST(test_index_pool_allocates_lowest_free);
+    return UNITY_END();
+}
\ No newline at end of file
@@ -0,0 +1,154 @@
+#include <Arduino.h>
+#include <unity.h>
+
+#include "debounced_input.h"
+
+using namespace thingnet::utils;
+
+// Edges are fed to the inputs through the pin interrupt, so each one is
+// recorded by record_edge() at the simulated time it was set. The inputs
+// trigger low, and each test uses its own pin.
+
+static const u64 __DEBOUNCE_DURATION = 20;
+
+/**
+ * @brief Creates an input on a released pin, with edges recorded by the pin
+ * interrupt.
+ *
+ * @param pin The pin to use.
+ * @return DebouncedInput* The input.
+ */
+static DebouncedInput *create_input(u8 pin)
+{
+    arduino_shim::set_pin(pin, HIGH);
+    DebouncedInput *input = new DebouncedInput(pin, __DEBOUNCE_DURATION);
+    input->enable_interrupts();
+    return input;
+}
+
+/**
+ * @brief Toggles the pin, one edge per step, ending at the given level.
+ *
+ * @param pin The pin to toggle.
+ * @param edge_count The number of edges.
+ * @param final_level The level of the pin after the last edge.
+ * @param step The time between edges, in microseconds.
+ */
+static void bounce(u8 pin, u8 edge_count, u8 final_level, u32 step)
+{
+    u8 level = (edge_count % 2 == 0) ? final_level : !final_level;
+    for (u8 index = 0; index < edge_count; index++)
+    {
+        level = !level;
+        arduino_shim::set_pin(pin, level);
+        arduino_shim::advance_micros(step);
+    }
+}
+
+void setUp()
+{
+}
+
+void tearDown()
+{
+}
+
+void test_bounce_back_is_ignored()
+{
+    DebouncedInput *input = create_input(1);
+
+    bounce(1, 4, HIGH, 1000);
+    arduino_shim::advance_millis(__DEBOUNCE_DURATION * 2);
+    TEST_ASSERT_FALSE(input->is_triggered());
+    TEST_ASSERT_FALSE(input->is_active());
+
+    delete input;
+}
+
+void test_press_settles_after_bounce()
+{
+    DebouncedInput *input = create_input(2);
+
+    // The last edge is at 4 ms, so the press settles at 24 ms.
+    bounce(2, 5, LOW, 1000);
+    arduino_shim::advance_millis(__DEBOUNCE_DURATION - 2);
+    TEST_ASSERT_FALSE(input->is_triggered());
+
+    arduino_shim::advance_millis(2);
+    TEST_ASSERT_TRUE(input->is_triggered());
+    TEST_ASSERT_FALSE(input->is_triggered());
+    TEST_ASSERT_TRUE(input->is_active());
+
+    // The press is timed from the first edge of each bounce.
+    arduino_shim::advance_millis(100);
+    bounce(2, 3, HIGH, 1000);
+    arduino_shim::advance_millis(__DEBOUNCE_DURATION * 2);
+    TEST_ASSERT_FALSE(input->is_active());
+    TEST_ASSERT_EQUAL(5 + __DEBOUNCE_DURATION + 100, input->get_press_duration());
+
+    delete input;
+}
+
+void test_short_press_is_not_missed()
+{
+    DebouncedInput *input = create_input(3);
+
+    arduino_shim::set_pin(3, LOW);
+    arduino_shim::advance_millis(__DEBOUNCE_DURATION + 10);
+    arduino_shim::set_pin(3, HIGH);
+    arduino_shim::advance_millis(100);
+
+    // The press was never seen by a query, but its edges were recorded.
+    TEST_ASSERT_TRUE(input->is_triggered());
+    TEST_ASSERT_FALSE(input->is_active());
+    TEST_ASSERT_EQUAL(__DEBOUNCE_DURATION + 10, input->get_press_duration());
+
+    delete input;
+}
+
+void test_overflow_resyncs_from_pin()
+{
+    DebouncedInput *input = create_input(4);
+
+    // More edges than the buffer holds. The input restarts the debounce
+    // period from the last dropped edge, at the level of the pin.
+    bounce(4, __MAX_INPUT_EDGES * 3, LOW, 100);
+    arduino_shim::advance_millis(__DEBOUNCE_DURATION - 1);
+    TEST_ASSERT_FALSE(input->is_triggered());
+
+    arduino_shim::advance_millis(2);
+    TEST_ASSERT_TRUE(input->is_triggered());
+    TEST_ASSERT_TRUE(input->is_active());
+
+    delete input;
+}
+
+void test_overflow_back_to_released()
+{
+    DebouncedInput *input = create_input(5);
+
+    bounce(5, __MAX_INPUT_EDGES * 3 + 1, HIGH, 100);
+    arduino_shim::advance_millis(__DEBOUNCE_DURATION * 2);
+    TEST_ASSERT_FALSE(input->is_triggered());
+    TEST_ASSERT_FALSE(input->is_active());
+
+    // Edges are recorded again once the buffer has drained.
+    bounce(5, 1, LOW, 100);
+    arduino_shim::advance_millis(__DEBOUNCE_DURATION + 1);
+    TEST_ASSERT_TRUE(input->is_triggered());
+
+    delete input;
+}
+
+int main(int argc, char **argv)
+{
+    arduino_shim::now_micros = 1000000;
+
+    UNITY_BEGIN();
+    RUN_TEST(test_bounce_back_is_ignored);
+    RUN_TEST(test_press_settles_after_bounce);
+    RUN_TEST(test_short_press_is_not_missed);
+    RUN_TEST(test_overflow_resyncs_from_pin);
+    RUN_TEST(test_overflow_back_to_released);
+    return UNITY_END();
+}
\ No newline at end of file
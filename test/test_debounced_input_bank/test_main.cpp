@@ -0,0 +1,99 @@
+#include <Arduino.h>
+#include <unity.h>
+
+#include "debounced_input_bank.h"
+
+using namespace thingnet::utils;
+
+// The bank samples every 5 ms, and an input changes state on the fourth
+// sample in a row at its new level.
+
+static const u32 __DEBOUNCE_DURATION = 20;
+static const u32 __SAMPLE_PERIOD = __DEBOUNCE_DURATION / 4;
+
+static u16 levels = 0;
+
+static u16 read_levels()
+{
+    return levels;
+}
+
+/**
+ * @brief Advances to the next sample and updates the bank.
+ *
+ * @param bank The bank to update.
+ * @return true If the bank took a sample.
+ */
+static bool sample(DebouncedInputBank *bank)
+{
+    arduino_shim::advance_millis(__SAMPLE_PERIOD);
+    return bank->update();
+}
+
+void setUp()
+{
+    levels = 0x0003;
+}
+
+void tearDown()
+{
+}
+
+void test_input_changes_after_four_samples()
+{
+    DebouncedInputBank bank(0x0003, 0x0003, __DEBOUNCE_DURATION);
+    bank.set_source(read_levels);
+    sample(&bank);
+
+    levels = 0x0002;
+    for (u8 index = 0; index < 3; index++)
+    {
+        TEST_ASSERT_TRUE(sample(&bank));
+        TEST_ASSERT_EQUAL(0, bank.get_state());
+    }
+
+    TEST_ASSERT_TRUE(sample(&bank));
+    TEST_ASSERT_EQUAL(0x0001, bank.get_state());
+    TEST_ASSERT_EQUAL(0x0001, bank.get_rising_edges());
+    TEST_ASSERT_EQUAL(0, bank.get_falling_edges());
+}
+
+void test_edges_are_kept_until_next_sample()
+{
+    DebouncedInputBank bank(0x0003, 0x0003, __DEBOUNCE_DURATION);
+    bank.set_source(read_levels);
+    sample(&bank);
+
+    levels = 0x0002;
+    for (u8 index = 0; index < 4; index++)
+    {
+        sample(&bank);
+    }
+    TEST_ASSERT_EQUAL(0x0001, bank.get_rising_edges());
+
+    // Updates between samples do not clear the edges.
+    TEST_ASSERT_FALSE(bank.update());
+    TEST_ASSERT_FALSE(bank.update());
+    TEST_ASSERT_EQUAL(0x0001, bank.get_rising_edges());
+
+    levels = 0x0003;
+    TEST_ASSERT_TRUE(sample(&bank));
+    TEST_ASSERT_EQUAL(0, bank.get_rising_edges());
+    for (u8 index = 0; index < 3; index++)
+    {
+        sample(&bank);
+    }
+    TEST_ASSERT_EQUAL(0x0001, bank.get_falling_edges());
+    TEST_ASSERT_FALSE(bank.update());
+    TEST_ASSERT_EQUAL(0x0001, bank.get_falling_edges());
+}
+
+int main(int argc, char **argv)
+{
+    arduino_shim::now_micros = 1000000;
+
+    UNITY_BEGIN();
+    RUN_TEST(test_input_changes_after_four_samples);
+    RUN_TEST(test_edges_are_kept_until_next_sample);
+    return UNITY_END();
+}
\ No newline at end of file
@@ -0,0 +1,193 @@
+#include <Arduino.h>
+#include <unity.h>
+
+#include "error_codes.h"
+#include "event_emitter.h"
+#include "static_event_emitter.h"
+
+using namespace thingnet;
+
+static const int __EVENT_ADDED = 1;
+static const int __EVENT_REMOVED = 2;
+
+static int received[__MAX_DEFERRED_EVENT_COUNT * 2];
+static u16 received_count = 0;
+
+static void on_event(int event_type, int event_data)
+{
+    received[received_count++] = event_data;
+}
+
+static u16 static_received_count = 0;
+
+static void on_static_event(int event_type, int event_data)
+{
+    static_received_count++;
+    on_event(event_type, -event_data);
+}
+
+typedef ListenerList<FunctionListener<&on_static_event>> StaticListeners;
+
+void setUp()
+{
+    received_count = 0;
+    static_received_count = 0;
+}
+
+void tearDown()
+{
+}
+
+void test_emit_dispatches_immediately()
+{
+    EventEmitter<int> emitter(__EVENT_ADDED);
+    emitter.add_listener(&on_event);
+
+    TEST_ASSERT_EQUAL(RESULT_OK, emitter.emit(7));
+    TEST_ASSERT_EQUAL(1, received_count);
+    TEST_ASSERT_EQUAL(7, received[0]);
+}
+
+void test_deferred_events_are_dispatched_on_drain()
+{
+    DeferredEventQueue<int> queue;
+    EventEmitter<int> emitter(__EVENT_ADDED);
+    emitter.add_listener(&on_event);
+    emitter.set_deferred(&queue);
+
+    TEST_ASSERT_EQUAL(RESULT_OK, emitter.emit(1));
+    TEST_ASSERT_EQUAL(RESULT_OK, emitter.emit(2));
+    TEST_ASSERT_EQUAL(0, received_count);
+
+    TEST_ASSERT_EQUAL(2, queue.drain());
+    TEST_ASSERT_EQUAL(2, received_count);
+    TEST_ASSERT_EQUAL(1, received[0]);
+    TEST_ASSERT_EQUAL(2, received[1]);
+}
+
+static EventEmitter<int> *reemitter = 0;
+
+static void on_event_reemit(int event_type, int event_data)
+{
+    on_event(event_type, event_data);
+    if (event_data < 3)
+    {
+        reemitter->emit(event_data + 1);
+    }
+}
+
+void test_events_emitted_while_draining_wait_for_next_drain()
+{
+    DeferredEventQueue<int> queue;
+    EventEmitter<int> emitter(__EVENT_ADDED);
+    emitter.add_listener(&on_event_reemit);
+    emitter.set_deferred(&queue);
+    reemitter = &emitter;
+
+    TEST_ASSERT_EQUAL(0, queue.drain());
+    emitter.emit(1);
+    TEST_ASSERT_EQUAL(1, queue.drain());
+    TEST_ASSERT_EQUAL(1, received_count);
+    TEST_ASSERT_EQUAL(1, queue.drain());
+    TEST_ASSERT_EQUAL(1, queue.drain());
+    TEST_ASSERT_EQUAL(0, queue.drain());
+    TEST_ASSERT_EQUAL(3, received_count);
+    TEST_ASSERT_EQUAL(3, received[2]);
+}
+
+void test_opposing_events_cancel_out()
+{
+    DeferredEventQueue<int> queue;
+    EventEmitter<int> added(__EVENT_ADDED);
+    EventEmitter<int> removed(__EVENT_REMOVED);
+    added.add_listener(&on_event);
+    removed.add_listener(&on_event);
+    added.set_deferred(&queue);
+    removed.set_deferred(&queue);
+
+    added.emit(5);
+    removed.emit(5);
+
+    TEST_ASSERT_EQUAL(0, queue.drain());
+    TEST_ASSERT_EQUAL(0, received_count);
+}
+
+void test_full_queue_drops_events()
+{
+    DeferredEventQueue<int> queue;
+    EventEmitter<int> emitter(__EVENT_ADDED);
+    emitter.add_listener(&on_event);
+    emitter.set_deferred(&queue);
+
+    for (int index = 0; index < __MAX_DEFERRED_EVENT_COUNT; index++)
+    {
+        TEST_ASSERT_EQUAL(RESULT_OK, emitter.emit(index));
+    }
+
+    // Events that do not fit are neither dispatched nor queued.
+    TEST_ASSERT_EQUAL(ERR_EVENT_QUEUE_FULL, emitter.emit(100));
+    TEST_ASSERT_EQUAL(ERR_EVENT_QUEUE_FULL, emitter.emit(101));
+    TEST_ASSERT_EQUAL(0, received_count);
+    TEST_ASSERT_EQUAL(2, queue.get_dropped_count());
+
+    TEST_ASSERT_EQUAL(__MAX_DEFERRED_EVENT_COUNT, queue.drain());
+    TEST_ASSERT_EQUAL(__MAX_DEFERRED_EVENT_COUNT, received_count);
+    for (int index = 0; index < __MAX_DEFERRED_EVENT_COUNT; index++)
+    {
+        TEST_ASSERT_EQUAL(index, received[index]);
+    }
+}
+
+void test_static_emitter()
+{
+    StaticEventEmitter<int, StaticListeners> emitter(__EVENT_ADDED);
+
+    emitter.emit(3);
+    TEST_ASSERT_EQUAL(1, static_received_count);
+    TEST_ASSERT_EQUAL(-3, received[0]);
+}
+
+void test_static_listeners_are_notified_through_base_emitter()
+{
+    StaticEventEmitter<int, StaticListeners, true> emitter(__EVENT_ADDED);
+    emitter.add_listener(&on_event);
+
+    EventEmitter<int> *base = &emitter;
+    TEST_ASSERT_EQUAL(RESULT_OK, base->emit(3));
+
+    // Statically bound listeners are notified first.
+    TEST_ASSERT_EQUAL(1, static_received_count);
+    TEST_ASSERT_EQUAL(2, received_count);
+    TEST_ASSERT_EQUAL(-3, received[0]);
+    TEST_ASSERT_EQUAL(3, received[1]);
+}
+
+void test_static_listeners_are_deferred()
+{
+    DeferredEventQueue<int> queue;
+    StaticEventEmitter<int, StaticListeners, true> emitter(__EVENT_ADDED);
+    emitter.add_listener(&on_event);
+    emitter.set_deferred(&queue);
+
+    emitter.emit(4);
+    TEST_ASSERT_EQUAL(0, static_received_count);
+    TEST_ASSERT_EQUAL(0, received_count);
+
+    queue.drain();
+    TEST_ASSERT_EQUAL(1, static_received_count);
+    TEST_ASSERT_EQUAL(2, received_count);
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_emit_dispatches_immediately);
+    RUN_TEST(test_deferred_events_are_dispatched_on_drain);
+    RUN_TEST(test_events_emitted_while_draining_wait_for_next_drain);
+    RUN_TEST(test_opposing_events_cancel_out);
+    RUN_TEST(test_full_queue_drops_events);
+    RUN_TEST(test_static_emitter);
+    RUN_TEST(test_static_listeners_are_notified_through_base_emitter);
+    RUN_TEST(test_static_listeners_are_deferred);
+    return UNITY_END();
+}
\ No newline at end of file
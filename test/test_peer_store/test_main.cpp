@@ -0,0 +1,186 @@
+#include <Arduino.h>
+#include <unity.h>
+
+#include "error_codes.h"
+#include "peer_store.h"
+#include "file_peer_store.h"
+
+using namespace thingnet;
+using namespace thingnet::storage;
+
+static const char *__PATH = "test_peers.bin";
+static const u8 __MAX_RECORDS = 8;
+
+static PeerRecord make_record(u8 index)
+{
+    PeerRecord record;
+    for (u8 byte = 0; byte < 6; byte++)
+    {
+        record.mac_address[byte] = index + byte;
+    }
+    record.role = index % 3;
+    record.timeout = 1000 * (index + 1);
+    return record;
+}
+
+static void write_raw(const void *data, size_t size)
+{
+    FILE *file = fopen(__PATH, "wb");
+    fwrite(data, 1, size, file);
+    fclose(file);
+}
+
+void setUp()
+{
+    remove(__PATH);
+}
+
+void tearDown()
+{
+    remove(__PATH);
+}
+
+void test_round_trip()
+{
+    FilePeerStore store(__PATH);
+    TEST_ASSERT_EQUAL(RESULT_OK, store.init());
+
+    PeerRecord saved[3] = {make_record(0), make_record(1), make_record(2)};
+    TEST_ASSERT_EQUAL(RESULT_OK, store.save(saved, 3));
+
+    PeerRecord loaded[__MAX_RECORDS];
+    u8 count = 0;
+    TEST_ASSERT_EQUAL(RESULT_OK, store.load(loaded, __MAX_RECORDS, &count));
+    TEST_ASSERT_EQUAL(3, count);
+    TEST_ASSERT_EQUAL_MEMORY(saved, loaded, sizeof(saved));
+}
+
+void test_save_replaces_previous_records()
+{
+    FilePeerStore store(__PATH);
+    store.init();
+
+    PeerRecord first[2] = {make_record(0), make_record(1)};
+    PeerRecord second[1] = {make_record(5)};
+    TEST_ASSERT_EQUAL(RESULT_OK, store.save(first, 2));
+    TEST_ASSERT_EQUAL(RESULT_OK, store.save(second, 1));
+
+    PeerRecord loaded[__MAX_RECORDS];
+    u8 count = 0;
+    TEST_ASSERT_EQUAL(RESULT_OK, store.load(loaded, __MAX_RECORDS, &count));
+    TEST_ASSERT_EQUAL(1, count);
+    TEST_ASSERT_EQUAL_MEMORY(second, loaded, sizeof(second));
+}
+
+void test_load_is_limited_to_max_count()
+{
+    FilePeerStore store(__PATH);
+    store.init();
+
+    PeerRecord saved[4] = {make_record(0), make_record(1), make_record(2), make_record(3)};
+    store.save(saved, 4);
+
+    PeerRecord loaded[2];
+    u8 count = 0;
+    TEST_ASSERT_EQUAL(RESULT_OK, store.load(loaded, 2, &count));
+    TEST_ASSERT_EQUAL(2, count);
+    TEST_ASSERT_EQUAL_MEMORY(saved, loaded, sizeof(loaded));
+}
+
+void test_load_missing_file()
+{
+    FilePeerStore store(__PATH);
+    store.init();
+
+    PeerRecord loaded[__MAX_RECORDS];
+    u8 count = 1;
+    TEST_ASSERT_EQUAL(RESULT_NO_EXIST, store.load(loaded, __MAX_RECORDS, &count));
+    TEST_ASSERT_EQUAL(0, count);
+}
+
+void test_load_truncated_records()
+{
+    PeerFileHeader header = {PEER_FILE_MAGIC, PEER_FILE_VERSION, 3};
+    PeerRecord records[2] = {make_record(0), make_record(1)};
+    u8 data[sizeof(header) + sizeof(records)];
+    memcpy(data, &header, sizeof(header));
+    memcpy(data + sizeof(header), records, sizeof(records));
+    write_raw(data, sizeof(data));
+
+    FilePeerStore store(__PATH);
+    store.init();
+
+    PeerRecord loaded[__MAX_RECORDS];
+    u8 count = 1;
+    TEST_ASSERT_EQUAL(ERR_STORAGE_READ_FAILED, store.load(loaded, __MAX_RECORDS, &count));
+    TEST_ASSERT_EQUAL(0, count);
+}
+
+void test_load_truncated_header()
+{
+    PeerFileHeader header = {PEER_FILE_MAGIC, PEER_FILE_VERSION, 0};
+    write_raw(&header, sizeof(header) - 1);
+
+    FilePeerStore store(__PATH);
+    store.init();
+
+    PeerRecord loaded[__MAX_RECORDS];
+    u8 count = 1;
+    TEST_ASSERT_EQUAL(ERR_STORAGE_READ_FAILED, store.load(loaded, __MAX_RECORDS, &count));
+    TEST_ASSERT_EQUAL(0, count);
+}
+
+void test_load_bad_magic()
+{
+    PeerFileHeader header = {PEER_FILE_MAGIC ^ 0xFFFF, PEER_FILE_VERSION, 0};
+    write_raw(&header, sizeof(header));
+
+    FilePeerStore store(__PATH);
+    store.init();
+
+    PeerRecord loaded[__MAX_RECORDS];
+    u8 count = 1;
+    TEST_ASSERT_EQUAL(ERR_STORAGE_READ_FAILED, store.load(loaded, __MAX_RECORDS, &count));
+    TEST_ASSERT_EQUAL(0, count);
+}
+
+void test_load_bad_version()
+{
+    PeerFileHeader header = {PEER_FILE_MAGIC, PEER_FILE_VERSION + 1, 0};
+    write_raw(&header, sizeof(header));
+
+    FilePeerStore store(__PATH);
+    store.init();
+
+    PeerRecord loaded[__MAX_RECORDS];
+    u8 count = 1;
+    TEST_ASSERT_EQUAL(ERR_STORAGE_READ_FAILED, store.load(loaded, __MAX_RECORDS, &count));
+    TEST_ASSERT_EQUAL(0, count);
+}
+
+void test_requires_init()
+{
+    FilePeerStore store(__PATH);
+
+    PeerRecord records[1] = {make_record(0)};
+    u8 count = 0;
+    TEST_ASSERT_EQUAL(ERR_STORAGE_INIT_FAILED, store.save(records, 1));
+    TEST_ASSERT_EQUAL(ERR_STORAGE_INIT_FAILED, store.load(records, 1, &count));
+    TEST_ASSERT_EQUAL(RESULT_OK, store.init());
+    TEST_ASSERT_EQUAL(RESULT_DUPLICATE, store.init());
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_round_trip);
+    RUN_TEST(test_save_replaces_previous_records);
+    RUN_TEST(test_load_is_limited_to_max_count);
+    RUN_TEST(test_load_missing_file);
+    RUN_TEST(test_load_truncated_records);
+    RUN_TEST(test_load_truncated_header);
+    RUN_TEST(test_load_bad_magic);
+    RUN_TEST(test_load_bad_version);
+    RUN_TEST(test_requires_init);
+    return UNITY_END();
+}
\ No newline at end of file
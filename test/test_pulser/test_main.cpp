@@ -0,0 +1,116 @@
+#include <Arduino.h>
+#include <unity.h>
+
+#include "pulse_engine.h"
+#include "pulser.h"
+
+using namespace thingnet::utils;
+
+// The native environment builds with PULSER_SOFTWARE_TIMER, so the outputs
+// are advanced by update(), by however many milliseconds have elapsed. Each
+// test uses its own pin.
+
+/**
+ * @brief Advances the time and updates the pulser.
+ *
+ * @param pulser The pulser to update.
+ * @param pin The pin of the pulser.
+ * @param duration The time to advance, in milliseconds.
+ * @return u8 The level of the pin after the update.
+ */
+static u8 step(Pulser *pulser, u8 pin, u32 duration)
+{
+    arduino_shim::advance_millis(duration);
+    pulser->update();
+    return digitalRead(pin);
+}
+
+void setUp()
+{
+    // Bring the engine up to date, so that a new channel starts from now.
+    PulseEngine::get_instance().update();
+}
+
+void tearDown()
+{
+}
+
+void test_duty_cycle()
+{
+    Pulser pulser(1, 100);
+    pulser.set_duty_cycle(25);
+    TEST_ASSERT_EQUAL(0, pulser.init());
+    TEST_ASSERT_EQUAL(HIGH, digitalRead(1));
+
+    TEST_ASSERT_EQUAL(HIGH, step(&pulser, 1, 24));
+    TEST_ASSERT_EQUAL(LOW, step(&pulser, 1, 1));
+    TEST_ASSERT_EQUAL(LOW, step(&pulser, 1, 74));
+    TEST_ASSERT_EQUAL(HIGH, step(&pulser, 1, 1));
+}
+
+void test_zero_length_steps_are_skipped()
+{
+    Pulser pulser(2, 100);
+    TEST_ASSERT_EQUAL(0, pulser.init());
+
+    // Low for 10 ms, then high for 10 ms. The empty steps never show on the
+    // output.
+    const u16 steps[4] = {0, 10, 10, 0};
+    TEST_ASSERT_EQUAL(0, pulser.set_sequence(steps, 4));
+    TEST_ASSERT_EQUAL(LOW, digitalRead(2));
+    TEST_ASSERT_EQUAL(HIGH, step(&pulser, 2, 10));
+    TEST_ASSERT_EQUAL(LOW, step(&pulser, 2, 10));
+    TEST_ASSERT_EQUAL(HIGH, step(&pulser, 2, 10));
+
+    const u16 empty_steps[2] = {0, 0};
+    TEST_ASSERT_EQUAL(1, pulser.set_sequence(empty_steps, 2));
+}
+
+void test_blink_code()
+{
+    Pulser pulser(3, 100);
+    TEST_ASSERT_EQUAL(0, pulser.init());
+    TEST_ASSERT_EQUAL(1, pulser.set_blink_code(0));
+    TEST_ASSERT_EQUAL(1, pulser.set_blink_code(__MAX_BLINK_CODE + 1));
+
+    // Two 200 ms blinks, then a 1000 ms pause.
+    TEST_ASSERT_EQUAL(0, pulser.set_blink_code(2));
+    TEST_ASSERT_EQUAL(HIGH, digitalRead(3));
+    TEST_ASSERT_EQUAL(LOW, step(&pulser, 3, 200));
+    TEST_ASSERT_EQUAL(HIGH, step(&pulser, 3, 200));
+    TEST_ASSERT_EQUAL(LOW, step(&pulser, 3, 200));
+    TEST_ASSERT_EQUAL(LOW, step(&pulser, 3, 999));
+    TEST_ASSERT_EQUAL(HIGH, step(&pulser, 3, 1));
+}
+
+void test_catches_up_after_stall()
+{
+    Pulser fast(4, 2);
+    TEST_ASSERT_EQUAL(0, fast.init());
+    Pulser blink(5, 100);
+    TEST_ASSERT_EQUAL(0, blink.init());
+    TEST_ASSERT_EQUAL(0, blink.set_blink_code(2));
+
+    // A 16 s stall is a whole number of periods of both patterns, so the
+    // outputs end up 1 ms into each pattern.
+    TEST_ASSERT_EQUAL(LOW, step(&fast, 4, 16000 + 1));
+    TEST_ASSERT_EQUAL(HIGH, digitalRead(5));
+    TEST_ASSERT_EQUAL(HIGH, step(&blink, 5, 500 - 1));
+    TEST_ASSERT_EQUAL(HIGH, digitalRead(4));
+
+    // The patterns carry on from where they caught up to.
+    TEST_ASSERT_EQUAL(LOW, step(&blink, 5, 100));
+    TEST_ASSERT_EQUAL(HIGH, step(&blink, 5, 1000));
+}
+
+int main(int argc, char **argv)
+{
+    arduino_shim::now_micros = 1000000;
+
+    UNITY_BEGIN();
+    RUN_TEST(test_duty_cycle);
+    RUN_TEST(test_zero_length_steps_are_skipped);
+    RUN_TEST(test_blink_code);
+    RUN_TEST(test_catches_up_after_stall);
+    return UNITY_END();
+}
\ No newline at end of file
@@ -0,0 +1,130 @@
+#include <Arduino.h>
+#include <espnow.h>
+#include <unity.h>
+
+#include "error_codes.h"
+#include "messages.h"
+#include "node.h"
+#include "request.h"
+#include "client_node_profile.h"
+
+using namespace thingnet;
+
+static const u8 __PEER_MAC[6] = {0x02, 0x00, 0x00, 0x00, 0x30, 0x01};
+static const u32 __REQUEST_TIMEOUT = 100;
+
+static Node &node = Node::get_instance();
+static CoroutineFramePool &frame_pool = CoroutineFramePool::get_instance();
+static u8 completed_count = 0;
+static int last_result = RESULT_OK;
+static u8 last_response_type = 0;
+
+/**
+ * @brief Sends a heartbeat request and waits for the response, keeping the
+ * payload and the response in the coroutine frame as the Task documentation
+ * does.
+ */
+static Task check_peer(MacAddress mac_address)
+{
+    MessagePayload payload(MSG_TYPE_HEARTBEAT);
+    PeerMessage response;
+    response.payload.type = 0;
+    int result = co_await node.request(mac_address, &payload, 0, __REQUEST_TIMEOUT, &response);
+    last_result = result;
+    last_response_type = response.payload.type;
+    completed_count++;
+}
+
+/**
+ * @brief Gets the message id of the last request that was sent.
+ */
+static u16 last_message_id()
+{
+    u16 message_id;
+    memcpy(&message_id, arduino_shim::esp_now_last_frame + 1, 2);
+    return message_id;
+}
+
+static void deliver_ack(u16 message_id)
+{
+    u8 frame[5] = {MSG_TYPE_ACK, 0, 0, (u8)message_id, (u8)(message_id >> 8)};
+    arduino_shim::esp_now_recv_cb((u8 *)__PEER_MAC, frame, sizeof(frame));
+}
+
+void setUp()
+{
+    completed_count = 0;
+    last_result = RESULT_OK;
+    last_response_type = 0;
+}
+
+void tearDown()
+{
+}
+
+void test_ack_resumes_request()
+{
+    Task task = check_peer(MacAddress::from_bytes(__PEER_MAC));
+    TEST_ASSERT_TRUE(task.is_valid());
+    TEST_ASSERT_EQUAL(MSG_TYPE_HEARTBEAT, arduino_shim::esp_now_last_frame[0]);
+    TEST_ASSERT_EQUAL(__MAX_COROUTINE_FRAMES - 1, frame_pool.get_available_count());
+
+    // The response is matched in the receive callback, but the coroutine
+    // only runs from the loop.
+    deliver_ack(last_message_id());
+    TEST_ASSERT_EQUAL(0, completed_count);
+
+    node.update();
+    TEST_ASSERT_EQUAL(1, completed_count);
+    TEST_ASSERT_EQUAL(RESULT_OK, last_result);
+    TEST_ASSERT_EQUAL(MSG_TYPE_ACK, last_response_type);
+    TEST_ASSERT_EQUAL(__MAX_COROUTINE_FRAMES, frame_pool.get_available_count());
+}
+
+void test_request_times_out()
+{
+    Task task = check_peer(MacAddress::from_bytes(__PEER_MAC));
+    TEST_ASSERT_TRUE(task.is_valid());
+
+    arduino_shim::advance_millis(__REQUEST_TIMEOUT - 1);
+    node.update();
+    TEST_ASSERT_EQUAL(0, completed_count);
+
+    arduino_shim::advance_millis(1);
+    node.update();
+    TEST_ASSERT_EQUAL(1, completed_count);
+    TEST_ASSERT_EQUAL(ERR_REQUEST_TIMEOUT, last_result);
+    TEST_ASSERT_EQUAL(0, RequestManager::get_instance().get_pending_count());
+    TEST_ASSERT_EQUAL(__MAX_COROUTINE_FRAMES, frame_pool.get_available_count());
+}
+
+void test_exhausted_pool_returns_invalid_task()
+{
+    for (u8 index = 0; index < __MAX_COROUTINE_FRAMES; index++)
+    {
+        TEST_ASSERT_TRUE(check_peer(MacAddress::from_bytes(__PEER_MAC)).is_valid());
+    }
+    TEST_ASSERT_EQUAL(0, frame_pool.get_available_count());
+
+    u32 sent_count = arduino_shim::esp_now_sent_count;
+    TEST_ASSERT_FALSE(check_peer(MacAddress::from_bytes(__PEER_MAC)).is_valid());
+    TEST_ASSERT_EQUAL(sent_count, arduino_shim::esp_now_sent_count);
+
+    arduino_shim::advance_millis(__REQUEST_TIMEOUT);
+    node.update();
+    TEST_ASSERT_EQUAL(__MAX_COROUTINE_FRAMES, completed_count);
+    TEST_ASSERT_EQUAL(__MAX_COROUTINE_FRAMES, frame_pool.get_available_count());
+}
+
+int main(int argc, char **argv)
+{
+    arduino_shim::now_micros = 1000000;
+    node.set_node_profile(new ClientNodeProfile(&node));
+    node.init();
+
+    UNITY_BEGIN();
+    RUN_TEST(test_ack_resumes_request);
+    RUN_TEST(test_request_times_out);
+    RUN_TEST(test_exhausted_pool_returns_invalid_task);
+    return UNITY_END();
+}
\ No newline at end of file
@@ -0,0 +1,140 @@
+#include <Arduino.h>
+#include <espnow.h>
+#include <unity.h>
+
+#include "clock.h"
+#include "timer_service.h"
+#include "error_codes.h"
+#include "messages.h"
+#include "node.h"
+#include "server_node_profile.h"
+
+using namespace thingnet;
+using namespace thingnet::utils;
+
+static const u8 __CLIENT_MAC[6] = {0x02, 0x00, 0x00, 0x00, 0x10, 0x01};
+
+static Node &node = Node::get_instance();
+static ServerNodeProfile *profile;
+
+/**
+ * @brief Runs the main loop, idling between passes the way the firmware
+ * does, until the given time has elapsed.
+ * 
+ * @param duration The time to run for, in milliseconds.
+ * @return u32 The number of passes made through the loop.
+ */
+static u32 run_for(u32 duration)
+{
+    TimerService &timer_service = TimerService::get_instance();
+    u64 end_time = Clock::now_millis() + duration;
+    u32 pass_count = 0;
+    while (Clock::now_millis() < end_time)
+    {
+        timer_service.update();
+        node.update();
+        timer_service.idle(end_time - Clock::now_millis());
+        pass_count++;
+    }
+    return pass_count;
+}
+
+static void deliver(const u8 *mac_address, u8 type, u16 message_id)
+{
+    u8 frame[3] = {type, (u8)message_id, (u8)(message_id >> 8)};
+    arduino_shim::esp_now_recv_cb((u8 *)mac_address, frame, sizeof(frame));
+}
+
+void setUp()
+{
+}
+
+void tearDown()
+{
+}
+
+void test_beacons_follow_trickle_interval()
+{
+    const BeaconStats *stats = profile->get_beacon_stats();
+    u32 pass_count = run_for(260);
+    TEST_ASSERT_EQUAL(1, stats->beacons_sent);
+    TEST_ASSERT_EQUAL(500, stats->interval);
+
+    pass_count += run_for(500);
+    TEST_ASSERT_EQUAL(2, stats->beacons_sent);
+    TEST_ASSERT_EQUAL(1000, stats->interval);
+
+    pass_count += run_for(1000);
+    TEST_ASSERT_EQUAL(3, stats->beacons_sent);
+
+    // The loop only wakes for beacons and the other profile timers.
+    TEST_ASSERT_LESS_THAN(20, pass_count);
+}
+
+void test_solicited_node_expires()
+{
+    deliver(__CLIENT_MAC, MSG_TYPE_DISCOVERY, 1);
+    TEST_ASSERT_TRUE(esp_now_is_peer_exist((u8 *)__CLIENT_MAC));
+    TEST_ASSERT_EQUAL(MSG_TYPE_ADVERTISEMENT, arduino_shim::esp_now_last_frame[0]);
+    TEST_ASSERT_EQUAL_MEMORY(__CLIENT_MAC, arduino_shim::esp_now_last_destination, 6);
+
+    // The capacity is limited by the radio's peer table, less the broadcast
+    // address.
+    TEST_ASSERT_EQUAL(arduino_shim::ESP_NOW_MAX_PEERS - 1, arduino_shim::esp_now_last_frame[3 + 8]);
+
+    run_for(900);
+    TEST_ASSERT_TRUE(esp_now_is_peer_exist((u8 *)__CLIENT_MAC));
+    run_for(200);
+    TEST_ASSERT_FALSE(esp_now_is_peer_exist((u8 *)__CLIENT_MAC));
+}
+
+void test_connect_is_admitted()
+{
+    deliver(__CLIENT_MAC, MSG_TYPE_CONNECT, 7);
+    TEST_ASSERT_EQUAL(0, profile->get_peer_count());
+
+    run_for(20);
+    TEST_ASSERT_EQUAL(1, profile->get_peer_count());
+    TEST_ASSERT_EQUAL(MSG_TYPE_ACK, arduino_shim::esp_now_last_frame[0]);
+    TEST_ASSERT_EQUAL(7, arduino_shim::esp_now_last_frame[3]);
+
+    // The admission timer stops once the queue is empty, so the loop goes
+    // back to waking for the beacons only.
+    TEST_ASSERT_LESS_THAN(10, run_for(500));
+}
+
+void test_full_radio_table_rejects_peer()
+{
+    // The broadcast address and the admitted client already use entries.
+    u8 free_count = arduino_shim::ESP_NOW_MAX_PEERS - arduino_shim::esp_now_peer_count;
+    u8 peer_count = profile->get_peer_count();
+    u8 mac_address[6] = {0x02, 0x00, 0x00, 0x00, 0x11, 0x00};
+    for (u8 index = 0; index < free_count + 2; index++)
+    {
+        mac_address[5] = index;
+        deliver(mac_address, MSG_TYPE_CONNECT, index + 1);
+        run_for(20);
+    }
+
+    // The connects beyond the radio's limit are dropped, and the server keeps
+    // running.
+    TEST_ASSERT_EQUAL(arduino_shim::ESP_NOW_MAX_PEERS, arduino_shim::esp_now_peer_count);
+    TEST_ASSERT_EQUAL(peer_count + free_count, profile->get_peer_count());
+    mac_address[5] = free_count;
+    TEST_ASSERT_EQUAL(0, profile->find_peer(MacAddress::from_bytes(mac_address)));
+}
+
+int main(int argc, char **argv)
+{
+    arduino_shim::now_micros = 1000000;
+    profile = new ServerNodeProfile(&node);
+    node.set_node_profile(profile);
+    node.init();
+
+    UNITY_BEGIN();
+    RUN_TEST(test_beacons_follow_trickle_interval);
+    RUN_TEST(test_solicited_node_expires);
+    RUN_TEST(test_connect_is_admitted);
+    RUN_TEST(test_full_radio_table_rejects_peer);
+    return UNITY_END();
+}
\ No newline at end of file
@@ -0,0 +1,102 @@
+#include <Arduino.h>
+#include <espnow.h>
+#include <unity.h>
+
+#include "clock.h"
+#include "timer_service.h"
+#include "error_codes.h"
+#include "messages.h"
+#include "node.h"
+#include "server_node_profile.h"
+#include "static_node_profile.h"
+
+using namespace thingnet;
+using namespace thingnet::utils;
+
+static const u8 __CLIENT_MAC[6] = {0x02, 0x00, 0x00, 0x00, 0x10, 0x01};
+
+static Node &node = Node::get_instance();
+static StaticNodeProfile<ServerNodeProfile> *profile;
+
+/**
+ * @brief Runs the main loop, idling between passes the way the firmware
+ * does, until the given time has elapsed.
+ *
+ * @param duration The time to run for, in milliseconds.
+ */
+static void run_for(u32 duration)
+{
+    TimerService &timer_service = TimerService::get_instance();
+    u64 end_time = Clock::now_millis() + duration;
+    while (Clock::now_millis() < end_time)
+    {
+        timer_service.update();
+        node.update();
+        timer_service.idle(end_time - Clock::now_millis());
+    }
+}
+
+static void deliver(const u8 *mac_address, u8 type, u16 message_id)
+{
+    u8 frame[3] = {type, (u8)message_id, (u8)(message_id >> 8)};
+    arduino_shim::esp_now_recv_cb((u8 *)mac_address, frame, sizeof(frame));
+}
+
+static Peer *find_client()
+{
+    return profile->find_peer(MacAddress::from_bytes(__CLIENT_MAC));
+}
+
+void setUp()
+{
+}
+
+void tearDown()
+{
+}
+
+void test_peers_are_static()
+{
+    deliver(__CLIENT_MAC, MSG_TYPE_CONNECT, 7);
+    run_for(20);
+    TEST_ASSERT_EQUAL(1, profile->get_peer_count());
+    TEST_ASSERT_NOT_NULL(dynamic_cast<StaticBasicPeer *>(find_client()));
+}
+
+void test_messages_are_routed_to_peers()
+{
+    Peer *peer = find_client();
+    u32 frames_in = peer->get_stats()->frames_in;
+
+    deliver(__CLIENT_MAC, MSG_TYPE_HEARTBEAT, 9);
+    TEST_ASSERT_EQUAL(frames_in + 1, peer->get_stats()->frames_in);
+    TEST_ASSERT_EQUAL(MSG_TYPE_ACK, arduino_shim::esp_now_last_frame[0]);
+    TEST_ASSERT_EQUAL(9, arduino_shim::esp_now_last_frame[3]);
+    TEST_ASSERT_EQUAL_MEMORY(__CLIENT_MAC, arduino_shim::esp_now_last_destination, 6);
+}
+
+void test_inactive_peers_are_pruned()
+{
+    run_for(BASIC_PEER_DEFAULT_TIMEOUT + 2000);
+    TEST_ASSERT_EQUAL(0, profile->get_peer_count());
+    TEST_ASSERT_FALSE(esp_now_is_peer_exist((u8 *)__CLIENT_MAC));
+
+    // Messages from the removed peer fall through to the profile.
+    deliver(__CLIENT_MAC, MSG_TYPE_CONNECT, 11);
+    run_for(20);
+    TEST_ASSERT_EQUAL(1, profile->get_peer_count());
+}
+
+int main(int argc, char **argv)
+{
+    arduino_shim::now_micros = 1000000;
+    profile = new StaticNodeProfile<ServerNodeProfile>(&node);
+    node.set_node_profile(profile);
+    node.init();
+
+    UNITY_BEGIN();
+    RUN_TEST(test_peers_are_static);
+    RUN_TEST(test_messages_are_routed_to_peers);
+    RUN_TEST(test_inactive_peers_are_pruned);
+    return UNITY_END();
+}
\ No newline at end of file
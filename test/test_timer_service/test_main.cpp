@@ -0,0 +1,101 @@
+#include <Arduino.h>
+#include <unity.h>
+
+#include "timer.h"
+#include "timer_service.h"
+
+using namespace thingnet::utils;
+
+static TimerService &timer_service = TimerService::get_instance();
+static u32 fired_count = 0;
+
+static void on_timer_due(void *context)
+{
+    fired_count++;
+}
+
+/**
+ * @brief Starts polled timers until the schedule is full.
+ *
+ * @param timers The timers to start, one per schedule slot.
+ */
+static void fill_schedule(Timer **timers)
+{
+    for (u8 index = 0; index < __MAX_SCHEDULED_TIMERS; index++)
+    {
+        timers[index] = new Timer(1000);
+        timers[index]->start();
+    }
+}
+
+static void clear_schedule(Timer **timers)
+{
+    for (u8 index = 0; index < __MAX_SCHEDULED_TIMERS; index++)
+    {
+        delete timers[index];
+    }
+}
+
+void setUp()
+{
+    fired_count = 0;
+}
+
+void tearDown()
+{
+}
+
+void test_callback_timer_fires()
+{
+    Timer timer(10);
+    timer.set_callback(on_timer_due, 0);
+    TEST_ASSERT_EQUAL(0, timer.start());
+    TEST_ASSERT_EQUAL(1, timer_service.get_timer_count());
+
+    arduino_shim::advance_millis(11);
+    timer_service.update();
+    TEST_ASSERT_EQUAL(1, fired_count);
+    TEST_ASSERT_FALSE(timer.is_running());
+}
+
+void test_callback_timer_fails_when_schedule_is_full()
+{
+    Timer *timers[__MAX_SCHEDULED_TIMERS];
+    fill_schedule(timers);
+
+    Timer timer(10);
+    timer.set_callback(on_timer_due, 0);
+    TEST_ASSERT_EQUAL(1, timer.start());
+    TEST_ASSERT_FALSE(timer.is_running());
+
+    clear_schedule(timers);
+    TEST_ASSERT_EQUAL(0, timer.start());
+    arduino_shim::advance_millis(11);
+    timer_service.update();
+    TEST_ASSERT_EQUAL(1, fired_count);
+}
+
+void test_polled_timer_works_when_schedule_is_full()
+{
+    Timer *timers[__MAX_SCHEDULED_TIMERS];
+    fill_schedule(timers);
+
+    Timer timer(10);
+    TEST_ASSERT_EQUAL(0, timer.start());
+    TEST_ASSERT_TRUE(timer.is_running());
+    arduino_shim::advance_millis(11);
+    TEST_ASSERT_TRUE(timer.is_complete());
+
+    clear_schedule(timers);
+}
+
+int main(int argc, char **argv)
+{
+    arduino_shim::now_micros = 1000000;
+
+    UNITY_BEGIN();
+    RUN_TEST(test_callback_timer_fires);
+    RUN_TEST(test_callback_timer_fails_when_schedule_is_full);
+    RUN_TEST(test_polled_timer_works_when_schedule_is_full);
+    return UNITY_END();
+}
\ No newline at end of file
@@ -0,0 +1,428 @@
+/**
+ * @brief Host side decoder for binary log output (firmware built with
+ * LOG_BINARY). Rebuilds log text from the records emitted by the device, by
+ * looking up format strings and module names in the firmware ELF image. Plain
+ * text in the input is passed through unchanged.
+ *
+ * Build:
+ *   g++ -std=c++17 -O2 -o log_decoder log_decoder.cpp
+ *
+ * Usage:
+ *   log_decoder <firmware.elf> [capture]
+ *
+ * The capture is read from stdin if no file is specified, so the tool can be
+ * used directly on a serial port. For example:
+ *   stty -F /dev/ttyUSB0 115200 raw && \
+ *     log_decoder .pio/build/esp07s/firmware.elf < /dev/ttyUSB0
+ */
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+typedef uint8_t u8;
+typedef uint16_t u16;
+typedef uint32_t u32;
+typedef uint64_t u64;
+
+// Must match log.h.
+static const int __LOG_RECORD_SYNC = 0xFE;
+static const char *__LOG_LEADER_FORMAT = "[%3s|%12s] ";
+
+static const u32 __SHT_NOBITS = 8;
+static const u32 __SHF_ALLOC = 0x02;
+
+/**
+ * @brief A section of the firmware image that is loaded on the device.
+ */
+typedef struct ImageSection
+{
+    u32 address;
+    u32 size;
+    u32 offset;
+} ImageSection;
+
+/**
+ * @brief Resolves device addresses to strings, using the firmware image.
+ */
+class FirmwareImage
+{
+private:
+    std::vector<u8> data;
+    std::vector<ImageSection> sections;
+
+    u32 read_u32(u32 offset) const
+    {
+        u32 value = 0;
+        memcpy(&value, &this->data[offset], 4);
+        return value;
+    }
+
+    u16 read_u16(u32 offset) const
+    {
+        u16 value = 0;
+        memcpy(&value, &this->data[offset], 2);
+        return value;
+    }
+
+public:
+    /**
+     * @brief Loads a 32 bit little endian ELF image.
+     *
+     * @param path The path to the ELF file.
+     * @return int 1 if the image was loaded, 0 otherwise.
+     */
+    int load(const char *path)
+    {
+        FILE *file = fopen(path, "rb");
+        if (file == 0)
+        {
+            return 0;
+        }
+
+        u8 chunk[4096];
+        size_t count;
+        while ((count = fread(chunk, 1, sizeof(chunk), file)) > 0)
+        {
+            this->data.insert(this->data.end(), chunk, chunk + count);
+        }
+        fclose(file);
+
+        // Only 32 bit, little endian images are supported.
+        if (this->data.size() < 52 ||
+            memcmp(this->data.data(), "\x7f"
+                                      "ELF",
+                   4) != 0 ||
+            this->data[4] != 1 || this->data[5] != 1)
+        {
+            return 0;
+        }
+
+        u32 section_offset = this->read_u32(32);
+        u16 section_size = this->read_u16(46);
+        u16 section_count = this->read_u16(48);
+        for (u16 index = 0; index < section_count; index++)
+        {
+            u32 header = section_offset + index * section_size;
+            if (header + 40 > this->data.size())
+            {
+                return 0;
+            }
+
+            u32 type = this->read_u32(header + 4);
+            u32 flags = this->read_u32(header + 8);
+            if (type == __SHT_NOBITS || (flags & __SHF_ALLOC) == 0)
+            {
+                continue;
+            }
+
+            ImageSection section;
+            section.address = this->read_u32(header + 12);
+            section.offset = this->read_u32(header + 16);
+            section.size = this->read_u32(header + 20);
+            if (section.offset + section.size <= this->data.size())
+            {
+                this->sections.push_back(section);
+            }
+        }
+
+        return 1;
+    }
+
+    /**
+     * @brief Reads the null terminated string at the given device address.
+     *
+     * @param address The address of the string on the device.
+     * @param value The string that was read.
+     * @return int 1 if the string was found, 0 otherwise.
+     */
+    int read_string(u32 address, std::string *value) const
+    {
+        for (const ImageSection &section : this->sections)
+        {
+            if (address < section.address || address >= section.address + section.size)
+            {
+                continue;
+            }
+
+            u32 offset = section.offset + (address - section.address);
+            u32 end = section.offset + section.size;
+            value->clear();
+            while (offset < end && this->data[offset] != 0)
+            {
+                value->push_back((char)this->data[offset]);
+                offset++;
+            }
+            return 1;
+        }
+
+        return 0;
+    }
+};
+
+/**
+ * @brief Reads the tagged arguments of a log record.
+ */
+class ArgumentReader
+{
+private:
+    const u8 *data;
+    u32 length;
+    u32 position;
+
+public:
+    ArgumentReader(const u8 *data, u32 length) : data(data), length(length), position(0) {}
+
+    /**
+     * @brief Formats the next argument according to the given conversion
+     * specification.
+     *
+     * @param spec The conversion specification, without length modifiers.
+     * @param output The string to which the formatted value is appended.
+     */
+    void format_next(std::string spec, std::string *output)
+    {
+        char conversion = spec.back();
+        char buffer[256];
+        if (this->position >= this->length)
+        {
+            output->append("<missing>");
+            return;
+        }
+
+        u8 tag = this->data[this->position++];
+        u32 remaining = this->length - this->position;
+        bool is_signed = conversion == 'd' || conversion == 'i';
+        if (tag == 'i' && remaining >= 4)
+        {
+            u32 value;
+            memcpy(&value, &this->data[this->position], 4);
+            this->position += 4;
+            if (is_signed)
+            {
+                snprintf(buffer, sizeof(buffer), spec.c_str(), (int32_t)value);
+            }
+            else
+            {
+                snprintf(buffer, sizeof(buffer), spec.c_str(), value);
+            }
+        }
+        else if (tag == 'l' && remaining >= 8)
+        {
+            u64 value;
+            memcpy(&value, &this->data[this->position], 8);
+            this->position += 8;
+            spec.insert(spec.size() - 1, "ll");
+            if (is_signed)
+            {
+                snprintf(buffer, sizeof(buffer), spec.c_str(), (long long)value);
+            }
+            else
+            {
+                snprintf(buffer, sizeof(buffer), spec.c_str(), (unsigned long long)value);
+            }
+        }
+        else if (tag == 'f' && remaining >= 8)
+        {
+            double value;
+            memcpy(&value, &this->data[this->position], 8);
+            this->position += 8;
+            snprintf(buffer, sizeof(buffer), spec.c_str(), value);
+        }
+        else if (tag == 's' && remaining >= 1 && this->data[this->position] < remaining)
+        {
+            u8 length = this->data[this->position];
+            std::string value((const char *)&this->data[this->position + 1], length);
+            this->position += 1 + length;
+            spec.back() = 's';
+            snprintf(buffer, sizeof(buffer), spec.c_str(), value.c_str());
+        }
+        else if (tag == 'm' && remaining >= 6)
+        {
+            const u8 *mac_addr = &this->data[this->position];
+            char value[18];
+            snprintf(value, sizeof(value), "%02x:%02x:%02x:%02x:%02x:%02x",
+                     mac_addr[0], mac_addr[1], mac_addr[2],
+                     mac_addr[3], mac_addr[4], mac_addr[5]);
+            this->position += 6;
+            spec.back() = 's';
+            snprintf(buffer, sizeof(buffer), spec.c_str(), value);
+        }
+        else
+        {
+            // Unknown or truncated argument. Nothing after it can be decoded.
+            this->position = this->length;
+            snprintf(buffer, sizeof(buffer), "<bad arg '%c'>", tag);
+        }
+
+        output->append(buffer);
+    }
+};
+
+static const char *__level_name(u8 level)
+{
+    switch (level)
+    {
+    case 'F':
+        return "FAT";
+    case 'E':
+        return "ERR";
+    case 'W':
+        return "WRN";
+    case 'I':
+        return "INF";
+    case 'D':
+        return "DBG";
+    case 'T':
+        return "TRC";
+    default:
+        return "???";
+    }
+}
+
+/**
+ * @brief Rebuilds the text of a single log record.
+ *
+ * @param image The firmware image.
+ * @param payload The record payload, following the sync and length bytes.
+ * @param length The length of the payload.
+ * @return std::string The log line, without a line terminator.
+ */
+static std::string __decode_record(const FirmwareImage &image, const u8 *payload, u32 length)
+{
+    if (length < 9)
+    {
+        return "<truncated log record>";
+    }
+
+    u32 message_address;
+    u32 module_address;
+    memcpy(&message_address, &payload[1], 4);
+    memcpy(&module_address, &payload[5], 4);
+
+    std::string message;
+    std::string module_name;
+    if (!image.read_string(message_address, &message))
+    {
+        char buffer[64];
+        snprintf(buffer, sizeof(buffer), "<unknown format string 0x%08x>", message_address);
+        message = buffer;
+    }
+    if (!image.read_string(module_address, &module_name))
+    {
+        module_name = "?";
+    }
+
+    char leader[64];
+    snprintf(leader, sizeof(leader), __LOG_LEADER_FORMAT, __level_name(payload[0]),
+             module_name.c_str());
+
+    std::string output = leader;
+    ArgumentReader reader(&payload[9], length - 9);
+    for (size_t index = 0; index < message.size(); index++)
+    {
+        char current = message[index];
+        if (current != '%')
+        {
+            output.push_back(current);
+            continue;
+        }
+
+        if (index + 1 < message.size() && message[index + 1] == '%')
+        {
+            output.push_back('%');
+            index++;
+            continue;
+        }
+
+        // Collect the flags, width and precision, dropping length modifiers,
+        // which are determined by the argument tags instead.
+        std::string spec = "%";
+        index++;
+        while (index < message.size() && strchr("diouxXcsfFeEgGp", message[index]) == 0)
+        {
+            if (strchr("hlLqjzt", message[index]) == 0)
+            {
+                spec.push_back(message[index]);
+            }
+            index++;
+        }
+
+        if (index == message.size())
+        {
+            output.append(spec);
+            break;
+        }
+
+        spec.push_back(message[index]);
+        reader.format_next(spec, &output);
+    }
+
+    return output;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2 || argc > 3)
+    {
+        fprintf(stderr, "Usage: %s <firmware.elf> [capture]\n", argv[0]);
+        return 1;
+    }
+
+    FirmwareImage image;
+    if (!image.load(argv[1]))
+    {
+        fprintf(stderr, "Unable to load firmware image [%s]\n", argv[1]);
+        return 1;
+    }
+
+    FILE *input = stdin;
+    if (argc == 3)
+    {
+        input = fopen(argv[2], "rb");
+        if (input == 0)
+        {
+            fprintf(stderr, "Unable to open capture [%s]\n", argv[2]);
+            return 1;
+        }
+    }
+
+    int current;
+    while ((current = fgetc(input)) != EOF)
+    {
+        if (current != __LOG_RECORD_SYNC)
+        {
+            // Plain text, such as fatal errors and boot messages.
+            fputc(current, stdout);
+            if (current == '\n')
+            {
+                fflush(stdout);
+            }
+            continue;
+        }
+
+        int length = fgetc(input);
+        if (length == EOF)
+        {
+            break;
+        }
+
+        u8 payload[256];
+        if (fread(payload, 1, length, input) != (size_t)length)
+        {
+            fprintf(stdout, "<truncated log record>\n");
+            break;
+        }
+
+        fprintf(stdout, "%s\n", __decode_record(image, payload, length).c_str());
+        fflush(stdout);
+    }
+
+    if (input != stdin)
+    {
+        fclose(input);
+    }
+
+    return 0;
+}
\ No newline at end of file